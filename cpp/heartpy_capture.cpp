@@ -0,0 +1,279 @@
+#include "heartpy_capture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace heartpy {
+
+static const uint32_t kCaptureMagic = 0x50435048u; // "HPCP"
+static const uint32_t kCaptureVersion = 1;
+
+static inline uint32_t fnv1a(const uint8_t* p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+static inline uint8_t* putVarint(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) { *p++ = uint8_t(v) | 0x80; v >>= 7; }
+    *p++ = uint8_t(v);
+    return p;
+}
+
+static inline bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        const uint8_t b = *p++;
+        v |= uint64_t(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static inline uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+static inline int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+bool CaptureWriter::open(const std::string& path, const std::vector<uint8_t>& checkpoint, size_t bufferBytes) {
+    close();
+    f_ = std::fopen(path.c_str(), "wb");
+    if (!f_) return false;
+    const uint32_t hdr[2] = {kCaptureMagic, kCaptureVersion};
+    const uint64_t len = checkpoint.size();
+    bool ok = std::fwrite(hdr, sizeof(hdr), 1, f_) == 1 && std::fwrite(&len, sizeof(len), 1, f_) == 1;
+    if (ok && len) ok = std::fwrite(checkpoint.data(), 1, len, f_) == len;
+    if (!ok || std::fflush(f_) != 0) { std::fclose(f_); f_ = nullptr; return false; }
+    cap_ = std::max<size_t>(4096, bufferBytes);
+    active_.assign(cap_, 0);
+    pending_.assign(cap_, 0);
+    used_ = 0;
+    prevBits_ = 0; prevTsBits_ = 0; prevTsDelta_ = 0;
+    stats_ = {};
+    bytesWritten_ = sizeof(hdr) + sizeof(len) + len;
+    blocksWritten_ = 0;
+    blocksFailed_ = 0;
+    bytesDropped_ = 0;
+    stop_ = false; havePending_ = false;
+    thread_ = std::thread(&CaptureWriter::flushLoop, this);
+    return true;
+}
+
+void CaptureWriter::close() {
+    if (!f_) return;
+    {
+        std::unique_lock<std::mutex> lk(m_);
+        cv_.wait(lk, [this]{ return !havePending_; });
+        if (used_) handoffLocked();
+        stop_ = true;   // the flush thread writes the last block before it exits
+    }
+    cv_.notify_all();
+    thread_.join();
+    std::fclose(f_);
+    f_ = nullptr;
+}
+
+uint8_t* CaptureWriter::reserve(size_t n) {
+    if (!f_) return nullptr;
+    if (used_ + n > active_.size()) {
+        // The flush thread still owns the other buffer: grow rather than drop or block
+        active_.resize(std::max(active_.size() * 2, used_ + n));
+        ++stats_.bufferGrowths;
+    }
+    return active_.data() + used_;
+}
+
+void CaptureWriter::finish(uint8_t* end) {
+    used_ = size_t(end - active_.data());
+    ++stats_.records;
+    if (used_ >= cap_ - cap_ / 4 && handoffLocked()) cv_.notify_all();
+}
+
+bool CaptureWriter::handoffLocked() {
+    if (havePending_) return false;   // keep filling; the next record or the timer retries
+    std::swap(active_, pending_);
+    pendingUsed_ = used_;
+    used_ = 0;
+    havePending_ = true;
+    if (active_.size() < cap_) active_.resize(cap_);
+    return true;
+}
+
+void CaptureWriter::flushLoop() {
+    std::unique_lock<std::mutex> lk(m_);
+    for (;;) {
+        const bool woken = cv_.wait_for(lk, std::chrono::milliseconds(250), [this]{ return havePending_ || stop_; });
+        // Timed flush: take the partial buffer here rather than waiting for the next record
+        if (!woken && used_) handoffLocked();
+        if (havePending_) {
+            // Producers do not touch pending_ while havePending_ is set
+            lk.unlock();
+            writeBlock(pending_.data(), pendingUsed_);
+            lk.lock();
+            havePending_ = false;
+            cv_.notify_all();
+            continue;
+        }
+        if (stop_) return;
+    }
+}
+
+void CaptureWriter::writeBlock(const uint8_t* p, size_t n) {
+    if (n == 0) return;
+    const uint32_t frame[2] = {uint32_t(n), fnv1a(p, n)};
+    const bool ok = blocksFailed_.load(std::memory_order_relaxed) == 0
+        && std::fwrite(frame, sizeof(frame), 1, f_) == 1
+        && std::fwrite(p, 1, n, f_) == n
+        && std::fflush(f_) == 0;
+    if (!ok) {
+        blocksFailed_.fetch_add(1, std::memory_order_relaxed);
+        bytesDropped_.fetch_add(sizeof(frame) + n, std::memory_order_relaxed);
+        return;
+    }
+    bytesWritten_.fetch_add(sizeof(frame) + n, std::memory_order_relaxed);
+    blocksWritten_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CaptureWriter::update() {
+    std::lock_guard<std::mutex> lk(m_);
+    if (uint8_t* p = reserve(1)) { *p = uint8_t(CaptureEvent::Kind::UPDATE); finish(p + 1); }
+}
+
+void CaptureWriter::append(const float* x, const double* ts, size_t n) {
+    std::lock_guard<std::mutex> lk(m_);
+    // Worst case per value: 5 bytes (float delta), 10 bytes (timestamp delta-of-delta)
+    uint8_t* p = reserve(1 + 10 + n * (ts ? 15 : 5));
+    if (!p) return;
+    *p++ = uint8_t(ts ? CaptureEvent::Kind::APPEND_TS : CaptureEvent::Kind::APPEND);
+    p = putVarint(p, n);
+    uint32_t prev = prevBits_;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t b; std::memcpy(&b, &x[i], sizeof(b));
+        p = putVarint(p, zigzag(int32_t(b - prev)));
+        prev = b;
+    }
+    prevBits_ = prev;
+    if (ts) {
+        uint64_t prevT = prevTsBits_;
+        int64_t prevD = prevTsDelta_;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t b; std::memcpy(&b, &ts[i], sizeof(b));
+            const int64_t d = int64_t(b - prevT);
+            p = putVarint(p, zigzag(d - prevD));
+            prevT = b; prevD = d;
+        }
+        prevTsBits_ = prevT; prevTsDelta_ = prevD;
+    }
+    finish(p);
+}
+
+void CaptureWriter::setting(CaptureEvent::Kind kind, double value) {
+    std::lock_guard<std::mutex> lk(m_);
+    uint8_t* p = reserve(1 + sizeof(double));
+    if (!p) return;
+    *p++ = uint8_t(kind);
+    std::memcpy(p, &value, sizeof(value));
+    finish(p + sizeof(value));
+}
+
+CaptureStats CaptureWriter::stats() const {
+    CaptureStats s;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        s = stats_;
+    }
+    s.bytesWritten = bytesWritten_.load(std::memory_order_relaxed);
+    s.blocksWritten = blocksWritten_.load(std::memory_order_relaxed);
+    s.blocksFailed = blocksFailed_.load(std::memory_order_relaxed);
+    s.bytesDropped = bytesDropped_.load(std::memory_order_relaxed);
+    return s;
+}
+
+bool CaptureReader::open(const uint8_t* data, size_t n) {
+    *this = CaptureReader();
+    uint32_t hdr[2];
+    uint64_t len = 0;
+    if (!data || n < sizeof(hdr) + sizeof(len)) return false;
+    std::memcpy(hdr, data, sizeof(hdr));
+    std::memcpy(&len, data + sizeof(hdr), sizeof(len));
+    if (hdr[0] != kCaptureMagic || hdr[1] != kCaptureVersion) return false;
+    const size_t off = sizeof(hdr) + sizeof(len);
+    if (len > n - off) return false;
+    checkpoint_.assign(data + off, data + off + len);
+    p_ = data + off + len;
+    end_ = data + n;
+    return true;
+}
+
+bool CaptureReader::nextBlock() {
+    if (p_ == end_) return false;
+    uint32_t frame[2];
+    if (size_t(end_ - p_) < sizeof(frame)) { truncated_ = true; return false; }
+    std::memcpy(frame, p_, sizeof(frame));
+    const uint8_t* body = p_ + sizeof(frame);
+    if (frame[0] > size_t(end_ - body) || fnv1a(body, frame[0]) != frame[1]) { truncated_ = true; return false; }
+    blk_ = body;
+    blkEnd_ = body + frame[0];
+    p_ = blkEnd_;
+    return true;
+}
+
+bool CaptureReader::next(CaptureEvent& ev) {
+    if (truncated_) return false;
+    while (blk_ == blkEnd_) if (!nextBlock()) return false;
+    const uint8_t tag = *blk_++;
+    ev.samples.clear();
+    ev.timestamps.clear();
+    ev.value = 0.0;
+    auto bad = [this]{ truncated_ = true; return false; };
+    switch (tag) {
+    case uint8_t(CaptureEvent::Kind::APPEND):
+    case uint8_t(CaptureEvent::Kind::APPEND_TS): {
+        ev.kind = CaptureEvent::Kind(tag);
+        uint64_t n = 0, v = 0;
+        if (!getVarint(blk_, blkEnd_, n) || n > size_t(blkEnd_ - blk_)) return bad();
+        ev.samples.resize(n);
+        uint32_t prev = prevBits_;
+        for (uint64_t i = 0; i < n; ++i) {
+            if (!getVarint(blk_, blkEnd_, v)) return bad();
+            prev += uint32_t(unzigzag(v));
+            std::memcpy(&ev.samples[i], &prev, sizeof(prev));
+        }
+        prevBits_ = prev;
+        if (ev.kind == CaptureEvent::Kind::APPEND_TS) {
+            ev.timestamps.resize(n);
+            uint64_t prevT = prevTsBits_;
+            int64_t prevD = prevTsDelta_;
+            for (uint64_t i = 0; i < n; ++i) {
+                if (!getVarint(blk_, blkEnd_, v)) return bad();
+                prevD += unzigzag(v);
+                prevT += uint64_t(prevD);
+                std::memcpy(&ev.timestamps[i], &prevT, sizeof(prevT));
+            }
+            prevTsBits_ = prevT; prevTsDelta_ = prevD;
+        }
+        return true;
+    }
+    case uint8_t(CaptureEvent::Kind::UPDATE):
+        ev.kind = CaptureEvent::Kind::UPDATE;
+        return true;
+    default:
+        if (tag < uint8_t(CaptureEvent::Kind::WINDOW) || tag > uint8_t(CaptureEvent::Kind::PRESET_AMBIENT)) return bad();
+        if (size_t(blkEnd_ - blk_) < sizeof(double)) return bad();
+        ev.kind = CaptureEvent::Kind(tag);
+        std::memcpy(&ev.value, blk_, sizeof(double));
+        blk_ += sizeof(double);
+        return true;
+    }
+}
+
+bool readCaptureFile(const std::string& path, std::vector<uint8_t>& out) {
+    out.clear();
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    uint8_t buf[1 << 16];
+    size_t got;
+    while ((got = std::fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + got);
+    std::fclose(f);
+    return !out.empty();
+}
+
+} // namespace heartpy
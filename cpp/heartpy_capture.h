@@ -0,0 +1,114 @@
+// Capture log for RealtimeAnalyzer sessions: a checkpoint followed by every input the analysis saw
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+namespace heartpy {
+
+// File layout: "HPCP" magic, version, checkpoint blob (length-prefixed), then framed blocks
+// [u32 payload bytes][u32 FNV-1a of payload][records]. A torn or corrupt trailing block ends the
+// log; everything before it stays readable. Records:
+//   APPEND / APPEND_TS : varint n, n float deltas (zigzag varint of the bit-pattern difference),
+//                        APPEND_TS adds n timestamp delta-of-deltas (zigzag varint, bit patterns)
+//   UPDATE             : a poll that ran the analysis (no payload)
+//   settings           : 8-byte double argument
+// Delta state carries across records and blocks, so values round-trip bit-exactly.
+struct CaptureEvent {
+    enum class Kind : uint8_t {
+        APPEND = 1, APPEND_TS = 2, UPDATE = 3,
+        WINDOW = 4, UPDATE_INTERVAL = 5, PSD_UPDATE = 6, DISPLAY_HZ = 7,
+        PRESET_TORCH = 8, PRESET_AMBIENT = 9
+    };
+    Kind kind = Kind::APPEND;
+    std::vector<float> samples;
+    std::vector<double> timestamps;
+    double value = 0.0;
+};
+
+struct CaptureStats {
+    unsigned long long records = 0;
+    unsigned long long bytesWritten = 0;   // including the header and block framing
+    unsigned long long blocksWritten = 0;
+    unsigned long long bufferGrowths = 0;  // records that outran the preallocated buffer
+    // Write errors (e.g. a full disk): blocks that did not reach the file. After the first one
+    // the file ends in a torn block, so every later block is dropped too rather than written.
+    unsigned long long blocksFailed = 0;
+    unsigned long long bytesDropped = 0;
+};
+
+// Encodes on the analyzer's processing thread (under its data lock) into a preallocated buffer.
+// A flush thread writes full buffers and, every 250 ms, takes whatever is buffered itself, so an
+// idle or stalled session still reaches the file; each block is fflush()ed. Records are encoded
+// under m_, which the flush thread holds only to swap buffers.
+class CaptureWriter {
+public:
+    CaptureWriter() = default;
+    ~CaptureWriter() { close(); }
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    bool open(const std::string& path, const std::vector<uint8_t>& checkpoint, size_t bufferBytes);
+    // Hands over what is buffered, waits for the flush thread and closes the file
+    void close();
+
+    void append(const float* x, const double* ts, size_t n);
+    void update();
+    void setting(CaptureEvent::Kind kind, double value);
+    CaptureStats stats() const;
+
+private:
+    // Caller holds m_ from reserve() through finish()
+    uint8_t* reserve(size_t n);
+    void finish(uint8_t* end);
+    bool handoffLocked();
+    void flushLoop();
+    void writeBlock(const uint8_t* p, size_t n);
+
+    std::FILE* f_ {nullptr};
+    std::vector<uint8_t> active_, pending_;
+    size_t used_ {0}, pendingUsed_ {0}, cap_ {0};
+    uint32_t prevBits_ {0};
+    uint64_t prevTsBits_ {0};
+    int64_t prevTsDelta_ {0};
+    mutable std::mutex m_;
+    std::condition_variable cv_;
+    bool havePending_ {false}, stop_ {false};
+    std::thread thread_;
+    CaptureStats stats_ {};
+    std::atomic<unsigned long long> bytesWritten_ {0}, blocksWritten_ {0};
+    std::atomic<unsigned long long> blocksFailed_ {0}, bytesDropped_ {0};
+};
+
+// Sequential decoder for a capture held in memory
+class CaptureReader {
+public:
+    bool open(const uint8_t* data, size_t n);
+    const std::vector<uint8_t>& checkpoint() const { return checkpoint_; }
+    // False at the end of the log (or at the first damaged block; see truncated())
+    bool next(CaptureEvent& ev);
+    bool truncated() const { return truncated_; }
+
+private:
+    bool nextBlock();
+    const uint8_t* p_ {nullptr};
+    const uint8_t* end_ {nullptr};
+    const uint8_t* blk_ {nullptr};
+    const uint8_t* blkEnd_ {nullptr};
+    std::vector<uint8_t> checkpoint_;
+    uint32_t prevBits_ {0};
+    uint64_t prevTsBits_ {0};
+    int64_t prevTsDelta_ {0};
+    bool truncated_ {false};
+};
+
+bool readCaptureFile(const std::string& path, std::vector<uint8_t>& out);
+
+} // namespace heartpy
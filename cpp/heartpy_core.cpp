@@ -5,6 +5,7 @@
 #include <numeric>
 #include <complex>
 #include <stdexcept>
+#include <atomic>
 #ifdef USE_ACCELERATE_FFT
 #include <Accelerate/Accelerate.h>
 #endif
@@ -14,7 +15,11 @@
 
 namespace heartpy {
 
-static bool s_deterministic = false;
+// Process-wide default for batch callers that do not set Options::deterministic; streaming
+// analyzers never touch it (they carry their own SpectralContext)
+static std::atomic<bool> s_deterministic {false};
+
+static double breathingRateWelch(const std::vector<double>& rrIntervals, bool deterministic);
 
 namespace {
 
@@ -198,43 +203,71 @@ static void fft_inplace(std::vector<std::complex<double>>& a) {
     }
 }
 
-PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double overlap) {
+// Rebuilds ctx's window, plan and scratch only when nfft changes
+static void prepareSpectral(SpectralContext& ctx, int nfft) {
+    if (ctx.nfft == nfft && !ctx.window.empty()) return;
+    ctx.nfft = nfft;
+    ctx.window.resize(nfft);
+    for (int i = 0; i < nfft; ++i) ctx.window[i] = 0.5 - 0.5 * std::cos(2.0 * PI * i / (nfft - 1));
+    double U = 0.0;
+#if defined(HEARTPY_ENABLE_ACCELERATE)
+    // Use vDSP to compute sum of squares when enabled
+    vDSP_svesqD(ctx.window.data(), 1, &U, (vDSP_Length)nfft);
+#else
+    for (double v : ctx.window) U += v * v; // sum(w^2)
+#endif
+    ctx.windowPower = U;
+    ctx.plan.reset();
+    ctx.buf.clear(); ctx.re.clear(); ctx.im.clear(); ctx.inF.clear();
+#ifdef USE_KISSFFT
+    ctx.outF.clear();
+#endif
+    if (!isPowerOfTwo(nfft)) return;
+#ifdef USE_ACCELERATE_FFT
+    FFTSetupD setup = vDSP_create_fftsetupD(static_cast<vDSP_Length>(std::log2(nfft)), kFFTRadix2);
+    ctx.plan = std::shared_ptr<void>(setup, [](void* p){ vDSP_destroy_fftsetupD(static_cast<FFTSetupD>(p)); });
+    ctx.re.resize(nfft); ctx.im.resize(nfft);
+#elif defined(USE_KISSFFT)
+    kiss_fftr_cfg cfg = kiss_fftr_alloc(nfft, 0, NULL, NULL);
+    ctx.plan = std::shared_ptr<void>(cfg, [](void* p){ kiss_fftr_free(p); });
+    ctx.inF.resize(nfft); ctx.outF.resize(nfft / 2 + 1);
+#else
+    ctx.buf.resize(nfft);
+#endif
+}
+
+static void welchPSD(const std::vector<double>& x, double fs, int nfft, double overlap,
+                     SpectralContext& ctx, std::vector<double>& freqs, std::vector<double>& P) {
+    freqs.clear(); P.clear();
     const int n = static_cast<int>(x.size());
     if (nfft <= 0) nfft = 256;
-    if (n < nfft) return {{}, {}};
+    if (n < nfft) return;
     int step = static_cast<int>(std::round(nfft * (1.0 - overlap)));
     step = std::max(1, step);
     const int nseg = 1 + (n - nfft) / step;
-    if (nseg <= 0) return {{}, {}};
+    if (nseg <= 0) return;
 
-    // Hann window
-    std::vector<double> w(nfft);
-    for (int i = 0; i < nfft; ++i) w[i] = 0.5 - 0.5 * std::cos(2.0 * PI * i / (nfft - 1));
-    double U = 0.0;
-#if defined(HEARTPY_ENABLE_ACCELERATE)
-    // Use vDSP to compute sum of squares when enabled
-    vDSP_svesqD(w.data(), 1, &U, (vDSP_Length)nfft);
-#else
-    for (double v : w) U += v * v; // sum(w^2)
-#endif
+    prepareSpectral(ctx, nfft);
+    const std::vector<double>& w = ctx.window;
+    const double U = ctx.windowPower;
 
     const int kmax = nfft / 2 + 1;
-    std::vector<double> P(kmax, 0.0);
+    P.assign(kmax, 0.0);
 
     bool useFFT = isPowerOfTwo(nfft);
-    if (heartpy::isDeterministic()) useFFT = false; // force DFT for determinism
+    if (ctx.deterministic) useFFT = false; // force DFT for determinism
     if (useFFT) {
 #ifdef USE_ACCELERATE_FFT
         // Use Accelerate vDSP double-precision split-complex FFT if available
-        #include <TargetConditionals.h>
-        #include <Accelerate/Accelerate.h>
-        FFTSetupD setup = vDSP_create_fftsetupD(static_cast<vDSP_Length>(std::log2(nfft)), kFFTRadix2);
-        std::vector<double> real(nfft), imag(nfft, 0.0);
+        FFTSetupD setup = static_cast<FFTSetupD>(ctx.plan.get());
+        std::vector<double>& real = ctx.re;
+        std::vector<double>& imag = ctx.im;
         DSPDoubleSplitComplex split{real.data(), imag.data()};
         for (int s = 0; s < nseg; ++s) {
             int start = s * step;
             // Copy segment into real buffer
             std::memcpy(real.data(), &x[start], sizeof(double) * (size_t)nfft);
+            std::fill(imag.begin(), imag.end(), 0.0);
 #if defined(HEARTPY_ENABLE_ACCELERATE)
             // mu = mean(real)
             double mu = 0.0; vDSP_meanvD(real.data(), 1, &mu, (vDSP_Length)nfft);
@@ -256,11 +289,10 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
                 P[k] += Pseg;
             }
         }
-        vDSP_destroy_fftsetupD(setup);
 #elif defined(USE_KISSFFT)
-        kiss_fftr_cfg cfg = kiss_fftr_alloc(nfft, 0, NULL, NULL);
-        std::vector<float> in(nfft);
-        std::vector<kiss_fft_cpx> out(kmax);
+        kiss_fftr_cfg cfg = static_cast<kiss_fftr_cfg>(ctx.plan.get());
+        std::vector<float>& in = ctx.inF;
+        kiss_fft_cpx* out = ctx.outF.data();
         for (int s = 0; s < nseg; ++s) {
             int start = s * step;
             // detrend (constant) and window
@@ -289,7 +321,7 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
             double mu = 0.0; for (int t = 0; t < nfft; ++t) mu += x[start + t]; mu /= nfft;
             for (int t = 0; t < nfft; ++t) in[t] = static_cast<float>((x[start + t] - mu) * w[t]);
 #endif
-            kiss_fftr(cfg, in.data(), out.data());
+            kiss_fftr(cfg, in.data(), out);
             for (int k = 0; k < kmax; ++k) {
                 double realv = out[k].r;
                 double imagv = out[k].i;
@@ -298,9 +330,8 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
                 P[k] += Pseg;
             }
         }
-        kiss_fftr_free(cfg);
 #else
-        std::vector<std::complex<double>> buf(nfft);
+        std::vector<std::complex<double>>& buf = ctx.buf;
         for (int s = 0; s < nseg; ++s) {
             int start = s * step;
             // detrend (constant)
@@ -340,9 +371,16 @@ PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double ove
         int last = (nfft % 2 == 0) ? (kmax - 1) : kmax;
         for (int k = 1; k < last; ++k) P[k] *= 2.0;
     }
-    std::vector<double> freqs(kmax);
+    freqs.resize(kmax);
     for (int k = 0; k < kmax; ++k) freqs[k] = (fs * k) / nfft;
-    return {freqs, P};
+}
+
+PSDResult welchPSD(const std::vector<double>& x, double fs, int nfft, double overlap, bool deterministic = false) {
+    SpectralContext ctx;
+    ctx.deterministic = deterministic;
+    PSDResult r;
+    welchPSD(x, fs, nfft, overlap, ctx, r.freqs, r.psd);
+    return r;
 }
 
 // HeartPy-style band integration: select bins fully inside band and apply trapz with constant dx
@@ -712,41 +750,199 @@ std::vector<double> enhancePeaks(const std::vector<double>& signal, double /*fs*
     return result;
 }
 
+namespace {
+
+// Fused single-pass preprocessing: clipping bridge -> Hampel -> baseline wander -> enhance peaks.
+// Each stage is fed in sample order and forwards its output downstream as soon as its
+// look-ahead is satisfied (Hampel: windowSize/2, enhance: 1), so the chain touches every
+// sample once with only a few doubles of state per stage. Arithmetic mirrors the staged
+// public functions above operation-for-operation, so results are bit-identical.
+class FusedPreprocessor {
+public:
+    FusedPreprocessor(const std::vector<double>& in, double fs, const Options& opt)
+        : x_(in.data()), n_(in.size()), opt_(opt) {
+        halfWin_ = std::max(0, opt.hampelWindow / 2);
+        if (opt_.hampelCorrect) {
+            ring_.assign(2 * static_cast<size_t>(halfWin_) + 1, 0.0);
+            win_.reserve(ring_.size());
+            dev_.reserve(ring_.size());
+        }
+        double cutoff = 0.5;
+        double rc = 1.0 / (2.0 * PI * cutoff);
+        double dt = 1.0 / fs;
+        alpha_ = dt / (rc + dt);
+        enhance_ = opt_.enhancePeaks && n_ >= 3;
+    }
+
+    // Writes processed samples to out; optionally fills cumsum (size n+1) for the detrend stage.
+    void run(std::vector<double>& out, std::vector<double>* cumsum) {
+        out_ = &out;
+        cumsum_ = cumsum;
+        out.resize(n_);
+        if (cumsum_) { cumsum_->resize(n_ + 1); (*cumsum_)[0] = 0.0; }
+        vmin = std::numeric_limits<double>::infinity();
+        vmax = -std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < n_; ++i) feedHampel(opt_.interpClipping ? clipAt(i) : x_[i]);
+        // Drain the Hampel look-ahead tail (windows truncated at the end of the signal)
+        if (opt_.hampelCorrect) {
+            size_t first = (n_ > static_cast<size_t>(halfWin_)) ? (n_ - halfWin_) : 0;
+            for (size_t j = first; j < n_; ++j) emitHampel(j);
+        }
+        if (enhance_ && n_ > 0) sink(e1_); // last sample passes through unchanged
+    }
+
+    double vmin{0.0};
+    double vmax{0.0};
+
+private:
+    // Stage 1: linear bridge across runs >= threshold; called with strictly increasing i
+    double clipAt(size_t i) {
+        const double thr = opt_.clippingThreshold;
+        if (!(x_[i] >= thr)) return x_[i];
+        if (!inRun_ || i > runEnd_) {
+            runStart_ = i;
+            size_t e = i;
+            while (e + 1 < n_ && x_[e + 1] >= thr) ++e;
+            runEnd_ = e;
+            bridge_ = (runStart_ > 0 && runEnd_ < n_ - 1);
+            if (bridge_) { startVal_ = x_[runStart_ - 1]; endVal_ = x_[runEnd_ + 1]; }
+            inRun_ = true;
+        }
+        if (!bridge_) return x_[i];
+        double t = static_cast<double>(i - runStart_ + 1) / (runEnd_ - runStart_ + 2);
+        return startVal_ + t * (endVal_ - startVal_);
+    }
+
+    // Stage 2: Hampel with a (2*half+1) ring of stage-1 output
+    void feedHampel(double v) {
+        if (!opt_.hampelCorrect) { feedBaseline(v); return; }
+        ring_[fed_ % ring_.size()] = v;
+        ++fed_;
+        if (fed_ > static_cast<size_t>(halfWin_)) emitHampel(fed_ - 1 - halfWin_);
+    }
+    void emitHampel(size_t j) {
+        const size_t W = ring_.size();
+        size_t start = (j > static_cast<size_t>(halfWin_)) ? (j - halfWin_) : 0;
+        size_t end = std::min(n_ - 1, j + halfWin_);
+        win_.clear();
+        for (size_t k = start; k <= end; ++k) win_.push_back(ring_[k % W]);
+        auto mid = win_.begin() + win_.size() / 2;
+        std::nth_element(win_.begin(), mid, win_.end());
+        double medianVal = *mid;
+        dev_.clear();
+        for (double val : win_) dev_.push_back(std::abs(val - medianVal));
+        auto dmid = dev_.begin() + dev_.size() / 2;
+        std::nth_element(dev_.begin(), dmid, dev_.end());
+        double mad = *dmid;
+        double cur = ring_[j % W];
+        feedBaseline((std::abs(cur - medianVal) > opt_.hampelThreshold * mad) ? medianVal : cur);
+    }
+
+    // Stage 3: causal one-pole high-pass (baseline wander)
+    void feedBaseline(double v) {
+        if (!opt_.removeBaselineWander) { feedEnhance(v); return; }
+        double y = blStarted_ ? alpha_ * (blPrevOut_ + v - blPrevIn_) : v;
+        blStarted_ = true;
+        blPrevIn_ = v;
+        blPrevOut_ = y;
+        feedEnhance(y);
+    }
+
+    // Stage 4: derivative enhancer with one-sample look-ahead
+    void feedEnhance(double v) {
+        if (!enhance_) { sink(v); return; }
+        if (enFed_ == 1) sink(e1_);
+        else if (enFed_ >= 2) sink(e1_ + 0.1 * ((v - e2_) / 2.0));
+        e2_ = e1_;
+        e1_ = v;
+        ++enFed_;
+    }
+
+    void sink(double v) {
+        (*out_)[written_] = v;
+        if (cumsum_) (*cumsum_)[written_ + 1] = (*cumsum_)[written_] + v;
+        if (v < vmin) vmin = v;
+        if (v > vmax) vmax = v;
+        ++written_;
+    }
+
+    const double* x_;
+    size_t n_;
+    const Options& opt_;
+    std::vector<double>* out_{nullptr};
+    std::vector<double>* cumsum_{nullptr};
+    size_t written_{0};
+    // clipping bridge state
+    bool inRun_{false}, bridge_{false};
+    size_t runStart_{0}, runEnd_{0};
+    double startVal_{0.0}, endVal_{0.0};
+    // Hampel state
+    int halfWin_{0};
+    size_t fed_{0};
+    std::vector<double> ring_, win_, dev_;
+    // baseline state
+    double alpha_{0.0};
+    bool blStarted_{false};
+    double blPrevIn_{0.0}, blPrevOut_{0.0};
+    // enhance state
+    bool enhance_{false};
+    size_t enFed_{0};
+    double e1_{0.0}, e2_{0.0};
+};
+
+} // namespace
+
+std::vector<double> preprocessSignal(const std::vector<double>& signal, double fs, const Options& opt) {
+    std::vector<double> out;
+    if (signal.empty() || fs <= 0.0) return signal;
+    FusedPreprocessor fp(signal, fs, opt);
+    fp.run(out, nullptr);
+    return out;
+}
+
 HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const Options& opt) {
 	if (signal.empty()) throw std::invalid_argument("signal is empty");
 	if (fs <= 0.0) throw std::invalid_argument("fs must be > 0");
 
 	HeartMetrics m;
-	std::vector<double> processed = signal;
+	const size_t n = signal.size();
 
-	// Preprocessing pipeline
-	if (opt.interpClipping) {
-		processed = interpolateClipping(processed, fs, opt.clippingThreshold);
-	}
-	
-	if (opt.hampelCorrect) {
-		processed = hampelFilter(processed, opt.hampelWindow, opt.hampelThreshold);
-	}
-	
-	if (opt.removeBaselineWander) {
-		processed = removeBaselineWander(processed, fs);
-	}
-	
-	if (opt.enhancePeaks) {
-		processed = enhancePeaks(processed, fs);
-	}
+	// Preprocessing pipeline (clipping/Hampel/baseline/enhance) fused into one pass that
+	// also tracks min/max and the detrend prefix sums
+	std::vector<double> processed;
+	std::vector<double> cumsum;
+	FusedPreprocessor pre(signal, fs, opt);
+	pre.run(processed, &cumsum);
+	double pmin = pre.vmin, pmax = pre.vmax;
 
 	// Ensure positive baseline
-	auto minMax = std::minmax_element(processed.begin(), processed.end());
-	if (*minMax.first < 0) {
-		double offset = std::abs(*minMax.first);
-		std::transform(processed.begin(), processed.end(), processed.begin(),
-					  [offset](double val) { return val + offset; });
+	if (pmin < 0) {
+		double offset = std::abs(pmin);
+		pmin = std::numeric_limits<double>::infinity();
+		pmax = -std::numeric_limits<double>::infinity();
+		for (size_t i = 0; i < n; ++i) {
+			double v = processed[i] + offset;
+			processed[i] = v;
+			cumsum[i + 1] = cumsum[i] + v;
+			if (v < pmin) pmin = v;
+			if (v > pmax) pmax = v;
+		}
 	}
 
-	// 1) Detrend for later spectral analysis
+	// 1) Detrend for later spectral analysis, fused with the [0..1024] scaling used for peaks
 	int detrendWin = std::max(5, static_cast<int>(std::round(0.75 * fs)));
-	std::vector<double> x = movingAverageDetrend(processed, detrendWin);
+	std::vector<double> x(n);
+	std::vector<double> procForPeaks(n);
+	const double pRange = pmax - pmin;
+	const bool doScale = !(pRange < 1e-12);
+	const int ni = static_cast<int>(n);
+	for (int i = 0; i < ni; ++i) {
+		int start = std::max(0, i - detrendWin / 2);
+		int end = std::min(ni, i + (detrendWin - detrendWin / 2));
+		double mean = (cumsum[end] - cumsum[start]) / std::max(1, end - start);
+		x[i] = processed[i] - mean;
+		procForPeaks[i] = doScale ? (0.0 + ((processed[i] - pmin) / pRange) * 1024.0) : processed[i];
+	}
 
 	// 2) Bandpass (used primarily for spectral analysis); peak detection will use processed
 	// If order>=3: use simple 3x one-pole HP/LP with filtfilt-like zero-phase (Butterworth-like)
@@ -782,8 +978,7 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
 		x = bandpassFilter(x, fs, opt.lowHz, opt.highHz, opt.iirOrder);
 	}
 
-	// 3) Peak detection: HeartPy-style fit_peaks on scaled processed signal
-	std::vector<double> procForPeaks = scaleData(processed, 0.0, 1024.0);
+	// 3) Peak detection: HeartPy-style fit_peaks on scaled processed signal (scaled above)
 	// Use scaled signal directly for HeartPy-style detection (HP uses rolling mean threshold)
 	HPFitResult hpfit = fitPeaksHP(procForPeaks, fs, opt.bpmMin, opt.bpmMax);
     std::vector<int> peaks = hpfit.ok ? hpfit.peaks
@@ -929,7 +1124,7 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
 		
 		// Breathing analysis (Hz by default; convert if requested)
 		if (m.rrList.size() >= 10) {
-			double br_hz = calculateBreathingRate(m.rrList);
+			double br_hz = breathingRateWelch(m.rrList, opt.deterministic);
 			m.breathingRate = opt.breathingAsBpm ? (br_hz * 60.0) : br_hz;
 		}
 	}
@@ -978,7 +1173,7 @@ HeartMetrics analyzeSignal(const std::vector<double>& signal, double fs, const O
 			int nperseg = opt.nfft > 0 ? opt.nfft : static_cast<int>(std::round(opt.welchWsizeSec * fs_new));
 			if (nperseg <= 0) nperseg = 256;
 			if (nperseg > static_cast<int>(rr_interp.size())) nperseg = static_cast<int>(rr_interp.size());
-			PSDResult psd = welchPSD(rr_interp, fs_new, nperseg, 0.5);
+			PSDResult psd = welchPSD(rr_interp, fs_new, nperseg, 0.5, opt.deterministic);
             if (!psd.freqs.empty()) {
                 m.vlf = integrateBand(psd.freqs, psd.psd, 0.0033, 0.04);
                 m.lf  = integrateBand(psd.freqs, psd.psd, 0.04,   0.15);
@@ -1119,6 +1314,10 @@ bool checkSegmentQuality(const std::vector<int>& rejectedBeats, int totalBeats,
 
 // Breathing analysis
 double calculateBreathingRate(const std::vector<double>& rrIntervals, const std::string& method) {
+    return breathingRateWelch(rrIntervals, isDeterministic());
+}
+
+static double breathingRateWelch(const std::vector<double>& rrIntervals, bool deterministic) {
     if (rrIntervals.size() < 10) return 0.0;
     // Build time series from RR intervals (ms) -> seconds
     std::vector<double> t; t.reserve(rrIntervals.size());
@@ -1149,7 +1348,7 @@ double calculateBreathingRate(const std::vector<double>& rrIntervals, const std:
     // Detrend
     reg = movingAverageDetrend(reg, static_cast<int>(std::round(2.0 * fs)));
     // Welch PSD
-    PSDResult psd = welchPSD(reg, fs, 256, 0.5);
+    PSDResult psd = welchPSD(reg, fs, 256, 0.5, deterministic);
     if (psd.freqs.empty()) return 0.0;
     // Find peak in 0.10-0.40 Hz (HeartPy default breathing band)
     double fpeak = 0.0, pmax = -1.0;
@@ -1361,7 +1560,7 @@ HeartMetrics analyzeRRIntervals(const std::vector<double>& rrMs, const Options&
         
         // Breathing analysis (Hz by default; convert if requested)
         if (metrics.rrList.size() >= 10) {
-            double br_hz = calculateBreathingRate(metrics.rrList);
+            double br_hz = breathingRateWelch(metrics.rrList, opt.deterministic);
             metrics.breathingRate = opt.breathingAsBpm ? (br_hz * 60.0) : br_hz;
         }
     }
@@ -1476,11 +1675,25 @@ std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(
     double fs,
     int nfft,
     double overlap) {
-    PSDResult psd = welchPSD(signal, fs, nfft, overlap);
+    PSDResult psd = welchPSD(signal, fs, nfft, overlap, isDeterministic());
     return {psd.freqs, psd.psd};
 }
 
-void setDeterministic(bool on) { s_deterministic = on; }
-bool isDeterministic() { return s_deterministic; }
+void welchPowerSpectrum(const std::vector<double>& signal, double fs, int nfft, double overlap,
+                        SpectralContext& ctx, std::vector<double>& freqs, std::vector<double>& psd) {
+    welchPSD(signal, fs, nfft, overlap, ctx, freqs, psd);
+}
+
+size_t SpectralContext::bytesUsed() const {
+    size_t bytes = window.capacity() * sizeof(double) + (re.capacity() + im.capacity()) * sizeof(double)
+        + buf.capacity() * sizeof(std::complex<double>) + inF.capacity() * sizeof(float);
+#ifdef USE_KISSFFT
+    bytes += outF.capacity() * sizeof(kiss_fft_cpx);
+#endif
+    return bytes;
+}
+
+void setDeterministic(bool on) { s_deterministic.store(on, std::memory_order_relaxed); }
+bool isDeterministic() { return s_deterministic.load(std::memory_order_relaxed); }
 
 } // namespace heartpy
@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <functional>
+#include <complex>
+#include <memory>
 
 #ifdef USE_KISSFFT
 #include "kissfft/kiss_fftr.h"
@@ -41,6 +43,10 @@ struct Options {
 	bool   useHPThreshold = false;   // if true, prefer HP-style threshold in streaming
 	double maPerc = 30.0;            // HeartPy-like ma_perc (10..60 typical)
 	bool   adaptiveMaPerc = true;    // enable light grid search per poll
+	// Grid scoring: true tracks each candidate incrementally over the samples a poll adds; false
+	// re-runs the legacy full-window detection per candidate (current-window scaling, 150 ms
+	// first-peak rule, no streaming beats kept past the grid's last peak)
+	bool   maGridIncremental = true;
 
 	// Streaming tunables (defaults preserve current behavior)
 	// Min-RR gating
@@ -121,7 +127,36 @@ struct Options {
     bool replaceOutliers = false;
 
     // Streaming storage (optional)
-    bool useRingBuffer = false; // if true, use fixed-capacity ring buffers in streaming (default OFF)
+    bool useRingBuffer = true;  // ring-buffer window storage in streaming (O(1) trimming); false = legacy vectors
+    // Window storage footprint: FULL keeps raw + filtered windows; FILTERED_ONLY drops the raw copy
+    // (nothing downstream reads it); INT16 additionally stores filtered samples as int16 with a
+    // power-of-two scale (ring storage only; with useRingBuffer=false it acts as FILTERED_ONLY).
+    enum class StorageMode { FULL, FILTERED_ONLY, INT16 } storageMode = StorageMode::FULL;
+    // Timestamped push(): resample onto a uniform grid at the nominal fs (streaming cubic, about
+    // one input sample of latency) so filters, peak positions and the poll-time analysis run at a
+    // fixed rate instead of the EMA-estimated effective fs
+    bool resampleTimestamps = false;
+
+    // Streaming ingestion queue (optional): push() only enqueues into a lock-free SPSC ring,
+    // the consumer (poll()) drains and processes. Backpressure when the queue is full:
+    //  DROP_OLDEST overwrites unread samples (push never waits),
+    //  DECIMATE averages timestamped samples pairwise once >3/4 full (untimestamped: drop-oldest),
+    //  BLOCK waits for the consumer (requires poll() running on another thread).
+    bool useIngestQueue = false;
+    double ingestQueueSeconds = 4.0;   // queue capacity in seconds at nominal fs
+    enum class Backpressure { DROP_OLDEST, DECIMATE, BLOCK } ingestBackpressure = Backpressure::DROP_OLDEST;
+
+    // Background analysis (optional): a per-analyzer worker thread runs the DSP on its own
+    // cadence and publishes immutable snapshots; poll() and the getters become wait-free
+    // reads of the latest snapshot (call them from a single reader thread, e.g. the JS thread).
+    // Implies useIngestQueue, so only the worker ever touches analyzer state.
+    bool backgroundWorker = false;
+
+    // Compute-budget governor (streaming, optional): per-poll budget in ms; 0 = off (every stage
+    // runs at its nominal cadence). When on, a poll-cost EMA over budget, or a stable signal
+    // (high confidence, steady RR), stretches PSD cadence, defers ma_perc grid retuning and
+    // eventually reuses the last batch analysis; flat/saturated windows short-circuit.
+    double pollBudgetMs = 0.0;
     
     // Deterministic mode (runtime): prefer scalar/DFT paths, snap EMA cadence
     bool deterministic = false; // default OFF
@@ -129,6 +164,16 @@ struct Options {
 
 // Quality information structure
 struct QualityInfo {
+    // Poll stages (QualityInfo::pollStagesRun bits)
+    enum PollStage : unsigned {
+        kStageBatch = 1,            // batch analyzeSignal() on the window
+        kStageMaGrid = 2,           // ma_perc grid retune
+        kStagePsd = 4,              // Welch PSD / SNR update
+        kStageConsolidate = 8,      // refractory consolidation
+        kStageSuppression = 16,     // periodic (harmonic) suppression
+        kStageDoublingRepair = 32,  // RR doubling repair passes
+        kStageFlatSkip = 64         // flat/saturated window: analysis short-circuited
+    };
 	int totalBeats = 0;
 	int rejectedBeats = 0;
 	double rejectionRate = 0.0;
@@ -170,6 +215,21 @@ struct QualityInfo {
     unsigned long long timestampsSkippedTotal = 0;   // timestamps skipped due to backtrack (cumulative)
     unsigned long long timeJumpEventsTotal = 0;      // dt > threshold events (cumulative)
     int droppingActive = 0;                          // 1 if consecutive drops observed recently
+    // Ingestion queue (useIngestQueue)
+    unsigned long long ingestDroppedTotal = 0;       // queued samples overwritten before processing
+    unsigned long long ingestDecimatedTotal = 0;     // samples merged away by pairwise decimation
+    unsigned long long ingestBlockedTotal = 0;       // pushes that had to wait for queue space
+    unsigned long long ingestQueueHighWater = 0;     // max queued samples observed
+    // Beat latency: push() entry of the peak sample -> first poll() output containing it (cumulative)
+    std::vector<double> beatLatencyEdgesMs;              // bucket upper bounds; last bucket is open-ended
+    std::vector<unsigned long long> beatLatencyHist;     // beatLatencyEdgesMs.size() + 1 buckets
+    // Revisions per finalized beat (replaced/moved/removed after first report): 0,1,2,3,4+
+    std::vector<unsigned long long> beatRevisionHist;
+    // Compute governor
+    unsigned pollStagesRun = 0;     // PollStage bits that ran in this poll
+    int governorLevel = 0;          // 0 = full cadence .. 3 = cheapest (Options::pollBudgetMs)
+    double pollCostMs = 0.0;        // wall time spent in this poll's analysis
+    unsigned long long windowStartAbs = 0; // absolute sample index that peak indices are relative to
 };
 
 // Enhanced metrics structure matching Python HeartPy
@@ -245,6 +305,9 @@ std::vector<double> hampelFilter(const std::vector<double>& signal, int windowSi
 std::vector<double> removeBaselineWander(const std::vector<double>& signal, double fs);
 std::vector<double> enhancePeaks(const std::vector<double>& signal, double fs);
 std::vector<double> scaleData(const std::vector<double>& signal, double newMin = 0.0, double newMax = 1024.0);
+// Fused single pass of the enabled stages above (clipping -> Hampel -> baseline -> enhance);
+// bit-identical to chaining the individual functions in that order
+std::vector<double> preprocessSignal(const std::vector<double>& signal, double fs, const Options& opt);
 
 // Outlier detection functions
 std::vector<double> removeOutliersIQR(const std::vector<double>& data, double& lowerBound, double& upperBound);
@@ -268,7 +331,29 @@ std::vector<double> calculatePoincare(const std::vector<double>& rrIntervals);
 std::pair<std::vector<double>, std::vector<double>> welchPowerSpectrum(const std::vector<double>& signal, 
                                                                         double fs, int nfft = 256, double overlap = 0.5);
 
-// Global deterministic toggle for core spectral routines (runtime)
+// Spectral working state owned by one caller (e.g. one RealtimeAnalyzer): the determinism flag
+// plus the Hann window, FFT plan and scratch cached for the last nfft. Never shared between threads.
+struct SpectralContext {
+    bool deterministic = false;              // force the scalar DFT (bit-exact across runs)
+    int nfft = 0;                            // size the cached state was built for
+    std::vector<double> window;
+    double windowPower = 0.0;                // sum(w^2)
+    std::shared_ptr<void> plan;              // backend FFT plan (vDSP / KissFFT)
+    std::vector<double> re, im;              // vDSP split-complex scratch
+    std::vector<std::complex<double>> buf;   // built-in radix-2 scratch
+    std::vector<float> inF;                  // KissFFT scratch
+#ifdef USE_KISSFFT
+    std::vector<kiss_fft_cpx> outF;
+#endif
+    size_t bytesUsed() const;
+};
+// Welch PSD with caller-owned context; freqs/psd storage is reused across calls
+void welchPowerSpectrum(const std::vector<double>& signal, double fs, int nfft, double overlap,
+                        SpectralContext& ctx, std::vector<double>& freqs, std::vector<double>& psd);
+
+// Process-wide deterministic default for the legacy welchPowerSpectrum/calculateBreathingRate
+// entry points. analyzeSignal/analyzeRRIntervals honour only Options::deterministic and streaming
+// analyzers use their own context, so neither reads it.
 void setDeterministic(bool on);
 bool isDeterministic();
 
@@ -0,0 +1,222 @@
+#include "heartpy_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace heartpy {
+
+static inline size_t roundUpPow2(size_t v) {
+    size_t c = 1;
+    while (c < v) c <<= 1;
+    return c;
+}
+
+size_t AnalyzerPool::estimateSessionBytes(double fs, const Options& opt, double windowSec) {
+    if (!(fs > 0.0)) fs = 50.0;
+    const double win = std::clamp(windowSec, 1.0, 300.0);
+    const size_t winN = (size_t)std::ceil(win * fs);
+    const size_t batch = (size_t)std::ceil(10.0 * fs);
+    const size_t margin = 8 * (size_t)std::ceil(fs);
+    size_t bytes = 16 * 1024;                                               // object, filter/deque state
+    const size_t ringN = roundUpPow2(winN + margin + batch);
+    const bool q16 = opt.useRingBuffer && opt.storageMode == Options::StorageMode::INT16;
+    if (opt.storageMode == Options::StorageMode::FULL) bytes += ringN * sizeof(float); // raw ring
+    bytes += ringN * (q16 ? sizeof(int16_t) : sizeof(float));                         // filtered ring
+    if (opt.useIngestQueue || opt.backgroundWorker)
+        bytes += roundUpPow2((size_t)std::ceil(std::max(0.5, opt.ingestQueueSeconds) * fs)) * 24; // slot: float + double + flags, padded
+    bytes += 2 * (size_t)std::ceil(win * 120.0) * sizeof(float);           // display stage + front at max display rate
+    bytes += 6 * winN * sizeof(double);                                    // poll: window snapshot, scaled copy, batch temporaries
+    return bytes;
+}
+
+AnalyzerPool::AnalyzerPool(const PoolConfig& cfg) : cfg_(cfg) {
+    int n = cfg_.workers > 0 ? cfg_.workers : (int)std::thread::hardware_concurrency();
+    n = std::max(1, n);
+    cfg_.sweepSeconds = std::clamp(cfg_.sweepSeconds, 0.001, 1.0);
+    for (int i = 0; i < n; ++i) shards_.emplace_back(new Shard());
+    for (int i = 0; i < n; ++i) workers_.emplace_back(&AnalyzerPool::workerLoop, this, (size_t)i);
+}
+
+AnalyzerPool::~AnalyzerPool() {
+    { std::lock_guard<std::mutex> lk(stopMutex_); stop_ = true; }
+    stopCv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+SessionId AnalyzerPool::open(double fs, const Options& opt, double windowSec) {
+    Options o = opt;
+    o.useIngestQueue = true;      // producers only enqueue; workers do the processing
+    o.backgroundWorker = false;   // the pool's workers replace per-analyzer threads
+    const size_t bytes = estimateSessionBytes(fs, o, windowSec);
+    if (cfg_.sessionMemoryBudgetBytes > 0 && bytes > cfg_.sessionMemoryBudgetBytes) { ++rejectedOpens_; return 0; }
+    auto s = std::make_shared<Session>();
+    s->bytes = bytes;
+    s->rt.reset(new RealtimeAnalyzer(fs, o));
+    s->rt->setWindowSeconds(windowSec);
+    return admit(std::move(s));
+}
+
+SessionId AnalyzerPool::restore(const uint8_t* data, size_t n) {
+    Options runtime;
+    runtime.useIngestQueue = true;
+    runtime.backgroundWorker = false;
+    auto s = std::make_shared<Session>();
+    s->rt = RealtimeAnalyzer::restore(data, n, &runtime);
+    if (!s->rt) { ++rejectedOpens_; return 0; }
+    s->bytes = s->rt->bytesUsed();
+    if (cfg_.sessionMemoryBudgetBytes > 0 && s->bytes > cfg_.sessionMemoryBudgetBytes) { ++rejectedOpens_; return 0; }
+    return admit(std::move(s));
+}
+
+std::vector<uint8_t> AnalyzerPool::checkpoint(SessionId id) {
+    std::shared_ptr<Session> s;
+    {
+        std::shared_lock<std::shared_mutex> lk(registryMutex_);
+        auto it = registry_.find(id);
+        if (it == registry_.end()) return {};
+        s = it->second;
+    }
+    // Serializes with the shard's worker through the analyzer's own lock
+    return s->rt->checkpoint();
+}
+
+SessionId AnalyzerPool::admit(std::shared_ptr<Session> s) {
+    {
+        std::unique_lock<std::shared_mutex> lk(registryMutex_);
+        if (cfg_.globalMemoryBudgetBytes > 0 && bytesReserved_ + s->bytes > cfg_.globalMemoryBudgetBytes) { ++rejectedOpens_; return 0; }
+        bytesReserved_ += s->bytes;
+        s->id = nextId_++;
+        registry_.emplace(s->id, s);
+    }
+    Shard& sh = *shards_[s->id % shards_.size()];
+    std::lock_guard<std::mutex> lk(sh.mutex);
+    sh.sessions.push_back(s);
+    ++sh.version;
+    return s->id;
+}
+
+void AnalyzerPool::close(SessionId id) {
+    std::shared_ptr<Session> s;
+    {
+        std::unique_lock<std::shared_mutex> lk(registryMutex_);
+        auto it = registry_.find(id);
+        if (it == registry_.end()) return;
+        s = std::move(it->second);
+        bytesReserved_ -= s->bytes;
+        registry_.erase(it);
+    }
+    // Workers stop draining it; a producer blocked in pushMany() must not wait forever
+    s->rt->releaseIngest();
+    // A worker mid-sweep may still hold a reference; the session is freed when it lets go
+    Shard& sh = *shards_[id % shards_.size()];
+    std::lock_guard<std::mutex> lk(sh.mutex);
+    for (size_t i = 0; i < sh.sessions.size(); ++i) {
+        if (sh.sessions[i]->id != id) continue;
+        sh.sessions[i]->closed = true;   // keeps that worker from queueing it again
+        sh.sessions[i] = std::move(sh.sessions.back());
+        sh.sessions.pop_back();
+        ++sh.version;
+        break;
+    }
+    // A pending update of a closed session is never reported
+    sh.outbox.erase(std::remove_if(sh.outbox.begin(), sh.outbox.end(),
+                                   [id](const std::shared_ptr<Session>& s) { return s->id == id; }),
+                    sh.outbox.end());
+}
+
+size_t AnalyzerPool::pushMany(const PushItem* items, size_t count) {
+    if (!items || count == 0) return 0;
+    // Resolve ids under the registry lock, push outside it: a BLOCK-policy queue may wait on its
+    // worker, which must not hold up open()/close() or other producers
+    static thread_local std::vector<std::shared_ptr<Session>> targets;
+    targets.assign(count, nullptr);
+    {
+        std::shared_lock<std::shared_mutex> lk(registryMutex_);
+        for (size_t i = 0; i < count; ++i) {
+            auto f = registry_.find(items[i].id);
+            if (f != registry_.end()) targets[i] = f->second;
+        }
+    }
+    size_t delivered = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const PushItem& it = items[i];
+        if (!targets[i]) { ++unknownPushes_; continue; }
+        if (it.timestamps) targets[i]->rt->push(it.samples, it.timestamps, it.n);
+        else targets[i]->rt->push(it.samples, it.n);
+        ++delivered;
+    }
+    targets.clear();   // a closed session is freed once its last reference goes
+    return delivered;
+}
+
+size_t AnalyzerPool::pollMany(std::vector<PollResult>& out) {
+    out.clear();
+    std::vector<std::shared_ptr<Session>> ready;
+    for (auto& shp : shards_) {
+        {
+            std::lock_guard<std::mutex> lk(shp->mutex);
+            ready.swap(shp->outbox);
+        }
+        for (auto& s : ready) {
+            std::lock_guard<std::mutex> lk(s->outMutex);
+            out.push_back(PollResult{s->id, std::move(s->latest)});
+            s->pending = false;
+        }
+        ready.clear();
+    }
+    return out.size();
+}
+
+PoolStats AnalyzerPool::stats() const {
+    PoolStats st;
+    {
+        std::shared_lock<std::shared_mutex> lk(registryMutex_);
+        st.sessions = registry_.size();
+        st.bytesReserved = bytesReserved_;
+        for (const auto& kv : registry_) st.bytesUsed += kv.second->rt->bytesUsed();
+    }
+    st.updatesTotal = updatesTotal_.load(std::memory_order_relaxed);
+    st.sweepsTotal = sweepsTotal_.load(std::memory_order_relaxed);
+    st.rejectedOpensTotal = rejectedOpens_.load(std::memory_order_relaxed);
+    st.unknownPushesTotal = unknownPushes_.load(std::memory_order_relaxed);
+    return st;
+}
+
+void AnalyzerPool::workerLoop(size_t shardIdx) {
+    Shard& sh = *shards_[shardIdx];
+    const auto sweep = std::chrono::duration<double>(cfg_.sweepSeconds);
+    std::vector<std::shared_ptr<Session>> local;
+    unsigned long long seen = ~0ULL;
+    HeartMetrics m;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(stopMutex_);
+            stopCv_.wait_for(lk, sweep, [this]{ return stop_; });
+            if (stop_) return;
+        }
+        {
+            // Re-copy the shard's session list only when it changed
+            std::lock_guard<std::mutex> lk(sh.mutex);
+            if (sh.version != seen) { local = sh.sessions; seen = sh.version; }
+        }
+        for (auto& s : local) {
+            // Drains the session's queue; runs the analysis only if its update interval is due
+            if (!s->rt->poll(m)) continue;
+            updatesTotal_.fetch_add(1, std::memory_order_relaxed);
+            bool first;
+            {
+                std::lock_guard<std::mutex> lk(s->outMutex);
+                s->latest = std::move(m);
+                first = !s->pending;
+                s->pending = true;
+            }
+            if (first) {
+                std::lock_guard<std::mutex> lk(sh.mutex);
+                if (!s->closed) sh.outbox.push_back(s);
+            }
+        }
+        sweepsTotal_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace heartpy
@@ -0,0 +1,110 @@
+// Multi-session analyzer manager: many RealtimeAnalyzer sessions sharded over a fixed worker pool
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include "heartpy_stream.h"
+
+namespace heartpy {
+
+using SessionId = std::uint64_t; // 0 is never a valid session
+
+struct PoolConfig {
+    int workers = 0;                       // 0 = hardware concurrency
+    double sweepSeconds = 0.02;            // worker cadence between sweeps over its shard
+    size_t sessionMemoryBudgetBytes = 0;   // 0 = unlimited; open() rejects sessions estimated above it
+    size_t globalMemoryBudgetBytes = 0;    // 0 = unlimited; open() rejects once the pool would exceed it
+};
+
+struct PoolStats {
+    size_t sessions = 0;
+    size_t bytesReserved = 0;              // sum of per-session estimates
+    size_t bytesUsed = 0;                  // sum of measured RealtimeAnalyzer::bytesUsed()
+    unsigned long long updatesTotal = 0;   // analysis updates produced by workers
+    unsigned long long sweepsTotal = 0;
+    unsigned long long rejectedOpensTotal = 0;
+    unsigned long long unknownPushesTotal = 0; // pushes addressed to closed/unknown sessions
+};
+
+// Owns sessions and drives them on a fixed set of worker threads. Each session ingests through
+// its own SPSC queue (Options::useIngestQueue is forced on), so pushMany() never runs DSP and
+// holds no pool lock while pushing: under BLOCK backpressure a full queue waits for that session's
+// worker only (close() releases it). Pushes for a given session must come from one thread at a time.
+// Workers sweep their shard, run whichever polls are due and leave the newest update per session
+// for pollMany().
+class AnalyzerPool {
+public:
+    explicit AnalyzerPool(const PoolConfig& cfg = {});
+    ~AnalyzerPool();
+    AnalyzerPool(const AnalyzerPool&) = delete;
+    AnalyzerPool& operator=(const AnalyzerPool&) = delete;
+
+    // Returns 0 if a memory budget would be exceeded
+    SessionId open(double fs, const Options& opt = {}, double windowSec = 60.0);
+    void close(SessionId id);
+    // Session migration: checkpoint() returns an empty blob for unknown ids; restore() opens a
+    // session from a blob (0 if malformed or over budget). Restored sessions reserve their
+    // measured footprint.
+    std::vector<uint8_t> checkpoint(SessionId id);
+    SessionId restore(const uint8_t* data, size_t n);
+
+    struct PushItem {
+        SessionId id;
+        const float* samples;
+        const double* timestamps;          // optional (nullptr = nominal fs timebase)
+        size_t n;
+    };
+    // Returns the number of items delivered to live sessions
+    size_t pushMany(const PushItem* items, size_t count);
+
+    struct PollResult {
+        SessionId id;
+        HeartMetrics metrics;
+    };
+    // Moves out the newest pending update of every session that produced one; returns the count
+    size_t pollMany(std::vector<PollResult>& out);
+
+    PoolStats stats() const;
+    // Conservative planned footprint of one session (used for budget checks)
+    static size_t estimateSessionBytes(double fs, const Options& opt, double windowSec);
+
+private:
+    struct Session {
+        SessionId id {0};
+        size_t bytes {0};
+        std::unique_ptr<RealtimeAnalyzer> rt;
+        std::mutex outMutex;
+        HeartMetrics latest;
+        bool pending {false};
+        bool closed {false};                            // guarded by the shard mutex
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Session>> sessions;
+        std::vector<std::shared_ptr<Session>> outbox;   // live sessions with a pending update
+        unsigned long long version {0};                 // bumped on open/close
+    };
+    void workerLoop(size_t shardIdx);
+    SessionId admit(std::shared_ptr<Session> s);
+
+    PoolConfig cfg_ {};
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::thread> workers_;
+    mutable std::shared_mutex registryMutex_;
+    std::unordered_map<SessionId, std::shared_ptr<Session>> registry_;
+    std::atomic<SessionId> nextId_ {1};
+    size_t bytesReserved_ {0};                         // guarded by registryMutex_
+    std::mutex stopMutex_;
+    std::condition_variable stopCv_;
+    bool stop_ {false};
+    std::atomic<unsigned long long> updatesTotal_ {0}, sweepsTotal_ {0}, rejectedOpens_ {0}, unknownPushes_ {0};
+};
+
+} // namespace heartpy
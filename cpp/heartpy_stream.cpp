@@ -3,6 +3,11 @@
 #include <deque>
 #include <cmath>
 #include <cassert>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <type_traits>
 
 namespace heartpy {
 
@@ -26,6 +31,15 @@ static inline size_t safeSizeMul(double a, double b, size_t cap) {
     size_t v = static_cast<size_t>(prod);
     return (v > cap) ? cap : v;
 }
+
+// Footprint helpers (std::deque allocates fixed blocks; libstdc++ uses 512 bytes)
+template <typename T>
+static inline size_t vecBytes(const std::vector<T>& v) { return v.capacity() * sizeof(T); }
+template <typename T>
+static inline size_t dequeBytes(const std::deque<T>& d) {
+    const size_t per = std::max<size_t>(1, 512 / sizeof(T));
+    return (d.size() / per + 1) * 512;
+}
 static constexpr double MAX_WINDOW_SEC = 300.0; // acceptance memory limit
 
 #ifdef HEARTPY_LOCK_TIMING
@@ -68,6 +82,36 @@ static std::vector<double> rollingMeanHP_local(const std::vector<double>& data,
     return out;
 }
 
+// Window min/max in one branch-free pass over four independent lanes
+static void minMaxOf(const std::vector<double>& v, double& lo, double& hi) {
+    const size_t n = v.size();
+    double mn[4] = {v[0], v[0], v[0], v[0]}, mx[4] = {v[0], v[0], v[0], v[0]};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        for (int k = 0; k < 4; ++k) { mn[k] = v[i + k] < mn[k] ? v[i + k] : mn[k]; mx[k] = mx[k] < v[i + k] ? v[i + k] : mx[k]; }
+    for (; i < n; ++i) { mn[0] = v[i] < mn[0] ? v[i] : mn[0]; mx[0] = mx[0] < v[i] ? v[i] : mx[0]; }
+    lo = std::min(std::min(mn[0], mn[1]), std::min(mn[2], mn[3]));
+    hi = std::max(std::max(mx[0], mx[1]), std::max(mx[2], mx[3]));
+}
+
+// Mean of rollingMeanHP_local(data, ...) without building it: each sample weighs by the number
+// of full windows covering it, plus the edge-padded head and tail
+static double rollingMeanHPAvg_local(const std::vector<double>& data, double fs, double windowSeconds) {
+    const int N = static_cast<int>(windowSeconds * fs);
+    const int n = static_cast<int>(data.size());
+    if (n == 0) return 0.0;
+    double total = 0.0; for (double v : data) total += v;
+    if (N <= 1 || N > n) return total / n;
+    const int m = std::min(N, n - N + 1);   // weight of the middle samples
+    double sumRol = m * total;
+    for (int j = 0; j < m - 1; ++j) sumRol -= (double)(m - 1 - j) * (data[j] + data[n - 1 - j]);
+    sumRol /= N;
+    double first = 0.0, last = 0.0;
+    for (int j = 0; j < N; ++j) { first += data[j]; last += data[n - N + j]; }
+    const int nMiss = (N - 1) / 2;
+    return (nMiss * (first / N) + sumRol + (N - 1 - nMiss) * (last / N)) / n;
+}
+
 static std::vector<int> detectPeaksHP_local(const std::vector<double>& x, const std::vector<double>& rol_mean, double ma_perc, double fs) {
     const int n = static_cast<int>(x.size());
     if (n == 0 || (int)rol_mean.size() != n) return {};
@@ -181,6 +225,246 @@ static inline double std_pop_vec(const std::vector<double>& v) {
 }
 static inline double round6_local(double x) { return std::round(x * 1e6) / 1e6; }
 
+// Causal streaming preprocessing (see StreamPreprocessor in heartpy_stream.h)
+void StreamPreprocessor::configure(double fs, const Options& opt) {
+    clip_ = opt.interpClipping;
+    hampel_ = opt.hampelCorrect;
+    baseline_ = opt.removeBaselineWander;
+    enhance_ = opt.enhancePeaks;
+    clipThr_ = opt.clippingThreshold;
+    // Bounded look-ahead: runs longer than ~200 ms are passed through unbridged
+    clipHoldMax_ = static_cast<size_t>(std::max(1L, std::lround(0.2 * fs)));
+    hasGood_ = false; clipUnbridged_ = false; lastGood_ = 0.0f;
+    holdV_.clear(); holdTag_.clear();
+    holdV_.reserve(clipHoldMax_ + 1); holdTag_.reserve(clipHoldMax_ + 1);
+    hampelThr_ = opt.hampelThreshold;
+    hampelRing_.assign(2 * static_cast<size_t>(std::max(0, opt.hampelWindow / 2)) + 1, 0.0f);
+    hampelSorted_.clear();
+    hampelSorted_.reserve(hampelRing_.size());
+    hampelFed_ = 0;
+    // Same one-pole recurrence and cutoff (0.5 Hz) as removeBaselineWander()
+    const double rc = 1.0 / (2.0 * 3.141592653589793 * 0.5);
+    const double dt = 1.0 / fs;
+    blAlpha_ = dt / (rc + dt);
+    blStarted_ = false; blPrevIn_ = 0.0; blPrevOut_ = 0.0;
+    enStarted_ = false; enPrev_ = 0.0;
+}
+
+size_t StreamPreprocessor::bytesUsed() const {
+    return holdV_.capacity() * sizeof(float) + holdTag_.capacity() * sizeof(double)
+         + hampelRing_.capacity() * sizeof(float) + hampelSorted_.capacity() * sizeof(float);
+}
+
+void StreamPreprocessor::process(float v, double tag, std::vector<float>& outV, std::vector<double>& outTag) {
+    if (!clip_) { emitStage2(v, tag, outV, outTag); return; }
+    if (v >= clipThr_) {
+        // Leading edge (no left anchor) or an over-long run: pass through like the batch edges
+        if (!hasGood_ || clipUnbridged_) { emitStage2(v, tag, outV, outTag); return; }
+        holdV_.push_back(v); holdTag_.push_back(tag);
+        if (holdV_.size() > clipHoldMax_) {
+            for (size_t j = 0; j < holdV_.size(); ++j) emitStage2(holdV_[j], holdTag_[j], outV, outTag);
+            holdV_.clear(); holdTag_.clear();
+            clipUnbridged_ = true;
+        }
+        return;
+    }
+    if (!holdV_.empty()) {
+        // Linear bridge between the last good sample and this one (as interpolateClipping)
+        const double denom = static_cast<double>(holdV_.size() + 1);
+        for (size_t j = 0; j < holdV_.size(); ++j) {
+            double t = static_cast<double>(j + 1) / denom;
+            emitStage2(static_cast<float>(lastGood_ + t * (v - lastGood_)), holdTag_[j], outV, outTag);
+        }
+        holdV_.clear(); holdTag_.clear();
+    }
+    clipUnbridged_ = false;
+    hasGood_ = true;
+    lastGood_ = v;
+    emitStage2(v, tag, outV, outTag);
+}
+
+void StreamPreprocessor::emitStage2(float v, double tag, std::vector<float>& outV, std::vector<double>& outTag) {
+    double y = v;
+    if (hampel_) {
+        // Rolling median/MAD over the trailing window (window size as hampelFilter)
+        const size_t W = hampelRing_.size();
+        std::vector<float>& srt = hampelSorted_;
+        float& slot = hampelRing_[hampelFed_ % W];
+        bool inStep = srt.size() == std::min(hampelFed_, W);
+        if (inStep && hampelFed_ >= W) {
+            auto it = std::lower_bound(srt.begin(), srt.end(), slot);
+            inStep = it != srt.end() && *it == slot;
+            if (inStep) srt.erase(it);
+        }
+        slot = v;
+        ++hampelFed_;
+        if (inStep && !std::isnan(v)) srt.insert(std::upper_bound(srt.begin(), srt.end(), v), v);
+        else {
+            // After restore(), or a NaN in the window
+            srt.assign(hampelRing_.begin(), hampelRing_.begin() + std::min(hampelFed_, W));
+            std::sort(srt.begin(), srt.end());
+        }
+        const size_t m = srt.size();
+        const size_t c = m / 2;
+        const float med = srt[c];
+        // MAD: the c-th smallest |u - med|. Deviations ascend going down from c-1 (a) and up from
+        // c (b), so it is a selection over two sorted sequences: find how many come from a.
+        auto a = [&](size_t i) { return std::fabs(srt[c - 1 - i] - med); };
+        auto b = [&](size_t j) { return std::fabs(srt[c + j] - med); };
+        const size_t want = c + 1;
+        size_t lo = want > m - c ? want - (m - c) : 0, hi = std::min(want, c);
+        while (lo < hi) {
+            const size_t i = (lo + hi) / 2;
+            if (b(want - i - 1) > a(i)) lo = i + 1; else hi = i;
+        }
+        const size_t j = want - lo;
+        const float mad = std::max(lo > 0 ? a(lo - 1) : 0.0f, j > 0 ? b(j - 1) : 0.0f);
+        if (std::fabs(v - med) > hampelThr_ * mad) y = med;
+    }
+    if (baseline_) {
+        double b = blStarted_ ? blAlpha_ * (blPrevOut_ + y - blPrevIn_) : y;
+        blStarted_ = true; blPrevIn_ = y; blPrevOut_ = b;
+        y = b;
+    }
+    if (enhance_) {
+        // Backward difference stands in for the batch central difference (no look-ahead)
+        double e = enStarted_ ? (y + 0.1 * (y - enPrev_)) : y;
+        enStarted_ = true; enPrev_ = y;
+        y = e;
+    }
+    outV.push_back(static_cast<float>(y));
+    outTag.push_back(tag);
+}
+
+void TimestampResampler::configure(double fs) {
+    dt_ = 1.0 / fs;
+    count_ = 0;
+    anchor_ = 0.0;
+    k_ = 0;
+}
+
+double TimestampResampler::slope(int i) const {
+    // Centred difference; one-sided at the ends of the history
+    const int lo = i > 0 ? i - 1 : i, hi = i + 1 < count_ ? i + 1 : i;
+    return hi > lo ? (x_[hi] - x_[lo]) / (t_[hi] - t_[lo]) : 0.0;
+}
+
+void TimestampResampler::emitSegment(int a, std::vector<float>& outX, std::vector<double>& outT) {
+    const double ta = t_[a], tb = t_[a + 1], h = tb - ta;
+    const double xa = x_[a], xb = x_[a + 1];
+    const bool linear = h > kLinearGap * dt_;
+    const double ma = linear ? 0.0 : slope(a) * h, mb = linear ? 0.0 : slope(a + 1) * h;
+    for (double tq = anchor_ + k_ * dt_; tq <= tb; tq = anchor_ + (++k_) * dt_) {
+        const double s = std::max(0.0, (tq - ta) / h);
+        double y;
+        if (linear) y = xa + s * (xb - xa);
+        else {
+            const double s2 = s * s, s3 = s2 * s;
+            y = (2 * s3 - 3 * s2 + 1) * xa + (s3 - 2 * s2 + s) * ma + (3 * s2 - 2 * s3) * xb + (s3 - s2) * mb;
+        }
+        outX.push_back(static_cast<float>(y));
+        outT.push_back(tq);
+    }
+}
+
+size_t TimestampResampler::process(const float* x, const double* t, size_t n, std::vector<float>& outX, std::vector<double>& outT) {
+    size_t skipped = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (count_ > 0 && !(t[i] > t_[count_ - 1])) { ++skipped; continue; }
+        if (count_ > 0 && t[i] - t_[count_ - 1] > kRestartSec) {
+            // Close the open segment, then start a new grid at this sample
+            if (count_ >= 2) emitSegment(count_ - 2, outX, outT);
+            count_ = 0;
+        }
+        if (count_ == 4) {
+            for (int j = 0; j < 3; ++j) { t_[j] = t_[j + 1]; x_[j] = x_[j + 1]; }
+            count_ = 3;
+        }
+        t_[count_] = t[i]; x_[count_] = x[i]; ++count_;
+        if (count_ == 1) { anchor_ = t[i]; k_ = 0; }
+        // The segment ending at the previous sample now has both end slopes
+        if (count_ >= 3) emitSegment(count_ - 3, outX, outT);
+    }
+    return skipped;
+}
+
+void IngestQueue::configure(size_t capacity, Options::Backpressure policy) {
+    size_t c = 2;
+    while (c < capacity) c <<= 1;
+    slots_.reset(new Slot[c]);
+    cap_ = c; mask_ = c - 1;
+    policy_ = policy;
+    tail_.store(0); claim_.store(0); head_.store(0);
+}
+
+void IngestQueue::push(const float* x, const double* ts, size_t n) {
+    const uint8_t tsFlag = ts ? kHasTs : 0;
+    size_t t = tail_.load(std::memory_order_relaxed);
+    size_t occ = t - head_.load(std::memory_order_acquire);
+    const bool decim = (policy_ == Options::Backpressure::DECIMATE) && ts && (occ + n > (cap_ / 4) * 3);
+    const size_t out = decim ? (n + 1) / 2 : n;
+    if (policy_ != Options::Backpressure::BLOCK && occ + out > cap_) {
+        // About to overwrite unread slots: raise the overwrite horizon before touching them
+        claim_.store(t + out, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    bool waited = false;
+    for (size_t i = 0; i < n; ) {
+        float v = x[i];
+        double tv = ts ? ts[i] : 0.0;
+        size_t used = 1;
+        if (decim && i + 1 < n) {
+            v = 0.5f * (x[i] + x[i + 1]); tv = 0.5 * (ts[i] + ts[i + 1]); used = 2;
+            decimated_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (policy_ == Options::Backpressure::BLOCK) {
+            while (t - head_.load(std::memory_order_acquire) >= cap_ && !released_.load(std::memory_order_acquire)) {
+                if (!waited) { waited = true; blocked_.fetch_add(1, std::memory_order_relaxed); }
+                tail_.store(t, std::memory_order_release); // let the consumer see what is written
+                std::this_thread::yield();
+            }
+            if (t - head_.load(std::memory_order_acquire) >= cap_) {
+                // Released while full: overwrite like DROP_OLDEST
+                claim_.store(t + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+            }
+        }
+        Slot& s = slots_[t & mask_];
+        s.v.store(v, std::memory_order_relaxed);
+        s.ts.store(tv, std::memory_order_relaxed);
+        s.flags.store(static_cast<uint8_t>(tsFlag | (i == 0 ? kBatchStart : 0)), std::memory_order_relaxed);
+        ++t; i += used;
+    }
+    tail_.store(t, std::memory_order_release);
+    occ = std::min(cap_, t - head_.load(std::memory_order_relaxed));
+    if (occ > highWater_.load(std::memory_order_relaxed)) highWater_.store(occ, std::memory_order_relaxed);
+}
+
+size_t IngestQueue::drain(std::vector<float>& x, std::vector<double>& ts, std::vector<uint8_t>& flags) {
+    x.clear(); ts.clear(); flags.clear();
+    size_t h = head_.load(std::memory_order_relaxed);
+    const size_t t = tail_.load(std::memory_order_acquire);
+    size_t lost = 0;
+    if (t - h > cap_) { lost += (t - cap_) - h; h = t - cap_; }
+    for (size_t i = h; i < t; ++i) {
+        const Slot& s = slots_[i & mask_];
+        x.push_back(s.v.load(std::memory_order_relaxed));
+        ts.push_back(s.ts.load(std::memory_order_relaxed));
+        flags.push_back(s.flags.load(std::memory_order_relaxed));
+    }
+    // Anything below the overwrite horizon may have been overwritten while being read
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const size_t c = claim_.load(std::memory_order_relaxed);
+    if (c > cap_ && c - cap_ > h) {
+        size_t k = std::min(t - h, c - cap_ - h);
+        x.erase(x.begin(), x.begin() + k); ts.erase(ts.begin(), ts.begin() + k); flags.erase(flags.begin(), flags.begin() + k);
+        lost += k;
+    }
+    head_.store(t, std::memory_order_release);
+    if (lost > 0 && !flags.empty()) flags[0] |= kBatchStart;
+    return lost;
+}
+
 RealtimeAnalyzer::RealtimeAnalyzer(double fs, const Options& opt)
     : fs_(fs), opt_(opt) {
     if (fs_ <= 0.0) fs_ = 50.0;
@@ -192,8 +476,17 @@ RealtimeAnalyzer::RealtimeAnalyzer(double fs, const Options& opt)
     size_t margin = 8 * static_cast<size_t>(std::ceil(fs_));
     size_t cap = safeSizeMul(windowSec_, fs_, SIZE_MAX / 4);
     cap = (cap > SIZE_MAX - margin) ? (SIZE_MAX - margin) : (cap + margin);
-    signal_.reserve(cap);
-    filt_.reserve(cap);
+    useRing_ = opt_.useRingBuffer;
+    keepRaw_ = (opt_.storageMode == Options::StorageMode::FULL);
+    quant_ = useRing_ && (opt_.storageMode == Options::StorageMode::INT16);
+    if (useRing_) {
+        // Window + one max-size batch, so a push never overwrites before trimming
+        size_t maxBatch = (size_t)std::ceil(10.0 * fs_);
+        reconfigureRings(cap + maxBatch);
+    } else {
+        if (keepRaw_) signal_.reserve(cap);
+        filt_.reserve(cap);
+    }
     effectiveFs_ = fs_;
     firstTsApprox_ = 0.0;
     lastTs_ = 0.0;
@@ -214,15 +507,80 @@ RealtimeAnalyzer::RealtimeAnalyzer(double fs, const Options& opt)
     // HP thresholding state
     maPerc_ = std::max(10.0, std::min(60.0, opt_.maPerc));
     hpThreshold_ = opt_.useHPThreshold;
+    pre_.configure(fs_, opt_);
+    resampler_.configure(fs_);
+    if (opt_.backgroundWorker) opt_.useIngestQueue = true;
+    if (opt_.useIngestQueue) {
+        ingest_.configure(safeSizeMul(std::max(0.5, opt_.ingestQueueSeconds), fs_, SIZE_MAX / 8), opt_.ingestBackpressure);
+    }
+}
+
+RealtimeAnalyzer::~RealtimeAnalyzer() {
+    if (worker_.joinable()) {
+        { std::lock_guard<std::mutex> lk(workerMutex_); workerStop_ = true; }
+        workerCv_.notify_all();
+        worker_.join();
+    }
+}
+
+void RealtimeAnalyzer::ensureWorker() {
+    if (!opt_.backgroundWorker) return;
+    std::call_once(workerOnce_, [this]{ worker_ = std::thread(&RealtimeAnalyzer::workerLoop, this); });
+}
+
+void RealtimeAnalyzer::workerLoop() {
+    // Wake at ~display rate: full publish when an update is due, display-only publish otherwise
+    const auto tick = std::chrono::milliseconds(16);
+    HeartMetrics m;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(workerMutex_);
+            workerCv_.wait_for(lk, tick, [this]{ return workerStop_; });
+            if (workerStop_) return;
+        }
+        bool updated;
+        {
+            std::lock_guard<std::mutex> ulk(updateMutex_);
+            updated = computeUpdate(m);
+        }
+        bool displayNew;
+        { std::lock_guard<std::mutex> lk(displayMutex_); displayNew = displayFresh_ || !displayStage_.empty(); }
+        if (!updated && !displayNew) continue;
+        if (updated) {
+            workerPub_.metrics = m;
+            ++workerPub_.seq;
+            std::lock_guard<std::mutex> lock(dataMutex_);
+            workerPub_.quality = lastQuality_;
+            if (peaksDirty_) buildPeakViews(&workerPub_.peaks, &workerPub_.rr);
+            else { workerPub_.peaks = lastPeaks_; workerPub_.rr = lastRR_; }
+        }
+        workerPub_.display = readDisplay();
+        snapshots_.back() = workerPub_;
+        snapshots_.publish();
+    }
+}
+
+void RealtimeAnalyzer::drainIngest() {
+    ingestDroppedTotal_ += ingest_.drain(ingX_, ingTs_, ingFlags_);
+    // Replay in the producer's original batches so results match the direct push path
+    size_t i = 0;
+    while (i < ingX_.size()) {
+        size_t j = i + 1;
+        while (j < ingX_.size() && !(ingFlags_[j] & IngestQueue::kBatchStart)) ++j;
+        if (ingFlags_[i] & IngestQueue::kHasTs) appendTs(&ingX_[i], &ingTs_[i], j - i);
+        else append(&ingX_[i], j - i);
+        i = j;
+    }
 }
 
 void RealtimeAnalyzer::setWindowSeconds(double sec) {
     std::lock_guard<std::mutex> lock(dataMutex_);
+    if (capture_) capture_->setting(CaptureEvent::Kind::WINDOW, sec);
     double clamped = std::max(1.0, std::min(MAX_WINDOW_SEC, sec));
     if (clamped != windowSec_) {
         windowSec_ = clamped;
         // Restart warm-up timing so confidence re-gates after substantive window changes
-        if ((useRing_ && ringSignal_.size() > 0) || (!useRing_ && !signal_.empty())) {
+        if (winLen() > 0) {
             warmupStartTs_ = lastTs_;
         } else {
             warmupStartTs_ = std::numeric_limits<double>::quiet_NaN();
@@ -232,22 +590,184 @@ void RealtimeAnalyzer::setWindowSeconds(double sec) {
     }
     updateSec_ = std::clamp(windowSec_ * 0.08, 0.2, 0.5);
     trimToWindow();
+    // Shrink ring storage to the new window (after trimming, so nothing live is lost)
+    if (useRing_) {
+        const double effFs = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
+        const size_t need = safeSizeMul(windowSec_, effFs, SIZE_MAX / 4) + 8 * (size_t)std::ceil(effFs) + (size_t)std::ceil(10.0 * effFs);
+        const size_t cap = quant_ ? ringQ_.capacity() : ringFilt_.capacity();
+        if (2 * need <= cap) reconfigureRings(need);
+    }
 }
 
 void RealtimeAnalyzer::setUpdateIntervalSeconds(double sec) {
     std::lock_guard<std::mutex> lock(dataMutex_);
+    if (capture_) capture_->setting(CaptureEvent::Kind::UPDATE_INTERVAL, sec);
     updateSec_ = std::max(0.1, sec);
     ++paramChangeEventsTotal_;
 }
 
+void RealtimeAnalyzer::setPsdUpdateSeconds(double sec) {
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    if (capture_) capture_->setting(CaptureEvent::Kind::PSD_UPDATE, sec);
+    psdUpdateSec_ = std::clamp(sec, 0.5, 5.0);
+}
+
+void RealtimeAnalyzer::setDisplayHz(double hz) {
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    if (capture_) capture_->setting(CaptureEvent::Kind::DISPLAY_HZ, hz);
+    displayHz_ = std::clamp(hz, 10.0, 120.0);
+}
+
+void RealtimeAnalyzer::applyPresetTorch() {
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    if (capture_) capture_->setting(CaptureEvent::Kind::PRESET_TORCH, 0.0);
+    opt_.lowHz = 0.7; opt_.highHz = 3.0; opt_.refractoryMs = std::max(300.0, opt_.refractoryMs); opt_.useHPThreshold = true; opt_.maPerc = std::max(10.0, std::min(60.0, opt_.maPerc));
+}
+
+void RealtimeAnalyzer::applyPresetAmbient() {
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    if (capture_) capture_->setting(CaptureEvent::Kind::PRESET_AMBIENT, 0.0);
+    opt_.lowHz = 0.5; opt_.highHz = 3.5; opt_.thresholdScale = std::max(0.5, opt_.thresholdScale); opt_.refractoryMs = std::max(320.0, opt_.refractoryMs); opt_.useHPThreshold = true; opt_.maPerc = std::max(10.0, std::min(60.0, opt_.maPerc));
+}
+
+bool RealtimeAnalyzer::preprocessBatch(const float*& x, const double*& ts, size_t& n) {
+    if (!pre_.active()) return true;
+    preOut_.clear(); preOutTs_.clear();
+    for (size_t i = 0; i < n; ++i) pre_.process(x[i], ts ? ts[i] : 0.0, preOut_, preOutTs_);
+    x = preOut_.data();
+    if (ts) ts = preOutTs_.data();
+    n = preOut_.size();
+    return n > 0;
+}
+
+size_t RealtimeAnalyzer::storeRaw(const float* x, size_t n) {
+    const size_t prevLen = winLen();
+    if (!useRing_) {
+        if (keepRaw_) signal_.insert(signal_.end(), x, x + n);
+        filt_.resize(prevLen + n);
+        return prevLen;
+    }
+    // Grow (rarely: larger window or faster effective fs) rather than overwrite unread samples
+    const size_t cap = quant_ ? ringQ_.capacity() : ringFilt_.capacity();
+    if (prevLen + n > cap) reconfigureRings(2 * (prevLen + n));
+    if (keepRaw_) ringSignal_.push_back_many(x, n);
+    return prevLen;
+}
+
+void RealtimeAnalyzer::storeFilt(size_t rel, float y) {
+    if (!useRing_) { filt_[rel] = y; return; }
+    if (!quant_) { ringFilt_.push_back(y); return; } // rel == winLen(): filtered samples arrive in order
+    float a = std::fabs(y);
+    if (!(a < 32767.0f * qScale_) && std::isfinite(a)) {
+        int e = qExp_;
+        while (e < 30 && !(a < std::ldexp(32767.0f, e))) ++e;
+        requantize(e);
+    }
+    float q = std::nearbyint(y / qScale_);
+    ringQ_.push_back(static_cast<int16_t>(std::clamp(q, -32767.0f, 32767.0f)));
+}
+
+void RealtimeAnalyzer::reconfigureRings(size_t cap) {
+    if (keepRaw_) ringSignal_.reconfigure(cap);
+    if (quant_) ringQ_.reconfigure(cap);
+    else ringFilt_.reconfigure(cap);
+}
+
+void RealtimeAnalyzer::requantize(int exp) {
+    if (exp == qExp_) return;
+    const int shift = exp - qExp_;
+    for (size_t i = 0; i < ringQ_.size(); ++i) {
+        int v = ringQ_.at(i);
+        // Coarser: round-half-away shift; finer: exact (caller checked the range)
+        if (shift > 0) v = (v >= 0 ? (v + (1 << (shift - 1))) >> shift : -((-v + (1 << (shift - 1))) >> shift));
+        else v = v * (1 << -shift);
+        ringQ_.at(i) = static_cast<int16_t>(std::clamp(v, -32767, 32767));
+    }
+    qExp_ = exp;
+    qScale_ = std::ldexp(1.0f, exp);
+}
+
+void RealtimeAnalyzer::buildPeakViews(std::vector<int>* peaks, std::vector<double>* rr) const {
+    if (peaks) { peaks->clear(); peaks->reserve(peaksAbs_.size()); }
+    if (rr) { rr->clear(); rr->reserve(peaksAbs_.size()); }
+    for (size_t j = 0; j < peaksAbs_.size(); ++j) {
+        if (peaks) peaks->push_back(static_cast<int>(peaksAbs_[j] - firstAbs_));
+        if (rr && j > 0) {
+            double dt = static_cast<double>(peaksAbs_[j] - peaksAbs_[j - 1]) / peaksViewFs_;
+            rr->push_back(dt * 1000.0);
+        }
+    }
+}
+
+void RealtimeAnalyzer::materializePeaks() {
+    if (!peaksDirty_) return;
+    buildPeakViews(&lastPeaks_, &lastRR_);
+    // Same value nth_element would give: ms conversion is monotone in the sample gap
+    lastRRMedian_ = rrIntervals_.empty() ? 0.0 : static_cast<double>(rrIntervals_.median()) / peaksViewFs_ * 1000.0;
+    peaksDirty_ = false;
+}
+
+void RealtimeAnalyzer::pushPeakAbs(size_t absIdx) {
+    if (!peaksAbs_.empty()) rrIntervals_.insert(absIdx - peaksAbs_.back());
+    peaksAbs_.push_back(absIdx);
+}
+
+void RealtimeAnalyzer::replaceLastPeakAbs(size_t absIdx) {
+    const size_t n = peaksAbs_.size();
+    if (n >= 2) {
+        rrIntervals_.erase(peaksAbs_[n - 1] - peaksAbs_[n - 2]);
+        rrIntervals_.insert(absIdx - peaksAbs_[n - 2]);
+    }
+    peaksAbs_.back() = absIdx;
+}
+
+void RealtimeAnalyzer::popFrontPeakAbs() {
+    if (peaksAbs_.size() >= 2) rrIntervals_.erase(peaksAbs_[1] - peaksAbs_[0]);
+    peaksAbs_.pop_front();
+}
+
+void RealtimeAnalyzer::rebuildRRIntervals() {
+    rrIntervals_.clear();
+    for (size_t j = 1; j < peaksAbs_.size(); ++j) rrIntervals_.insert(peaksAbs_[j] - peaksAbs_[j - 1]);
+}
+
+double RealtimeAnalyzer::rrQuantile(double q) const {
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    if (rrIntervals_.empty()) return 0.0;
+    const double fs = peaksViewFs_ > 0.0 ? peaksViewFs_ : (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
+    return static_cast<double>(rrIntervals_.quantile(q)) / fs * 1000.0;
+}
+
+std::vector<int> RealtimeAnalyzer::latestPeaks() const {
+    if (opt_.backgroundWorker) { snapshots_.refresh(); return snapshots_.front().peaks; }
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    if (!peaksDirty_) return lastPeaks_;
+    std::vector<int> p; buildPeakViews(&p, nullptr); return p;
+}
+
+QualityInfo RealtimeAnalyzer::getQuality() const {
+    if (opt_.backgroundWorker) { snapshots_.refresh(); return snapshots_.front().quality; }
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    return lastQuality_;
+}
+
+std::vector<double> RealtimeAnalyzer::latestRR() const {
+    if (opt_.backgroundWorker) { snapshots_.refresh(); return snapshots_.front().rr; }
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    if (!peaksDirty_) return lastRR_;
+    std::vector<double> r; buildPeakViews(nullptr, &r); return r;
+}
+
 void RealtimeAnalyzer::append(const float* x, size_t n) {
     if (!x || n == 0) return;
+    if (capture_) capture_->append(x, nullptr, n);
+    // Causal preprocessing; clipped runs may be held back until bridged
+    const double* noTs = nullptr;
+    if (!preprocessBatch(x, noTs, n)) return;
     // Append and process new samples incrementally
-    const size_t prevLen = signal_.size();
-    signal_.insert(signal_.end(), x, x + n);
-    const size_t newLen = signal_.size();
-    if (filt_.size() < prevLen) filt_.resize(prevLen);
-    if (signal_.size() > filt_.size()) filt_.resize(signal_.size());
+    markBatchEntry();
+    const size_t prevLen = storeRaw(x, n);
+    const size_t newLen = prevLen + n;
     // timebase (nominal fs)
     if (prevLen == 0) {
         firstTsApprox_ = 0.0;
@@ -258,7 +778,7 @@ void RealtimeAnalyzer::append(const float* x, size_t n) {
     }
     // Process new portion
     for (size_t i = prevLen; i < newLen; ++i) {
-        float s = signal_[i];
+        float s = x[i - prevLen];
         bool useD = opt_.highPrecision || opt_.deterministic;
         float yout;
         if (useD && !bqD_.empty()) {
@@ -270,7 +790,8 @@ void RealtimeAnalyzer::append(const float* x, size_t n) {
             for (auto &bi : bq_) y = bi.process(y);
             yout = y;
         }
-        filt_[i] = yout;
+        storeFilt(i, yout);
+        feedDisplay(yout, (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_));
         // rolling window update
         rollWin_.push_back(yout);
         rollSum_ += yout;
@@ -299,9 +820,9 @@ void RealtimeAnalyzer::append(const float* x, size_t n) {
         // incremental local-max detection using 1-sample look-ahead
         size_t k = i;
         if (k >= 2) {
-            float y2 = filt_[k - 2];
-            float y1 = filt_[k - 1];
-            float y0 = filt_[k - 0];
+            float y2 = filtAt(k - 2);
+            float y1 = filtAt(k - 1);
+            float y0 = filtAt(k - 0);
             if (y1 > y2 && y1 >= y0) {
                 int nwin = static_cast<int>(rollWin_.size());
                 double mean = (nwin > 0 ? (rollSum_ / nwin) : 0.0);
@@ -346,10 +867,8 @@ void RealtimeAnalyzer::append(const float* x, size_t n) {
                         if (softDoublingActive_ || doublingActive_ || doublingHintActive_) {
                             double longEst = 0.0;
                             if (doublingLongRRms_ > 0.0) longEst = std::max(longEst, doublingLongRRms_);
-                            if (!lastRR_.empty()) {
-                                double med = medianOfRR(lastRR_);
-                                longEst = std::max(longEst, 2.0 * med);
-                            }
+                            materializePeaks();
+                            if (!lastRR_.empty()) longEst = std::max(longEst, 2.0 * lastRRMedian_);
                             if (lastF0Hz_ > 1e-9) longEst = std::max(longEst, 1000.0 / lastF0Hz_);
                             if (longEst > 0.0) {
                                 longEst = std::clamp(longEst, 600.0, opt_.minRRCeiling);
@@ -368,7 +887,7 @@ void RealtimeAnalyzer::append(const float* x, size_t n) {
                         if (rr_new_ms < min_rr_ms) {
                             // strongest exception
                             size_t relLast = lastAbs >= firstAbs_ ? (lastAbs - firstAbs_) : 0;
-                            float lastVal = (relLast < filt_.size() ? filt_[relLast] : y1);
+                            float lastVal = (relLast < winLen() ? filtAt(relLast) : y1);
                             double lastCmp = lastVal;
                             if (hpThreshold_) {
                                 double vmin2 = y1, vmax2 = y1; for (float vv : rollWin_) { if (vv < vmin2) vmin2 = vv; if (vv > vmax2) vmax2 = vv; }
@@ -403,10 +922,12 @@ void RealtimeAnalyzer::append(const float* x, size_t n) {
                         lastMinRRBoundMs_ = min_rr_ms;
                     }
                     if (allowPeak) {
+                        materializePeaks(); // views reflect peaks up to the last trim
                         if (peaksAbs_.empty()) {
-                            peaksAbs_.push_back(absIdx);
+                            pushPeakAbs(absIdx);
                             lastAcceptedAmpCmp_ = y1Cmp;
                             ++acceptedPeaksTotal_;
+                            emitBeat(BeatEvent::Kind::ACCEPTED, y1, effFsLoc);
                         } else {
                             size_t lastAbs = peaksAbs_.back();
                             // dynamic base refractory + temporary extras, with hard fallback boost
@@ -420,20 +941,24 @@ void RealtimeAnalyzer::append(const float* x, size_t n) {
                                 refractoryNow = std::max(refractoryNow, fallbackRef);
                             }
                             if ((absIdx - lastAbs) >= (size_t)std::max(1, refractoryNow)) {
-                                peaksAbs_.push_back(absIdx);
+                                pushPeakAbs(absIdx);
                                 lastAcceptedAmpCmp_ = y1Cmp;
                                 ++acceptedPeaksTotal_;
+                                emitBeat(BeatEvent::Kind::ACCEPTED, y1, effFsLoc);
                             } else {
                                 // strongest-within-refractory: replace if stronger
                                 size_t relLast = lastAbs >= firstAbs_ ? (lastAbs - firstAbs_) : 0;
-                                float lastVal = (relLast < filt_.size() ? filt_[relLast] : y1);
+                                float lastVal = (relLast < winLen() ? filtAt(relLast) : y1);
                                 double lastCmp = lastVal;
                                 if (hpThreshold_) {
                                     double vmin = y1, vmax = y1; for (float vv : rollWin_) { if (vv < vmin) vmin = vv; if (vv > vmax) vmax = vv; }
                                     double den2 = std::max(1e-6, vmax - vmin);
                                     lastCmp = (lastVal - vmin) / den2 * 1024.0;
                                 }
-                                if (y1Cmp > lastCmp) peaksAbs_.back() = absIdx;
+                                if (y1Cmp > lastCmp) {
+                                    replaceLastPeakAbs(absIdx);
+                                    emitBeat(BeatEvent::Kind::REPLACED, y1, effFsLoc);
+                                }
                             }
                         }
                     }
@@ -442,68 +967,635 @@ void RealtimeAnalyzer::append(const float* x, size_t n) {
         }
         ++totalAbs_;
     }
-    // Rebuild downsampled display buffer (simple decimation)
-    const double effFs = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
-    int stride = std::max(1, (int)std::lround(effFs / std::max(10.0, displayHz_)));
-    displayBuf_.clear();
-    if (useRing_) {
-        std::vector<float> tmp; ringFilt_.snapshot(tmp);
-        displayBuf_.reserve(tmp.size() / stride + 1);
-        for (size_t idx = 0; idx < tmp.size(); idx += (size_t)stride) displayBuf_.push_back(tmp[idx]);
+    trimToWindow();
+    publishDisplay();
+}
+
+void RealtimeAnalyzer::setBeatCallback(std::function<void(const BeatEvent&)> cb) {
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    beatCb_ = std::move(cb);
+}
+
+void RealtimeAnalyzer::emitBeat(BeatEvent::Kind kind, float amp, double effFs) {
+    const size_t abs = peaksAbs_.back();
+    if (kind == BeatEvent::Kind::ACCEPTED || beatTracks_.empty()) {
+        beatTracks_.push_back(BeatTrack{abs, entryWallOf(abs), 0, false, false});
     } else {
-        displayBuf_.reserve(filt_.size() / stride + 1);
-        for (size_t idx = 0; idx < filt_.size(); idx += (size_t)stride) displayBuf_.push_back(filt_[idx]);
+        BeatTrack& t = beatTracks_.back();
+        if (!t.polled) t.entryWall = entryWallOf(abs);
+        t.abs = abs;
+        ++t.revisions;
     }
-    trimToWindow();
+    if (!beatCb_) return;
+    BeatEvent e;
+    e.kind = kind;
+    e.absIndex = peaksAbs_.back();
+    e.timestamp = firstTsApprox_ + (static_cast<double>(e.absIndex) - static_cast<double>(firstAbs_)) / effFs;
+    e.amplitude = amp;
+    const size_t n = peaksAbs_.size();
+    if (n >= 2) e.rrMs = static_cast<double>(e.absIndex - peaksAbs_[n - 2]) * 1000.0 / effFs;
+    beatCb_(e);
+}
+
+static inline double steadySeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Latency buckets (ms, upper bounds) and revision buckets (0..4+)
+static const double kBeatLatencyEdgesMs[] = {50, 100, 200, 300, 500, 750, 1000, 1500, 2000, 3000, 5000};
+static const size_t kBeatLatencyBuckets = sizeof(kBeatLatencyEdgesMs) / sizeof(kBeatLatencyEdgesMs[0]) + 1;
+static const size_t kBeatRevisionBuckets = 5;
+
+void RealtimeAnalyzer::markBatchEntry() {
+    const double now = steadySeconds();
+    if (!batchEntry_.empty() && batchEntry_.back().first == totalAbs_) batchEntry_.back().second = now;
+    else batchEntry_.emplace_back(totalAbs_, now);
+}
+
+double RealtimeAnalyzer::entryWallOf(size_t absIdx) const {
+    auto it = std::upper_bound(batchEntry_.begin(), batchEntry_.end(), absIdx,
+                               [](size_t a, const std::pair<size_t, double>& b) { return a < b.first; });
+    if (it == batchEntry_.begin()) return std::numeric_limits<double>::quiet_NaN();
+    return std::prev(it)->second;
+}
+
+void RealtimeAnalyzer::advanceMaCandidates(const std::vector<double>& win, double rmeanAvg, double wden,
+                                           size_t firstAbsSnap, double fsEff) {
+    if (maCands_.empty()) {
+        // candidate ma_perc grid (expanded)
+        for (double ma : {10.0, 15.0, 20.0, 25.0, 30.0, 35.0, 40.0, 50.0, 60.0}) { MaCandidate c; c.ma = ma; maCands_.push_back(c); }
+    }
+    const size_t n = win.size();
+    const int N = static_cast<int>(0.75 * fsEff);   // rollingMeanHP_local span
+    if (N <= 1 || (size_t)N > n) return;
+    // The rolling mean is centered: only [nMiss, n - N + nMiss] is free of edge padding
+    const size_t nMiss = static_cast<size_t>(N - 1) / 2;
+    const size_t lastOk = n - (size_t)N + nMiss;
+    // Lift in raw units is (mean rolling mean - window min) * ma/100. Cached threshold decisions
+    // stand while it drifts slowly; a large move (e.g. a transient leaving the window) rescans.
+    const double basis = rmeanAvg / 1024.0 * wden;
+    if (!(maLiftRef_ > 0.0) || std::fabs(basis - maLiftRef_) > 0.25 * maLiftRef_) {
+        for (MaCandidate& c : maCands_) {
+            c.inRun = false; c.havePend = false;
+            c.peaks.clear(); c.gapSum = 0.0; c.gapSumSq = 0.0;
+        }
+        maEvalAbs_ = 0;
+        maLiftRef_ = basis;
+    }
+    const bool gap = maEvalAbs_ < firstAbsSnap + nMiss;   // first call, or the window moved past us
+    if (gap) maEvalAbs_ = firstAbsSnap + nMiss;
+    for (MaCandidate& c : maCands_) {
+        if (gap) c.inRun = false;
+        while (!c.peaks.empty() && c.peaks.front() < firstAbsSnap) {
+            if (c.peaks.size() >= 2) { double g = (double)(c.peaks[1] - c.peaks[0]); c.gapSum -= g; c.gapSumSq -= g * g; }
+            c.peaks.pop_front();
+        }
+        if (c.peaks.empty()) { c.gapSum = 0.0; c.gapSumSq = 0.0; }
+        if (c.havePend && c.pend < firstAbsSnap) c.havePend = false;
+    }
+    const double liftUnit = rmeanAvg / 100.0;
+    const double scale = 1024.0 / wden;
+    const size_t from = maEvalAbs_ - firstAbsSnap;
+    // Raw window sum behind sample i's rolling mean, slid along with i
+    double rs = 0.0;
+    if (from <= lastOk) for (size_t j = from - nMiss; j < from - nMiss + (size_t)N; ++j) rs += win[j];
+    for (size_t i = from; i <= lastOk; ++i) {
+        if (i > from) rs += win[i - nMiss + N - 1] - win[i - nMiss - 1];
+        const double d = (win[i] - rs / N) * scale;
+        const size_t absI = firstAbsSnap + i;
+        for (MaCandidate& c : maCands_) {
+            if (d > liftUnit * c.ma) {
+                if (!c.inRun) { c.inRun = true; c.runBest = absI; c.runBestVal = win[i]; }
+                else if (win[i] > c.runBestVal) { c.runBest = absI; c.runBestVal = win[i]; }
+                continue;
+            }
+            if (!c.inRun) continue;
+            c.inRun = false;
+            // Run closed: consolidate with the pending peak (keep strongest within refractory)
+            if (c.havePend && (long long)(c.runBest - c.pend) <= refractorySamples_) {
+                if (c.runBestVal > c.pendVal) { c.pend = c.runBest; c.pendVal = c.runBestVal; }
+                continue;
+            }
+            if (c.havePend) {
+                if (!c.peaks.empty()) { double g = (double)(c.pend - c.peaks.back()); c.gapSum += g; c.gapSumSq += g * g; }
+                c.peaks.push_back(c.pend);
+            }
+            c.havePend = true; c.pend = c.runBest; c.pendVal = c.runBestVal;
+        }
+    }
+    maEvalAbs_ = firstAbsSnap + lastOk + 1;
+}
+
+void RealtimeAnalyzer::trackPolledBeats(const std::vector<int>& peakRel, size_t firstAbsSnap, double effFs) {
+    if (beatLatencyHist_.size() != kBeatLatencyBuckets) beatLatencyHist_.assign(kBeatLatencyBuckets, 0);
+    if (beatRevisionHist_.size() != kBeatRevisionBuckets) beatRevisionHist_.assign(kBeatRevisionBuckets, 0);
+    const double now = steadySeconds();
+    const size_t tol = (size_t)std::max(1L, std::lround(0.06 * effFs));
+    auto addLatency = [&](double entry) {
+        if (!std::isfinite(entry)) return;
+        const double ms = std::max(0.0, (now - entry) * 1000.0);
+        size_t b = 0;
+        while (b + 1 < kBeatLatencyBuckets && ms > kBeatLatencyEdgesMs[b]) ++b;
+        ++beatLatencyHist_[b];
+    };
+    // Both lists are ascending: merge, matching reported beats to output peaks within tol
+    std::vector<BeatTrack>& merged = beatTracksNext_;
+    merged.clear();
+    size_t j = 0;
+    for (auto& t : beatTracks_) {
+        while (j < peakRel.size() && firstAbsSnap + (size_t)peakRel[j] + tol < t.abs) {
+            const size_t a = firstAbsSnap + (size_t)peakRel[j++];
+            addLatency(entryWallOf(a));
+            merged.push_back(BeatTrack{a, entryWallOf(a), 0, true, false});
+        }
+        if (t.abs >= firstAbsSnap && j < peakRel.size() && firstAbsSnap + (size_t)peakRel[j] <= t.abs + tol) {
+            const size_t a = firstAbsSnap + (size_t)peakRel[j++];
+            if (!t.polled) { addLatency(t.entryWall); t.polled = true; }
+            else if (a != t.abs || t.removed) ++t.revisions;
+            t.abs = a;
+            t.removed = false;
+        } else if (t.polled && !t.removed && t.abs >= firstAbsSnap) {
+            ++t.revisions;   // reported earlier, gone from this output
+            t.removed = true;
+        }
+        merged.push_back(t);
+    }
+    for (; j < peakRel.size(); ++j) {
+        const size_t a = firstAbsSnap + (size_t)peakRel[j];
+        addLatency(entryWallOf(a));
+        merged.push_back(BeatTrack{a, entryWallOf(a), 0, true, false});
+    }
+    beatTracks_.swap(merged);
+    // Finalize beats that left the window; never-confirmed provisional beats count as revised
+    size_t gone = 0;
+    for (; gone < beatTracks_.size() && beatTracks_[gone].abs < firstAbs_; ++gone) {
+        const BeatTrack& t = beatTracks_[gone];
+        const int r = t.revisions + (t.polled ? 0 : 1);
+        ++beatRevisionHist_[std::min<size_t>((size_t)r, kBeatRevisionBuckets - 1)];
+    }
+    beatTracks_.erase(beatTracks_.begin(), beatTracks_.begin() + gone);
+}
+
+void RealtimeAnalyzer::commitAuditCounters(QualityInfo& q) {
+    q.droppedSamplesTotal = droppedSamplesTotal_;
+    q.clampedBatchesTotal = clampedBatchesTotal_;
+    q.oomPreventedTotal = oomPreventedTotal_;
+    q.paramChangeEventsTotal = paramChangeEventsTotal_;
+    q.mergeBudgetExhausted = lastMergeBudgetExhausted_ ? 1 : 0;
+    q.mergeBudgetExhaustedTotal = mergeBudgetExhaustedTotal_;
+    q.droppedSamplesLast = droppedSamplesLast_;
+    q.clampedBatchesLast = clampedBatchesLast_;
+    q.timestampBacktrackEventsTotal = timestampBacktrackEventsTotal_;
+    q.timestampsSkippedTotal = timestampsSkippedTotal_;
+    q.timeJumpEventsTotal = timeJumpEventsTotal_;
+    q.droppingActive = (dropConsecPolls_ >= 2) ? 1 : 0;
+    q.ingestDroppedTotal = ingestDroppedTotal_;
+    q.ingestDecimatedTotal = ingest_.decimatedTotal();
+    q.ingestBlockedTotal = ingest_.blockedTotal();
+    q.ingestQueueHighWater = ingest_.highWater();
+    lastMergeBudgetExhausted_ = 0; // reset per-poll flag
+    droppedSamplesLast_ = 0; clampedBatchesLast_ = 0; // reset per-poll last counters
+}
+
+void RealtimeAnalyzer::governorBegin() {
+    pollStages_ = 0;
+    psdScale_ = 1.0; maScale_ = 1.0; reuseBatch_ = false;
+    govLevelActive_ = 0;
+    if (!(opt_.pollBudgetMs > 0.0)) return;
+    // Stable signal (confident, steady RR): retuning and frequent PSD buy nothing
+    bool stable = false;
+    if (lastQuality_.confidence >= 0.8 && lastRR_.size() >= 4) {
+        double m = 0.0, v = 0.0;
+        for (double r : lastRR_) m += r;
+        m /= (double)lastRR_.size();
+        for (double r : lastRR_) v += (r - m) * (r - m);
+        stable = m > 0.0 && std::sqrt(v / (double)lastRR_.size()) / m < 0.08;
+    }
+    static const double kPsdScale[] = {1.0, 2.0, 3.0, 4.0};
+    static const double kMaScale[] = {1.0, 4.0, 8.0, 8.0};
+    govLevelActive_ = std::max(govLevel_, stable ? 1 : 0);
+    psdScale_ = kPsdScale[govLevelActive_];
+    maScale_ = kMaScale[govLevelActive_];
+    // Level 3: full batch analysis on every 4th poll only
+    reuseBatch_ = (govLevelActive_ >= 3) && (batchPolls_++ % 4 != 0);
+}
+
+void RealtimeAnalyzer::governorEnd(double costMs) {
+    if (!(opt_.pollBudgetMs > 0.0)) return;
+    pollCostEmaMs_ = (pollCostEmaMs_ <= 0.0) ? costMs : (0.7 * pollCostEmaMs_ + 0.3 * costMs);
+    if (opt_.deterministic) return; // cost-driven levels depend on wall time
+    if (pollCostEmaMs_ > opt_.pollBudgetMs && govLevel_ < 3) ++govLevel_;
+    else if (pollCostEmaMs_ < 0.5 * opt_.pollBudgetMs && govLevel_ > 0) --govLevel_;
 }
 
 void RealtimeAnalyzer::trimToWindow() {
     const double effFs = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
     const size_t maxSamples = safeSizeMul(std::min(windowSec_, MAX_WINDOW_SEC), effFs, SIZE_MAX / 4);
-    if (useRing_) {
-        size_t cur = ringFilt_.size();
-        firstAbs_ = (totalAbs_ > cur) ? (totalAbs_ - cur) : 0;
-        firstTsApprox_ = lastTs_ - static_cast<double>(cur) / effFs;
-        while (!peaksAbs_.empty() && peaksAbs_.front() < firstAbs_) peaksAbs_.erase(peaksAbs_.begin());
-        lastPeaks_.clear(); lastRR_.clear();
-        for (size_t j = 0; j < peaksAbs_.size(); ++j) {
-            size_t rel = peaksAbs_[j] - firstAbs_;
-            lastPeaks_.push_back(static_cast<int>(rel));
-            if (j > 0) {
-                double dt = static_cast<double>(peaksAbs_[j] - peaksAbs_[j - 1]) / effFs;
-                lastRR_.push_back(dt * 1000.0);
-            }
+    const size_t cur = winLen();
+    if (cur > maxSamples) {
+        const size_t drop = cur - maxSamples;
+        if (useRing_) {
+            if (keepRaw_) ringSignal_.drop_front(drop);
+            if (quant_) ringQ_.drop_front(drop);
+            else ringFilt_.drop_front(drop);
+        } else {
+            if (keepRaw_) signal_.erase(signal_.begin(), signal_.begin() + drop);
+            filt_.erase(filt_.begin(), filt_.begin() + drop);
         }
-    } else if (signal_.size() > maxSamples) {
-        const size_t drop = signal_.size() - maxSamples;
-        signal_.erase(signal_.begin(), signal_.begin() + drop);
-        if (filt_.size() >= drop) filt_.erase(filt_.begin(), filt_.begin() + drop);
         droppedSamplesLast_ += drop; droppedSamplesTotal_ += drop; ++dropConsecPolls_;
         // Approximate firstTs by backing off from lastTs
-        firstTsApprox_ = lastTs_ - static_cast<double>(signal_.size()) / effFs;
+        firstTsApprox_ = lastTs_ - static_cast<double>(maxSamples) / effFs;
         firstAbs_ += drop;
-        // prune peaks outside window; rebuild RR/peaks relative indices
-        while (!peaksAbs_.empty() && peaksAbs_.front() < firstAbs_) peaksAbs_.erase(peaksAbs_.begin());
-        lastPeaks_.clear(); lastRR_.clear();
-        for (size_t j = 0; j < peaksAbs_.size(); ++j) {
-            size_t rel = peaksAbs_[j] - firstAbs_;
-            lastPeaks_.push_back(static_cast<int>(rel));
-            if (j > 0) {
-                double dt = static_cast<double>(peaksAbs_[j] - peaksAbs_[j - 1]) / effFs;
-                lastRR_.push_back(dt * 1000.0);
-            }
-        }
+        // prune peaks outside window; relative peak/RR views are rebuilt on next read
+        while (!peaksAbs_.empty() && peaksAbs_.front() < firstAbs_) popFrontPeakAbs();
+        while (batchEntry_.size() > 1 && batchEntry_[1].first <= firstAbs_) batchEntry_.pop_front();
+        markPeaksDirty(effFs);
     } else { dropConsecPolls_ = 0; }
-    // Trim display buffer to the same time window length in seconds
-    const size_t maxDisp = safeSizeMul(std::min(windowSec_, MAX_WINDOW_SEC), std::max(10.0, displayHz_), SIZE_MAX / 8);
-    if (displayBuf_.size() > maxDisp) {
-        const size_t drop = displayBuf_.size() - maxDisp;
-        displayBuf_.erase(displayBuf_.begin(), displayBuf_.begin() + drop);
+    // INT16: once per window turnover, tighten the scale if the retained samples allow it
+    if (quant_ && firstAbs_ + winLen() >= qRefitAbs_) {
+        qRefitAbs_ = firstAbs_ + winLen() + std::max<size_t>(1, maxSamples);
+        int peak = 0;
+        for (size_t i = 0; i < ringQ_.size(); ++i) peak = std::max(peak, std::abs((int)ringQ_.at(i)));
+        int e = qExp_;
+        while (e > -24 && peak > 0 && peak * 2 <= 16383) { peak *= 2; --e; } // keep 2x headroom
+        requantize(e);
+    }
+    // Display keeps the same time window length in seconds (trimmed when published/read)
+    const int dispStride = std::max(1, (int)std::lround(effFs / std::max(10.0, displayHz_)));
+    displayMax_ = safeSizeMul(std::min(windowSec_, MAX_WINDOW_SEC), effFs / dispStride, SIZE_MAX / 8);
+}
+
+void RealtimeAnalyzer::feedDisplay(float y, double effFs) {
+    if (displaySuppressed_) return;
+    if (dispFill_ == 0) {
+        int stride = std::max(1, (int)std::lround(effFs / std::max(10.0, displayHz_)));
+        dispBucketLen_ = 2 * (size_t)stride;
+        dispMin_ = dispMax_ = y; dispMinAt_ = dispMaxAt_ = 0;
+    } else {
+        if (y < dispMin_) { dispMin_ = y; dispMinAt_ = dispFill_; }
+        if (y > dispMax_) { dispMax_ = y; dispMaxAt_ = dispFill_; }
     }
+    if (++dispFill_ < dispBucketLen_) return;
+    // Envelope keeps peaks/troughs that plain striding would alias away
+    if (dispMinAt_ <= dispMaxAt_) { displayPending_.push_back(dispMin_); displayPending_.push_back(dispMax_); }
+    else { displayPending_.push_back(dispMax_); displayPending_.push_back(dispMin_); }
+    dispFill_ = 0;
+}
+
+void RealtimeAnalyzer::publishDisplay() {
+    std::lock_guard<std::mutex> lock(displayMutex_);
+    displayMaxPub_ = displayMax_;
+    displayStage_.insert(displayStage_.end(), displayPending_.begin(), displayPending_.end());
+    if (!displayPending_.empty()) displayFresh_ = true;
+    displayPending_.clear();
+    // Unread backlog: everything older than one window is invisible anyway
+    if (displayStage_.size() > 2 * displayMaxPub_ + 64) {
+        displayStage_.erase(displayStage_.begin(), displayStage_.end() - displayMaxPub_);
+        displayReset_ = true;
+    }
+}
+
+std::vector<float> RealtimeAnalyzer::displayBuffer() const {
+    if (opt_.backgroundWorker) { snapshots_.refresh(); return snapshots_.front().display; }
+    return readDisplay();
+}
+
+MemoryFootprint RealtimeAnalyzer::memoryFootprint() const {
+    MemoryFootprint f;
+    f.object = sizeof(RealtimeAnalyzer);
+    {
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        f.rawWindow = ringSignal_.capacity() * sizeof(float) + vecBytes(signal_);
+        f.filteredWindow = ringFilt_.capacity() * sizeof(float) + ringQ_.capacity() * sizeof(int16_t) + vecBytes(filt_);
+        f.display = vecBytes(displayPending_);
+        f.rollingStats = dequeBytes(rollWin_) + dequeBytes(rollWinRect_) + dequeBytes(rectMinQ_) + dequeBytes(rectMaxQ_) + dequeBytes(halfF0Hist_);
+        f.peaks = dequeBytes(peaksAbs_) + rrIntervals_.bytesUsed() + vecBytes(lastPeaks_) + vecBytes(lastRR_) + vecBytes(beatTracks_) + vecBytes(beatTracksNext_) + dequeBytes(batchEntry_);
+        f.ingestQueue = ingest_.bytesUsed() + vecBytes(ingX_) + vecBytes(ingTs_) + vecBytes(ingFlags_);
+        f.preprocessing = pre_.bytesUsed();
+        f.scratch = vecBytes(scratchRR_) + vecBytes(noiseScratch_) + spectral_.bytesUsed() + vecBytes(psdFreqs_) + vecBytes(psdPow_) + vecBytes(keepScratch_) + vecBytes(preOut_)
+                  + vecBytes(preOutTs_) + vecBytes(tsKeepX_) + vecBytes(tsKeepT_)
+                  + vecBytes(rsX_) + vecBytes(rsT_);
+        // Writer copy + three slots, each sized like the current peak/RR views and display window
+        if (opt_.backgroundWorker)
+            f.snapshots = 4 * (lastPeaks_.size() * sizeof(int) + lastRR_.size() * sizeof(double) + displayMax_ * sizeof(float));
+    }
+    {
+        std::lock_guard<std::mutex> lock(displayMutex_);
+        f.display += vecBytes(displayStage_) + displayFront_.capacity() * sizeof(float);
+    }
+    f.total = f.object + f.rawWindow + f.filteredWindow + f.display + f.rollingStats + f.peaks
+            + f.ingestQueue + f.preprocessing + f.scratch + f.snapshots;
+    return f;
+}
+
+// Checkpoint streams: one visitor drives both directions, so field order cannot drift
+class StateWriter {
+public:
+    explicit StateWriter(std::vector<uint8_t>& out) : out_(out) {}
+    template <typename T>
+    void operator()(T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields must be POD");
+        raw(&v, sizeof(T));
+    }
+    template <typename T>
+    void operator()(std::vector<T>& v) { len(v.size()); if (!v.empty()) raw(v.data(), v.size() * sizeof(T)); }
+    template <typename T>
+    void operator()(std::deque<T>& d) { len(d.size()); for (auto& x : d) raw(&x, sizeof(T)); }
+    template <typename T>
+    void operator()(RingBuffer<T>& r) {
+        len(r.capacity());
+        std::vector<T> tmp; r.snapshot(tmp); (*this)(tmp);
+    }
+    void operator()(std::string& s) { len(s.size()); raw(s.data(), s.size()); }
+private:
+    void len(size_t n) { uint64_t v = n; raw(&v, sizeof(v)); }
+    void raw(const void* p, size_t n) { auto* b = static_cast<const uint8_t*>(p); out_.insert(out_.end(), b, b + n); }
+    std::vector<uint8_t>& out_;
+};
+
+class StateReader {
+public:
+    StateReader(const uint8_t* p, size_t n) : p_(p), end_(p + n) {}
+    bool ok() const { return ok_; }
+    bool done() const { return ok_ && p_ == end_; }
+    template <typename T>
+    void operator()(T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields must be POD");
+        raw(&v, sizeof(T));
+    }
+    template <typename T>
+    void operator()(std::vector<T>& v) {
+        size_t n = len(sizeof(T));
+        v.resize(n);
+        if (n) raw(v.data(), n * sizeof(T));
+    }
+    template <typename T>
+    void operator()(std::deque<T>& d) {
+        size_t n = len(sizeof(T));
+        d.assign(n, T{});
+        for (auto& x : d) raw(&x, sizeof(T));
+    }
+    template <typename T>
+    void operator()(RingBuffer<T>& r) {
+        size_t cap = len(0);
+        std::vector<T> tmp; (*this)(tmp);
+        if (cap > (size_t(1) << 28) || tmp.size() > cap) ok_ = false;
+        if (!ok_) return;
+        r.clear();
+        if (cap > 0) r.reconfigure(cap);
+        r.push_back_many(tmp.data(), tmp.size());
+    }
+    void operator()(std::string& s) {
+        size_t n = len(1);
+        s.resize(n);
+        if (n) raw(&s[0], n);
+    }
+private:
+    // Element count, rejected if the remaining bytes cannot hold it
+    size_t len(size_t elemBytes) {
+        uint64_t v = 0; raw(&v, sizeof(v));
+        if (ok_ && elemBytes > 0 && v > (uint64_t)(end_ - p_) / elemBytes) ok_ = false;
+        return ok_ ? (size_t)v : 0;
+    }
+    void raw(void* dst, size_t n) {
+        if (!ok_ || (size_t)(end_ - p_) < n) { ok_ = false; return; }
+        std::memcpy(dst, p_, n);
+        p_ += n;
+    }
+    const uint8_t* p_;
+    const uint8_t* end_;
+    bool ok_ {true};
+};
+
+static const uint32_t kCheckpointMagic = 0x54525048u; // "HPRT"
+static const uint32_t kCheckpointVersion = 6;
+
+template <typename IO>
+static void visitQuality(IO& io, QualityInfo& q) {
+    io(q.totalBeats); io(q.rejectedBeats); io(q.rejectionRate); io(q.rejectedIndices);
+    io(q.goodQuality); io(q.qualityWarning);
+    io(q.snrDb); io(q.confidence); io(q.f0Hz); io(q.maPercActive);
+    io(q.doublingFlag); io(q.softDoublingFlag); io(q.rrShortFrac); io(q.rrLongMs);
+    io(q.pHalfOverFund); io(q.pairFrac);
+    io(q.refractoryMsActive); io(q.minRRBoundMs); io(q.softStreak); io(q.softSecs);
+    io(q.hardFallbackActive); io(q.doublingHintFlag); io(q.rrFallbackModeActive);
+    io(q.droppedSamplesTotal); io(q.clampedBatchesTotal); io(q.oomPreventedTotal);
+    io(q.paramChangeEventsTotal); io(q.mergeBudgetExhausted); io(q.mergeBudgetExhaustedTotal);
+    io(q.droppedSamplesLast); io(q.clampedBatchesLast); io(q.timestampBacktrackEventsTotal);
+    io(q.timestampsSkippedTotal); io(q.timeJumpEventsTotal); io(q.droppingActive);
+    io(q.ingestDroppedTotal); io(q.ingestDecimatedTotal); io(q.ingestBlockedTotal); io(q.ingestQueueHighWater);
+    io(q.beatLatencyEdgesMs); io(q.beatLatencyHist); io(q.beatRevisionHist);
+    io(q.pollStagesRun); io(q.governorLevel); io(q.pollCostMs);
+    io(q.windowStartAbs);
+}
+
+template <typename IO>
+void StreamPreprocessor::visitState(IO& io) {
+    io(clip_); io(hampel_); io(baseline_); io(enhance_);
+    io(clipThr_); io(clipHoldMax_); io(hasGood_); io(clipUnbridged_); io(lastGood_);
+    io(holdV_); io(holdTag_);
+    io(hampelThr_); io(hampelRing_); io(hampelFed_);
+    io(blAlpha_); io(blStarted_); io(blPrevIn_); io(blPrevOut_);
+    io(enStarted_); io(enPrev_);
+}
+
+template <typename IO>
+void TimestampResampler::visitState(IO& io) {
+    io(dt_); io(t_); io(x_); io(count_); io(anchor_); io(k_);
+}
+
+// Everything that influences future output; scratch buffers, threads and the worker's
+// published snapshots are rebuilt. Caller holds dataMutex_ and displayMutex_.
+template <typename IO>
+void RealtimeAnalyzer::visitState(IO& io) {
+    io(windowSec_); io(updateSec_);
+    io(lastEmitTime_); io(lastTs_); io(firstTsApprox_); io(warmupStartTs_); io(effectiveFs_);
+    io(emaAlpha_); io(lastPsdTime_); io(psdUpdateSec_); io(displayHz_);
+    // window storage (whichever representation opt_ selects)
+    io(signal_); io(filt_); io(ringSignal_); io(ringFilt_); io(ringQ_);
+    io(qExp_); io(qScale_); io(qRefitAbs_);
+    // display decimator and published display
+    io(dispBucketLen_); io(dispFill_); io(dispMin_); io(dispMax_); io(dispMinAt_); io(dispMaxAt_);
+    io(displayPending_); io(displayStage_); io(displayFront_); io(displayReset_); io(displayFresh_);
+    io(displayMaxPub_); io(displayMax_);
+    // filters and preprocessing
+    io(bq_); io(bqD_);
+    pre_.visitState(io);
+    resampler_.visitState(io);
+    io(ingestDroppedTotal_);
+    // peaks and thresholding
+    visitQuality(io, lastQuality_);
+    io(lastPeaks_); io(lastRR_); io(peaksDirty_); io(peaksViewFs_);
+    io(rollWin_); io(rollSum_); io(rollSumSq_);
+    io(rollWinRect_); io(rollRectSum_); io(rollRectSumSq_);
+    io(rectMinQ_); io(rectMaxQ_);
+    io(winSamples_); io(refractorySamples_); io(firstAbs_); io(totalAbs_);
+    io(peaksAbs_); io(acceptedPeaksTotal_);
+    io(beatLatencyHist_); io(beatRevisionHist_);   // in-flight beat tracks hold wall-clock times; not saved
+    io(govLevel_); io(pollCostEmaMs_); io(batchPolls_);   // batchCache_ is recomputed on demand
+    // telemetry
+    io(droppedSamplesTotal_); io(clampedBatchesTotal_); io(oomPreventedTotal_); io(paramChangeEventsTotal_);
+    io(lastMergeBudgetExhausted_); io(mergeBudgetExhaustedTotal_); io(droppedSamplesLast_);
+    io(clampedBatchesLast_); io(dropConsecPolls_); io(timestampBacktrackEventsTotal_);
+    io(timestampsSkippedTotal_); io(timeJumpEventsTotal_);
+    // ma_perc, SNR and BPM EMAs
+    io(baseLift_); io(maPerc_); io(hpThreshold_);
+    io(lastMaUpdateTime_); io(lastMaChangeTime_); io(maUpdateSec_); io(maPercScore_);
+    {
+        uint32_t nc = static_cast<uint32_t>(maCands_.size());
+        io(nc);
+        maCands_.resize(std::min<uint32_t>(nc, 16));
+        for (MaCandidate& c : maCands_) {
+            io(c.ma); io(c.inRun); io(c.runBest); io(c.runBestVal); io(c.havePend); io(c.pend); io(c.pendVal);
+            io(c.peaks); io(c.gapSum); io(c.gapSumSq);
+        }
+        io(maEvalAbs_); io(maLiftRef_);
+    }
+    io(snrEmaDb_); io(snrEmaValid_); io(snrTauSec_); io(lastSnrUpdateTime_); io(lastSnrActiveMode_); io(lastSnrBaseBw_);
+    io(bpmEma_); io(bpmEmaValid_); io(bpmTauSec_); io(lastBpmUpdateTime_);
+    io(lastF0Hz_); io(lastRefMsActive_); io(lastMinRRBoundMs_); io(warmupWasPassed_); io(hardFallbackUntil_);
+    // RR gating and harmonic suppression
+    io(shortRejectCount_); io(shortRejectWindowStart_); io(tempLiftBoost_); io(tempLiftUntil_);
+    io(dynRefExtraSamples_); io(dynRefUntil_); io(lastAcceptedAmpCmp_);
+    io(cvHighStartTs_); io(cvHighActive_); io(bpmHighStartTs_); io(bpmHighActive_);
+    io(softDoublingActive_); io(softConsecPass_); io(softStartTs_); io(softLastTrueTs_); io(halfF0Hist_);
+    io(doublingActive_); io(doublingLastTrueTs_); io(doublingHoldUntil_); io(doublingLongRRms_);
+    io(lastClearBadStart_);
+    io(doublingHintActive_); io(hintLastTrueTs_); io(hintStartTs_); io(hintHoldUntil_); io(lastHintBadStart_);
+    io(chokeRelaxUntil_); io(chokeStartTs_);
+    io(rrFallbackConsec_); io(psdLoStart_); io(rrFallbackActive_); io(rrFallbackDrivingHint_); io(lastPollBpmEst_); io(rrFallbackModeActive_);
+}
+
+std::vector<uint8_t> RealtimeAnalyzer::checkpoint() {
+    std::vector<uint8_t> out;
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    if (ingest_.enabled()) drainIngest();
+    checkpointLocked(out);
+    return out;
+}
+
+void RealtimeAnalyzer::checkpointLocked(std::vector<uint8_t>& out) {
+    static_assert(std::is_trivially_copyable<Options>::value, "Options is stored verbatim");
+    std::lock_guard<std::mutex> dlock(displayMutex_);
+    StateWriter w(out);
+    uint32_t magic = kCheckpointMagic, version = kCheckpointVersion, optBytes = sizeof(Options);
+    w(magic); w(version); w(optBytes); w(fs_); w(opt_);
+    unsigned long long dec = ingest_.decimatedTotal(), blk = ingest_.blockedTotal(), hw = ingest_.highWater();
+    w(dec); w(blk); w(hw);
+    visitState(w);
+}
+
+std::unique_ptr<RealtimeAnalyzer> RealtimeAnalyzer::restore(const uint8_t* data, size_t n, const Options* runtime) {
+    if (!data) return nullptr;
+    StateReader r(data, n);
+    uint32_t magic = 0, version = 0, optBytes = 0;
+    double fs = 0.0;
+    Options opt;
+    r(magic); r(version); r(optBytes);
+    if (!r.ok() || magic != kCheckpointMagic || version != kCheckpointVersion || optBytes != sizeof(Options)) return nullptr;
+    r(fs); r(opt);
+    unsigned long long dec = 0, blk = 0, hw = 0;
+    r(dec); r(blk); r(hw);
+    if (!r.ok() || !(fs > 0.0)) return nullptr;
+    if (runtime) {
+        opt.useIngestQueue = runtime->useIngestQueue;
+        opt.backgroundWorker = runtime->backgroundWorker;
+    }
+    std::unique_ptr<RealtimeAnalyzer> a(new RealtimeAnalyzer(fs, opt));
+    a->visitState(r);
+    if (!r.done()) return nullptr;
+    a->rebuildRRIntervals();
+    a->lastRRMedian_ = a->medianOfRR(a->lastRR_);
+    a->ingest_.restoreCounters(dec, blk, hw);
+    return a;
+}
+
+bool RealtimeAnalyzer::startCapture(const std::string& path, size_t bufferBytes) {
+    std::unique_ptr<CaptureWriter> old;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        if (ingest_.enabled()) drainIngest();
+        old = std::move(capture_);
+        std::vector<uint8_t> blob;
+        checkpointLocked(blob);
+        std::unique_ptr<CaptureWriter> w(new CaptureWriter());
+        if (w->open(path, blob, bufferBytes)) capture_ = std::move(w);
+    }
+    const bool ok = capture_ != nullptr;   // only this thread starts/stops captures
+    old.reset();                            // joins the previous writer outside the lock
+    return ok;
+}
+
+CaptureStats RealtimeAnalyzer::stopCapture() {
+    std::unique_ptr<CaptureWriter> w;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        w = std::move(capture_);
+    }
+    if (!w) return CaptureStats{};
+    w->close();
+    return w->stats();
+}
+
+CaptureStats RealtimeAnalyzer::captureStats() const {
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    return capture_ ? capture_->stats() : CaptureStats{};
+}
+
+std::unique_ptr<RealtimeAnalyzer> RealtimeAnalyzer::replayCapture(const uint8_t* data, size_t n,
+                                                                  const std::function<void(const HeartMetrics&)>& onUpdate) {
+    CaptureReader r;
+    if (!r.open(data, n)) return nullptr;
+    // Batches were captured after the ingestion queue, so replay feeds the analysis directly
+    Options direct;
+    direct.useIngestQueue = false;
+    direct.backgroundWorker = false;
+    auto a = restore(r.checkpoint().data(), r.checkpoint().size(), &direct);
+    if (!a) return nullptr;
+    CaptureEvent ev;
+    HeartMetrics m;
+    while (r.next(ev)) {
+        switch (ev.kind) {
+        case CaptureEvent::Kind::APPEND: {
+            std::lock_guard<std::mutex> lock(a->dataMutex_);
+            a->append(ev.samples.data(), ev.samples.size());
+            break;
+        }
+        case CaptureEvent::Kind::APPEND_TS: {
+            std::lock_guard<std::mutex> lock(a->dataMutex_);
+            a->appendTs(ev.samples.data(), ev.timestamps.data(), ev.samples.size());
+            break;
+        }
+        case CaptureEvent::Kind::UPDATE:
+            if (a->computeUpdate(m) && onUpdate) onUpdate(m);
+            break;
+        case CaptureEvent::Kind::WINDOW: a->setWindowSeconds(ev.value); break;
+        case CaptureEvent::Kind::UPDATE_INTERVAL: a->setUpdateIntervalSeconds(ev.value); break;
+        case CaptureEvent::Kind::PSD_UPDATE: a->setPsdUpdateSeconds(ev.value); break;
+        case CaptureEvent::Kind::DISPLAY_HZ: a->setDisplayHz(ev.value); break;
+        case CaptureEvent::Kind::PRESET_TORCH: a->applyPresetTorch(); break;
+        case CaptureEvent::Kind::PRESET_AMBIENT: a->applyPresetAmbient(); break;
+        }
+    }
+    return a;
+}
+
+std::vector<float> RealtimeAnalyzer::readDisplay() const {
+    std::lock_guard<std::mutex> lock(displayMutex_);
+    displayFresh_ = false;
+    if (displayReset_) { displayFront_.clear(); displayReset_ = false; }
+    if (displayFront_.capacity() < displayMaxPub_) displayFront_.reconfigure(displayMaxPub_);
+    displayFront_.push_back_many(displayStage_.data(), displayStage_.size());
+    displayStage_.clear();
+    if (displayFront_.size() > displayMaxPub_) displayFront_.drop_front(displayFront_.size() - displayMaxPub_);
+    std::vector<float> out; displayFront_.snapshot(out);
+    return out;
 }
 
 void RealtimeAnalyzer::push(const float* samples, size_t n, double /*t0*/) {
     if (!samples || n == 0) return;
+    ensureWorker();
+    if (ingest_.enabled()) { ingest_.push(samples, nullptr, n); return; }
     size_t maxBatch = (size_t)std::ceil(std::max(1.0, 10.0) * fs_);
     if (n > maxBatch) {
         n = maxBatch; // clamp oversized batch
@@ -518,6 +1610,12 @@ void RealtimeAnalyzer::push(const float* samples, size_t n, double /*t0*/) {
 void RealtimeAnalyzer::push(const std::vector<double>& samples, double /*t0*/) {
     if (samples.empty()) return;
     size_t n = samples.size();
+    ensureWorker();
+    if (ingest_.enabled()) {
+        std::vector<float> tmp(samples.begin(), samples.end());
+        ingest_.push(tmp.data(), nullptr, tmp.size());
+        return;
+    }
     size_t maxBatch = (size_t)std::ceil(std::max(1.0, 10.0) * fs_);
     if (n > maxBatch) { n = maxBatch; ++clampedBatchesTotal_; } // clamp
     std::vector<float> tmp(n);
@@ -528,13 +1626,90 @@ void RealtimeAnalyzer::push(const std::vector<double>& samples, double /*t0*/) {
 
 void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size_t n) {
     if (!samples || !timestamps || n == 0) return;
+    ensureWorker();
+    if (ingest_.enabled()) { ingest_.push(samples, timestamps, n); return; }
     size_t maxBatch = (size_t)std::ceil(std::max(1.0, 10.0) * fs_);
     if (n > maxBatch) { n = maxBatch; ++clampedBatchesTotal_; } // clamp
     std::lock_guard<std::mutex> lock(dataMutex_);
-    // Update effective Fs using timestamps
+    appendTs(samples, timestamps, n);
+}
+
+size_t RealtimeAnalyzer::backfill(const float* samples, const double* timestamps, size_t n,
+                                  const std::function<void(double, const HeartMetrics&)>& onUpdate) {
+    if (!samples || n == 0) return 0;
+    std::lock_guard<std::mutex> ulock(updateMutex_);
+    size_t block, displayTail;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex_);
+        if (ingest_.enabled()) drainIngest();
+        backfilling_ = true;
+        // One update interval per block keeps the series on the live cadence; push()'s clamp bounds it
+        const double maxBatch = std::ceil(10.0 * fs_);
+        block = static_cast<size_t>(std::clamp(std::round(updateSec_ * fs_), 1.0, maxBatch));
+        displayTail = static_cast<size_t>(std::ceil(windowSec_ * fs_));
+    }
+    size_t updates = 0;
+    HeartMetrics m;
+    for (size_t i = 0; i < n; i += block) {
+        const size_t k = std::min(block, n - i);
+        double t;
+        {
+            std::lock_guard<std::mutex> lock(dataMutex_);
+            displaySuppressed_ = n - i - k > displayTail;
+            if (timestamps) appendTs(samples + i, timestamps + i, k);
+            else append(samples + i, k);
+            t = lastTs_;
+        }
+        if (computeUpdate(m)) {
+            ++updates;
+            if (onUpdate) onUpdate(t, m);
+        }
+    }
+    std::lock_guard<std::mutex> lock(dataMutex_);
+    backfilling_ = false;
+    displaySuppressed_ = false;
+    return updates;
+}
+
+std::vector<StreamUpdate> RealtimeAnalyzer::analyzeRecording(double fs, const Options& opt, const float* samples,
+                                                             const double* timestamps, size_t n, size_t chunk,
+                                                             const std::function<void(RealtimeAnalyzer&)>& setup) {
+    std::vector<StreamUpdate> out;
+    if (!samples || n == 0 || !(fs > 0.0)) return out;
+    Options o = opt;
+    o.useIngestQueue = false;
+    o.backgroundWorker = false;
+    RealtimeAnalyzer a(fs, o);
+    if (setup) setup(a);
+    // The analyzer is private to this call: samples go straight in, without the data lock
+    a.displaySuppressed_ = true;
+    if (chunk == 0) chunk = static_cast<size_t>(std::max(1.0, std::round(a.updateSec_ * a.fs_)));
+    out.reserve(static_cast<size_t>(n / (a.updateSec_ * a.fs_)) + 1);
+    HeartMetrics m;
+    for (size_t i = 0; i < n; i += chunk) {
+        const size_t k = std::min(chunk, n - i);
+        if (timestamps) a.appendTs(samples + i, timestamps + i, k);
+        else a.append(samples + i, k);
+        if (a.computeUpdate(m)) out.push_back(StreamUpdate{a.lastTs_, std::move(m)});
+    }
+    return out;
+}
+
+void RealtimeAnalyzer::appendTs(const float* samples, const double* timestamps, size_t n) {
+    if (!samples || !timestamps || n == 0) return;
+    if (capture_) capture_->append(samples, timestamps, n);
     double t0 = timestamps[0];
     double t1 = timestamps[n - 1];
-    if (n >= 2) {
+    if (opt_.resampleTimestamps) {
+        // Continue on the uniform grid: everything downstream runs at fs_ exactly
+        rsX_.clear(); rsT_.clear();
+        const size_t skipped = resampler_.process(samples, timestamps, n, rsX_, rsT_);
+        timestampBacktrackEventsTotal_ += skipped; timestampsSkippedTotal_ += skipped;
+        effectiveFs_ = fs_;
+        if (rsX_.empty()) return;
+        samples = rsX_.data(); timestamps = rsT_.data(); n = rsX_.size();
+    } else if (n >= 2) {
+        // Update effective Fs using timestamps
         double dt = (t1 - t0) / static_cast<double>(n - 1);
         if (dt > 1e-6) {
             double fsBatch = 1.0 / dt;
@@ -542,47 +1717,39 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
             else effectiveFs_ = (1.0 - emaAlpha_) * effectiveFs_ + emaAlpha_ * fsBatch;
         }
     }
-    if (useRing_) {
-        if (ringFilt_.size() == 0) {
-            firstTsApprox_ = t0;
-            if (!std::isfinite(warmupStartTs_)) warmupStartTs_ = t0;
-        }
-        double lastSeenTs = lastTs_;
+    // Causal preprocessing (timestamps travel with held samples)
+    if (!preprocessBatch(samples, timestamps, n)) return;
+    // Skip samples whose timestamps run backwards; count large forward gaps
+    {
+        bool hasPrev = (totalAbs_ > 0);
+        double prevTs = lastTs_;
+        bool compact = false;
         for (size_t i = 0; i < n; ++i) {
             double ts = timestamps[i];
-            if (ts < lastSeenTs) { ++timestampBacktrackEventsTotal_;
-                ++timestampsSkippedTotal_; continue; }
-            if ((ts - lastSeenTs) > 2.0) { ++timeJumpEventsTotal_; }
-            float s = samples[i];
-            bool useD = opt_.highPrecision || opt_.deterministic;
-            if (useD && !bqD_.empty()) {
-                double yd = static_cast<double>(s);
-                for (auto &bi : bqD_) yd = bi.process(yd);
-                ringSignal_.push_back(s);
-                ringFilt_.push_back(static_cast<float>(yd));
-            } else {
-                float y = s;
-                for (auto &bi : bq_) y = bi.process(y);
-                ringSignal_.push_back(s);
-                ringFilt_.push_back(y);
+            if (hasPrev && ts < prevTs) {
+                ++timestampBacktrackEventsTotal_; ++timestampsSkippedTotal_;
+                if (!compact) { compact = true; tsKeepX_.assign(samples, samples + i); tsKeepT_.assign(timestamps, timestamps + i); }
+                continue;
             }
-            ++totalAbs_;
-            lastSeenTs = ts;
+            if (hasPrev && (ts - prevTs) > 2.0) ++timeJumpEventsTotal_;
+            if (compact) { tsKeepX_.push_back(samples[i]); tsKeepT_.push_back(ts); }
+            hasPrev = true; prevTs = ts;
+        }
+        if (compact) {
+            samples = tsKeepX_.data(); timestamps = tsKeepT_.data(); n = tsKeepX_.size();
+            if (n == 0) return;
         }
-        lastTs_ = lastSeenTs;
-        firstAbs_ = (totalAbs_ > ringFilt_.size()) ? (totalAbs_ - ringFilt_.size()) : 0;
-        return;
     }
-    if (signal_.empty()) {
+    t0 = timestamps[0];
+    t1 = timestamps[n - 1];
+    if (winLen() == 0) {
         firstTsApprox_ = t0;
         if (!std::isfinite(warmupStartTs_)) warmupStartTs_ = t0;
     }
     lastTs_ = t1;
     // Process each incoming sample through the same path as append()
-    const size_t prevLen = signal_.size();
-    signal_.insert(signal_.end(), samples, samples + n);
-    if (filt_.size() < prevLen) filt_.resize(prevLen);
-    if (signal_.size() > filt_.size()) filt_.resize(signal_.size());
+    markBatchEntry();
+    const size_t prevLen = storeRaw(samples, n);
     for (size_t i = 0; i < n; ++i) {
         size_t dst = prevLen + i;
         float s = samples[i];
@@ -597,7 +1764,8 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
             for (auto &bi : bq_) y = bi.process(y);
             yout = y;
         }
-        filt_[dst] = yout;
+        storeFilt(dst, yout);
+        feedDisplay(yout, (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_));
         // rolling window update
         rollWin_.push_back(yout);
         rollSum_ += yout;
@@ -619,9 +1787,9 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
         }
         // incremental local-max detection using 1-sample look-ahead
         if (dst >= 2) {
-            float y2 = std::max(0.0f, filt_[dst - 2]);
-            float y1 = std::max(0.0f, filt_[dst - 1]);
-            float y0 = std::max(0.0f, filt_[dst - 0]);
+            float y2 = std::max(0.0f, filtAt(dst - 2));
+            float y1 = std::max(0.0f, filtAt(dst - 1));
+            float y0 = std::max(0.0f, filtAt(dst - 0));
             if (y1 > y2 && y1 >= y0) {
                 int nwin = static_cast<int>(rollWinRect_.size());
                 double mean = (nwin > 0 ? (rollRectSum_ / nwin) : 0.0);
@@ -661,7 +1829,7 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
                         double min_rr_ms = std::max(0.7 * rr_prior_ms, floor_ms);
                         if (rr_new_ms < min_rr_ms) {
                             size_t relLast = lastAbs >= firstAbs_ ? (lastAbs - firstAbs_) : 0;
-                            float lastVal = (relLast < filt_.size() ? std::max(0.0f, filt_[relLast]) : y1);
+                            float lastVal = (relLast < winLen() ? std::max(0.0f, filtAt(relLast)) : y1);
                             double lastCmp = lastVal;
                             if (hpThreshold_) {
                                 double vmin2 = y1, vmax2 = y1; for (float vv : rollWinRect_) { if (vv < vmin2) vmin2 = vv; if (vv > vmax2) vmax2 = vv; }
@@ -706,8 +1874,8 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
                             double minCmp = 1e9;
                             for (int idx = start; idx < end; ++idx) {
                                 int rel = idx - (int)firstAbs_;
-                                if (rel < 0 || rel >= (int)filt_.size()) continue;
-                                float yr2 = std::max(0.0f, filt_[rel]);
+                                if (rel < 0 || rel >= (int)winLen()) continue;
+                                float yr2 = std::max(0.0f, filtAt((size_t)rel));
                                 double cmp = (yr2 - vmin2) / den2 * 1024.0;
                                 if (cmp < minCmp) minCmp = cmp;
                             }
@@ -716,8 +1884,9 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
                     }
                     if (allowPeak) {
                         if (peaksAbs_.empty()) {
-                            peaksAbs_.push_back(absIdx);
+                            pushPeakAbs(absIdx);
                             ++acceptedPeaksTotal_;
+                            emitBeat(BeatEvent::Kind::ACCEPTED, y1, effFsLoc);
                         } else {
                             size_t lastAbs = peaksAbs_.back();
                             // recompute dynamic base refractory here
@@ -731,31 +1900,26 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
                                 refractoryNow = std::max(refractoryNow, fallbackRef);
                             }
                             if ((absIdx - lastAbs) >= (size_t)std::max(1, refractoryNow)) {
-                                peaksAbs_.push_back(absIdx);
+                                pushPeakAbs(absIdx);
                                 ++acceptedPeaksTotal_;
+                                emitBeat(BeatEvent::Kind::ACCEPTED, y1, effFsLoc);
                             } else {
                                 size_t relLast = lastAbs >= firstAbs_ ? (lastAbs - firstAbs_) : 0;
-                                float lastVal = (relLast < filt_.size() ? std::max(0.0f, filt_[relLast]) : y1);
+                                float lastVal = (relLast < winLen() ? std::max(0.0f, filtAt(relLast)) : y1);
                                 double lastCmp = lastVal;
                                 if (hpThreshold_) {
                                     double vmin = y1, vmax = y1; for (float vv : rollWinRect_) { if (vv < vmin) vmin = vv; if (vv > vmax) vmax = vv; }
                                     double den2 = std::max(1e-6, vmax - vmin);
                                     lastCmp = (lastVal - vmin) / den2 * 1024.0;
                                 }
-                                if (y1Cmp > lastCmp) peaksAbs_.back() = absIdx;
-                            }
-                        }
-                        // Update lastPeaks_/lastRR_ immediately
-                        lastPeaks_.clear(); lastRR_.clear();
-                        const double effFs = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
-                        for (size_t j = 0; j < peaksAbs_.size(); ++j) {
-                            size_t rel = peaksAbs_[j] - firstAbs_;
-                            lastPeaks_.push_back(static_cast<int>(rel));
-                            if (j > 0) {
-                                double dts = static_cast<double>(peaksAbs_[j] - peaksAbs_[j - 1]) / effFs;
-                                lastRR_.push_back(dts * 1000.0);
+                                if (y1Cmp > lastCmp) {
+                                    replaceLastPeakAbs(absIdx);
+                                    emitBeat(BeatEvent::Kind::REPLACED, y1, effFsLoc);
+                                }
                             }
                         }
+                        // Refresh lastPeaks_/lastRR_ (on next read)
+                        markPeaksDirty(effFsLoc);
                         // Diagnostics already tracked above via appliedRef/min_rr_ms
                     }
                 }
@@ -763,78 +1927,226 @@ void RealtimeAnalyzer::push(const float* samples, const double* timestamps, size
         }
         ++totalAbs_;
     }
-    // Rebuild display buffer decimation
-    const double effFs = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
-    int stride = std::max(1, (int)std::lround(effFs / std::max(10.0, displayHz_)));
-    displayBuf_.clear(); displayBuf_.reserve(filt_.size() / stride + 1);
-    for (size_t idx = 0; idx < filt_.size(); idx += (size_t)stride) displayBuf_.push_back(filt_[idx]);
     trimToWindow();
+    publishDisplay();
 }
 
 bool RealtimeAnalyzer::poll(HeartMetrics& out) {
+    if (opt_.backgroundWorker) {
+        // Wait-free: report the newest published update once
+        ensureWorker();
+        snapshots_.refresh();
+        const AnalyzerSnapshot& s = snapshots_.front();
+        if (s.seq == readerSeq_) return false;
+        readerSeq_ = s.seq;
+        out = s.metrics;
+        return true;
+    }
+    return computeUpdate(out);
+}
+
+namespace {
+inline bool sameBits(double a, double b) { return std::memcmp(&a, &b, sizeof(a)) == 0; }
+}
+
+bool RealtimeAnalyzer::pollDelta(PollDelta& out) {
+    if (!poll(deltaStaged_)) return false;
+    const HeartMetrics& m = deltaStaged_;
+    const uint64_t base = m.quality.windowStartAbs;
+    const size_t n = m.peakList.size();
+    const bool rrPerBeat = m.rrList.size() + 1 == n;
+    const bool maskPerBeat = m.binaryPeakMask.size() == n;
+    out.seq = ++deltaSeq_;
+    out.reset = deltaReset_;
+    out.windowStartAbs = base;
+    out.added.clear(); out.revised.clear(); out.removed.clear();
+    out.rrPerBeat = rrPerBeat;
+    out.maskPerBeat = maskPerBeat;
+    out.rrList.clear();
+    out.mask.clear();
+    if (!rrPerBeat) out.rrList.assign(m.rrList.begin(), m.rrList.end());
+    if (!maskPerBeat) out.mask.assign(m.binaryPeakMask.begin(), m.binaryPeakMask.end());
+    if (deltaReset_) deltaBeats_.clear();
+    // Both lists are ascending by index: one merge pass. Beats below the window start expired;
+    // the window's first beat keeps its mirrored RR (its predecessor is gone, not revised)
+    deltaNext_.clear();
+    size_t j = 0;
+    while (j < deltaBeats_.size() && deltaBeats_[j].absIndex < base) ++j;
+    for (size_t k = 0; k < n; ++k) {
+        BeatRecord b;
+        b.absIndex = base + static_cast<uint64_t>(m.peakList[k]);
+        if (rrPerBeat && k > 0) b.rrMs = m.rrList[k - 1];
+        b.accepted = !maskPerBeat || m.binaryPeakMask[k] != 0;
+        for (; j < deltaBeats_.size() && deltaBeats_[j].absIndex < b.absIndex; ++j) out.removed.push_back(deltaBeats_[j].absIndex);
+        if (j < deltaBeats_.size() && deltaBeats_[j].absIndex == b.absIndex) {
+            const BeatRecord& prev = deltaBeats_[j++];
+            if (k == 0 && !std::isnan(prev.rrMs)) b.rrMs = prev.rrMs;
+            if (!sameBits(b.rrMs, prev.rrMs) || b.accepted != prev.accepted) out.revised.push_back(b);
+        } else {
+            out.added.push_back(b);
+        }
+        deltaNext_.push_back(b);
+    }
+    for (; j < deltaBeats_.size(); ++j) out.removed.push_back(deltaBeats_[j].absIndex);
+    deltaBeats_.swap(deltaNext_);
+
+    const double v[PollDelta::kScalarCount] = {
+        m.bpm, m.sdnn, m.rmssd, m.sdsd, m.pnn20, m.pnn50, m.sd1, m.sd2, m.lfhf, m.breathingRate,
+        m.quality.snrDb, m.quality.confidence, m.quality.rejectionRate, m.quality.goodQuality ? 1.0 : 0.0};
+    out.changedScalars = 0;
+    for (int i = 0; i < PollDelta::kScalarCount; ++i) {
+        if (deltaReset_ || !sameBits(v[i], deltaScalars_[i])) out.changedScalars |= 1u << i;
+        out.scalars[i] = deltaScalars_[i] = v[i];
+    }
+    out.warningChanged = deltaReset_ || m.quality.qualityWarning != deltaWarning_;
+    if (out.warningChanged) deltaWarning_ = m.quality.qualityWarning;
+    out.qualityWarning = deltaWarning_;
+    deltaReset_ = false;
+    return true;
+}
+
+void RealtimeAnalyzer::resetPollDelta() {
+    deltaReset_ = true;
+}
+
+void BeatMirror::apply(const PollDelta& d) {
+    if (d.reset) beats.clear();
+    // Expired, withdrawn and revised beats first; then merge the (ascending) additions
+    size_t w = 0, r = 0, x = 0;
+    for (size_t i = 0; i < beats.size(); ++i) {
+        BeatRecord b = beats[i];
+        if (b.absIndex < d.windowStartAbs) continue;
+        while (r < d.removed.size() && d.removed[r] < b.absIndex) ++r;
+        if (r < d.removed.size() && d.removed[r] == b.absIndex) continue;
+        while (x < d.revised.size() && d.revised[x].absIndex < b.absIndex) ++x;
+        if (x < d.revised.size() && d.revised[x].absIndex == b.absIndex) b = d.revised[x];
+        beats[w++] = b;
+    }
+    beats.resize(w);
+    if (!d.added.empty()) {
+        const size_t mid = beats.size();
+        beats.insert(beats.end(), d.added.begin(), d.added.end());
+        std::inplace_merge(beats.begin(), beats.begin() + mid, beats.end(),
+                           [](const BeatRecord& a, const BeatRecord& b) { return a.absIndex < b.absIndex; });
+    }
+    windowStartAbs = d.windowStartAbs;
+    rrPerBeat = d.rrPerBeat;
+    maskPerBeat = d.maskPerBeat;
+    rrList = d.rrList;
+    mask = d.mask;
+    for (int i = 0; i < PollDelta::kScalarCount; ++i) if (d.changedScalars & (1u << i)) scalars[i] = d.scalars[i];
+    if (d.warningChanged) qualityWarning = d.qualityWarning;
+}
+
+void BeatMirror::rebuild(std::vector<int>& peakList, std::vector<double>& rrOut, std::vector<int>& maskOut) const {
+    peakList.clear(); maskOut.clear();
+    for (const auto& b : beats) {
+        peakList.push_back(static_cast<int>(b.absIndex - windowStartAbs));
+        if (maskPerBeat) maskOut.push_back(b.accepted ? 1 : 0);
+    }
+    if (!maskPerBeat) maskOut = mask;
+    if (!rrPerBeat) { rrOut = rrList; return; }
+    rrOut.clear();
+    for (size_t k = 1; k < beats.size(); ++k) rrOut.push_back(beats[k].rrMs);
+}
+
+bool RealtimeAnalyzer::computeUpdate(HeartMetrics& out) {
     std::unique_lock<std::mutex> lock(dataMutex_);
 #if defined(HEARTPY_LOCK_TIMING) && defined(HEARTPY_LOCK_TIMING_ENABLE)
     auto l1_start = std::chrono::steady_clock::now();
 #endif
+    // Live samples queued during a backfill belong after it
+    if (ingest_.enabled() && !backfilling_) drainIngest();
     // Only emit once per updateSec_ of newly received samples
     if ((lastTs_ - lastEmitTime_) < updateSec_) return false;
+    // Polls that return above leave no trace in the state, so only running updates are captured
+    if (capture_) capture_->update();
     lastEmitTime_ = lastTs_;
+    const auto pollStart = std::chrono::steady_clock::now();
 
     // Snapshot minimal state + window
     std::vector<double> win;
     double fsEff = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
     size_t firstAbsSnap = firstAbs_;
-    double firstTsSnap = firstTsApprox_;
-    if ((!useRing_ && signal_.empty()) || (useRing_ && ringFilt_.empty())) return false;
-    if (useRing_) {
-        std::vector<float> tmp; ringFilt_.snapshot(tmp);
-        win.reserve(tmp.size());
-        for (float v : tmp) win.push_back(static_cast<double>(v));
-        firstAbsSnap = (totalAbs_ > ringFilt_.size()) ? (totalAbs_ - ringFilt_.size()) : 0;
-        firstTsSnap = lastTs_ - static_cast<double>(ringFilt_.size()) / fsEff;
-    } else {
-        win.reserve(signal_.size());
-        for (float v : filt_) win.push_back(static_cast<double>(v));
-    }
+    if (winLen() == 0) return false;
+    if (quant_) {
+        ringQ_.snapshot(win);
+        for (auto& v : win) v *= qScale_;
+    } else if (useRing_) ringFilt_.snapshot(win);
+    else win.assign(filt_.begin(), filt_.end());
+    materializePeaks();
+    governorBegin();
+    const bool havePeaks = !lastPeaks_.empty();
     lock.unlock();
 #if defined(HEARTPY_LOCK_TIMING) && defined(HEARTPY_LOCK_TIMING_ENABLE)
     auto l1_end = std::chrono::steady_clock::now();
     heartpy::RealtimeAnalyzer::recordLockHold(1, std::chrono::duration_cast<std::chrono::microseconds>(l1_end - l1_start).count());
 #endif
     Options o = opt_;
-    // Keep user-configured bandpass; callers may set lowHz=highHz=0 to skip
-    out = analyzeSignal(win, fsEff, o);
+    // Preprocessing already ran causally in append()/push(); do not repeat it per poll
+    o.interpClipping = false;
+    o.hampelCorrect = false;
+    o.removeBaselineWander = false;
+    o.enhancePeaks = false;
+    // Governor: a flat window (no contact, saturated sensor) has nothing to analyze
+    if (opt_.pollBudgetMs > 0.0) {
+        double ss = 0.0;
+        for (double v : win) ss += v * v;
+        if (std::sqrt(ss / (double)win.size()) < 1e-4) {
+            out = HeartMetrics{};
+            out.quality.goodQuality = false;
+            out.quality.qualityWarning = "flat or saturated window";
+            lock.lock();
+            pollStages_ |= QualityInfo::kStageFlatSkip;
+            commitAuditCounters(out.quality);
+            const double costMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pollStart).count();
+            governorEnd(costMs);
+            out.quality.pollStagesRun = pollStages_;
+            out.quality.governorLevel = govLevelActive_;
+            out.quality.pollCostMs = costMs;
+            out.quality.windowStartAbs = firstAbsSnap;
+            lastQuality_ = out.quality;
+            return true;
+        }
+    }
+    // Keep user-configured bandpass; callers may set lowHz=highHz=0 to skip.
+    // The cached batch result is only reused while streaming peaks are available.
+    if (reuseBatch_ && batchCacheValid_ && havePeaks) {
+        out = batchCache_;
+    } else {
+        out = analyzeSignal(win, fsEff, o);
+        pollStages_ |= QualityInfo::kStageBatch;
+        if (opt_.pollBudgetMs > 0.0) { batchCache_ = out; batchCacheValid_ = true; }
+    }
 
     // If HP-style thresholding requested, calibrate ma_perc on the current window
     if (opt_.useHPThreshold) {
         // Rolling mean over ~0.75s as in HeartPy
         // Positive-baseline scale window to [0..1024] for HP-style threshold
-        double wmin = *std::min_element(win.begin(), win.end());
-        double wmax = *std::max_element(win.begin(), win.end());
+        double wmin, wmax;
+        minMaxOf(win, wmin, wmax);
         double wden = std::max(1e-6, wmax - wmin);
-        std::vector<double> swin; swin.reserve(win.size());
-        for (double v : win) swin.push_back((v - wmin) / wden * 1024.0);
-        auto rmean = rollingMeanHP_local(swin, fsEff, 0.75);
-        double rmean_avg = meanVec(rmean);
+        const bool incremental = opt_.maGridIncremental;
+        std::vector<double> swin, rmean;   // legacy grid only
+        double rmean_avg = 0.0;
+        if (incremental) {
+            // Scaling is linear, so the scaled mean follows from the raw one without a scaled copy
+            rmean_avg = (rollingMeanHPAvg_local(win, fsEff, 0.75) - wmin) / wden * 1024.0;
+            advanceMaCandidates(win, rmean_avg, wden, firstAbsSnap, fsEff);
+        } else {
+            swin.reserve(win.size());
+            for (double v : win) swin.push_back((v - wmin) / wden * 1024.0);
+            rmean = rollingMeanHP_local(swin, fsEff, 0.75);
+            rmean_avg = meanVec(rmean);
+        }
         // Retune only every maUpdateSec_ seconds (hysteresis)
-        if ((lastTs_ - lastMaUpdateTime_) >= maUpdateSec_) {
-            // candidate ma_perc grid (expanded)
-            std::vector<double> grid = {10.0, 15.0, 20.0, 25.0, 30.0, 35.0, 40.0, 50.0, 60.0};
+        if ((lastTs_ - lastMaUpdateTime_) >= maUpdateSec_ * maScale_) {
+            pollStages_ |= QualityInfo::kStageMaGrid;
             double best_ma = maPerc_;
             double best_score = 1e300; // lower is better
-            std::vector<int> best_peaks_rel;
-            for (double ma : grid) {
-                auto cand = detectPeaksHP_local(swin, rmean, ma, fsEff);
-                cand = consolidateByRefractory(cand, win, refractorySamples_);
-                if (cand.size() < 2) continue;
-                std::vector<double> rr_ms; rr_ms.reserve(cand.size() - 1);
-                for (size_t i = 1; i < cand.size(); ++i) rr_ms.push_back((cand[i] - cand[i - 1]) * 1000.0 / fsEff);
-                double mean_rr = meanVec(rr_ms);
-                if (mean_rr <= 1e-6) continue;
+            // score: RR std, penalize if outside BPM limits
+            auto scoreOf = [&](double mean_rr, double sd, double ma) {
                 double bpm = 60000.0 / mean_rr;
-                // score: RR std, penalize if outside BPM limits
-                double var = 0.0; for (double r : rr_ms) { double d = r - mean_rr; var += d * d; } var /= rr_ms.size();
-                double sd = std::sqrt(std::max(0.0, var));
                 double penalty = 0.0;
                 if (bpm < opt_.bpmMin || bpm > opt_.bpmMax) penalty = 1e3; // heavy penalty
                 // Bias against implausibly high BPM relative to prior
@@ -848,7 +2160,44 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
                 if ((bpm > highThresh) && (ma < 25.0)) {
                     score += sd; // add one SD as penalty
                 }
-                if (score < best_score) { best_score = score; best_ma = ma; best_peaks_rel = std::move(cand); }
+                return score;
+            };
+            std::vector<int> best_peaks_rel;
+            if (incremental) {
+                const MaCandidate* best = nullptr;
+                for (const MaCandidate& c : maCands_) {
+                    const size_t count = c.peaks.size() + (c.havePend ? 1 : 0);
+                    if (count < 2) continue;
+                    double gs = c.gapSum, gs2 = c.gapSumSq;
+                    if (c.havePend && !c.peaks.empty()) { double g = (double)(c.pend - c.peaks.back()); gs += g; gs2 += g * g; }
+                    const double nGaps = (double)(count - 1);
+                    const double toMs = 1000.0 / fsEff;
+                    double mean_rr = gs / nGaps * toMs;
+                    if (mean_rr <= 1e-6) continue;
+                    double meanGap = gs / nGaps;
+                    double var = std::max(0.0, gs2 / nGaps - meanGap * meanGap) * toMs * toMs;
+                    double score = scoreOf(mean_rr, std::sqrt(var), c.ma);
+                    if (score < best_score) { best_score = score; best_ma = c.ma; best = &c; }
+                }
+                if (best) {
+                    best_peaks_rel.reserve(best->peaks.size() + 1);
+                    for (size_t a : best->peaks) best_peaks_rel.push_back((int)(a - firstAbsSnap));
+                    if (best->havePend) best_peaks_rel.push_back((int)(best->pend - firstAbsSnap));
+                }
+            } else {
+                // candidate ma_perc grid (expanded), each detected over the whole window
+                for (double ma : {10.0, 15.0, 20.0, 25.0, 30.0, 35.0, 40.0, 50.0, 60.0}) {
+                    auto cand = detectPeaksHP_local(swin, rmean, ma, fsEff);
+                    cand = consolidateByRefractory(cand, win, refractorySamples_);
+                    if (cand.size() < 2) continue;
+                    std::vector<double> rr_ms; rr_ms.reserve(cand.size() - 1);
+                    for (size_t i = 1; i < cand.size(); ++i) rr_ms.push_back((cand[i] - cand[i - 1]) * 1000.0 / fsEff);
+                    double mean_rr = meanVec(rr_ms);
+                    if (mean_rr <= 1e-6) continue;
+                    double var = 0.0; for (double r : rr_ms) { double d = r - mean_rr; var += d * d; } var /= rr_ms.size();
+                    double score = scoreOf(mean_rr, std::sqrt(std::max(0.0, var)), ma);
+                    if (score < best_score) { best_score = score; best_ma = ma; best_peaks_rel = std::move(cand); }
+                }
             }
             if (!best_peaks_rel.empty()) {
                 // Hysteresis: switch only if improvement >=10%
@@ -863,10 +2212,17 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
                     if (bpmHighPersist && maPerc_ < 25.0) maPerc_ = std::min(60.0, maPerc_ + 10.0);
                     maPercScore_ = best_score;
                     // Replace window peaks with calibrated HP result
-                    peaksAbs_.clear(); peaksAbs_.reserve(best_peaks_rel.size());
                     // Stage peaks into local vectors using snapshot bases; commit later
-                    std::vector<int> candPeaksAbs; candPeaksAbs.reserve(best_peaks_rel.size());
+                    std::vector<int> candPeaksAbs; candPeaksAbs.reserve(best_peaks_rel.size() + 4);
                     for (int rel : best_peaks_rel) candPeaksAbs.push_back((int)(firstAbsSnap + (size_t)rel));
+                    // Commit minimal state under short lock
+                    lock.lock();
+                    // Incremental candidates lag the window end by half the rolling-mean span; keep
+                    // the streaming detector's beats beyond their last peak
+                    if (incremental) {
+                        for (size_t a : peaksAbs_)
+                            if ((long long)a > (long long)candPeaksAbs.back() + refractorySamples_) candPeaksAbs.push_back((int)a);
+                    }
                     std::vector<int> candPeaksRel; std::vector<double> candRR;
                     for (size_t j = 0; j < candPeaksAbs.size(); ++j) {
                         size_t rel = candPeaksAbs[j] - firstAbsSnap;
@@ -876,11 +2232,11 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
                             candRR.push_back(dts * 1000.0);
                         }
                     }
-                    // Commit minimal state under short lock
-                    lock.lock();
                     peaksAbs_.assign(candPeaksAbs.begin(), candPeaksAbs.end());
+                    rebuildRRIntervals();
                     lastPeaks_.assign(candPeaksRel.begin(), candPeaksRel.end());
                     lastRR_.assign(candRR.begin(), candRR.end());
+                    peaksDirty_ = false;
                     lastMaChangeTime_ = lastTs_;
                     lock.unlock();
                 }
@@ -904,21 +2260,8 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
     // Cache a few items for convenience (updated again after SNR)
     // Commit cached quality and audit counters under short lock
     lock.lock();
-    out.quality.droppedSamplesTotal = droppedSamplesTotal_;
-    out.quality.clampedBatchesTotal = clampedBatchesTotal_;
-    out.quality.oomPreventedTotal = oomPreventedTotal_;
-    out.quality.paramChangeEventsTotal = paramChangeEventsTotal_;
-    out.quality.mergeBudgetExhausted = lastMergeBudgetExhausted_ ? 1 : 0;
-    out.quality.mergeBudgetExhaustedTotal = mergeBudgetExhaustedTotal_;
-    out.quality.droppedSamplesLast = droppedSamplesLast_;
-    out.quality.clampedBatchesLast = clampedBatchesLast_;
-    out.quality.timestampBacktrackEventsTotal = timestampBacktrackEventsTotal_;
-    out.quality.timestampsSkippedTotal = timestampsSkippedTotal_;
-    out.quality.timeJumpEventsTotal = timeJumpEventsTotal_;
-    out.quality.droppingActive = (dropConsecPolls_ >= 2) ? 1 : 0;
+    commitAuditCounters(out.quality);
     lastQuality_ = out.quality;
-    lastMergeBudgetExhausted_ = 0; // reset per-poll flag
-    droppedSamplesLast_ = 0; clampedBatchesLast_ = 0; // reset per-poll last counters
     lock.unlock();
 #if defined(HEARTPY_LOCK_TIMING) && defined(HEARTPY_LOCK_TIMING_ENABLE)
     // This scope is small; measure approximately around the lock/unlock block
@@ -1031,6 +2374,7 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
 
         // Final consolidation: keep strongest within refractory across window
         if (!lastPeaks_.empty()) {
+            pollStages_ |= QualityInfo::kStageConsolidate;
             auto consolidated = consolidateByRefractory(lastPeaks_, win, refractorySamples_);
             if (consolidated.size() != lastPeaks_.size()) {
                 lastPeaks_ = std::move(consolidated);
@@ -1045,6 +2389,7 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
 
         // Periodic suppression: keep only one peak per expected period window anchored to last kept peak
         if ((softDoublingActive_ || doublingActive_ || doublingHintActive_) && lastPeaks_.size() >= 2 && (lastTs_ > chokeRelaxUntil_)) {
+            pollStages_ |= QualityInfo::kStageSuppression;
             const double fsEffLoc = fsEff;
             // Prefer RR-derived long period; fallback to f0
             double longMs = 0.0;
@@ -1120,6 +2465,7 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
         std::vector<int> peaks_before = lastPeaks_;
         std::vector<double> rr_before = lastRR_;
         if (lastRR_.size() >= 3 && lastPeaks_.size() == lastRR_.size() + 1) {
+            pollStages_ |= QualityInfo::kStageDoublingRepair;
             double m = medianOfRR(lastRR_);
             keepScratch_.assign(lastPeaks_.size(), 1);
             for (size_t i = 0; i + 1 < lastRR_.size(); ++i) {
@@ -1280,8 +2626,9 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
             lastPeaks_ = peaks_before;
             lastRR_ = rr_before;
         }
-        // update last poll bpm estimate
-        if (!lastRR_.empty()) { double med2 = medianOfRR(lastRR_); if (med2>1e-6) lastPollBpmEst_ = 60000.0/med2; }
+        // update last poll bpm estimate; lastRR_ is final for this poll, so this is also the
+        // median the per-sample gating reads until the views are rebuilt
+        if (!lastRR_.empty()) { lastRRMedian_ = medianOfRR(lastRR_); if (lastRRMedian_>1e-6) lastPollBpmEst_ = 60000.0/lastRRMedian_; }
 
         // Produce a coarse binaryPeakMask aligned to current peakList (streaming)
         out.binaryPeakMask.clear();
@@ -1296,7 +2643,7 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
         }
     }
     // Phase S6: compute SNR/Confidence periodically (HR-based); do not override breathing here
-    updateSNR(out);
+    updateSNR(out, win);
     // Persist smoothed SNR/conf across polls (avoid zeroing between PSD updates)
     if (snrEmaValid_) {
         out.quality.snrDb = snrEmaDb_;
@@ -1346,6 +2693,17 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
     }
     out.quality.refractoryMsActive = lastRefMsActive_;
     out.quality.minRRBoundMs = lastMinRRBoundMs_;
+    if (!lock.owns_lock()) lock.lock();
+    const double costMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pollStart).count();
+    governorEnd(costMs);
+    out.quality.pollStagesRun = pollStages_;
+    out.quality.governorLevel = govLevelActive_;
+    out.quality.pollCostMs = costMs;
+    trackPolledBeats(out.peakList, firstAbsSnap, fsEff);
+    out.quality.windowStartAbs = firstAbsSnap;
+    out.quality.beatLatencyEdgesMs.assign(std::begin(kBeatLatencyEdgesMs), std::end(kBeatLatencyEdgesMs));
+    out.quality.beatLatencyHist = beatLatencyHist_;
+    out.quality.beatRevisionHist = beatRevisionHist_;
     // refresh cached quality
     lastQuality_ = out.quality;
     return true;
@@ -1354,7 +2712,104 @@ bool RealtimeAnalyzer::poll(HeartMetrics& out) {
 } // namespace heartpy
 
 // Plain C bridge
-struct _hp_rt_handle { heartpy::RealtimeAnalyzer* p; };
+struct _hp_rt_handle {
+    heartpy::RealtimeAnalyzer* p;
+    heartpy::HeartMetrics staged;   // hp_rt_poll_into: reused so its arrays keep their capacity
+    bool hasStaged = false;
+    heartpy::PollDelta delta;       // hp_rt_poll_delta: likewise
+    bool hasDelta = false;
+    bool deltaLost = false;         // last delta truncated and not re-copied: next one is a reset
+};
+
+namespace {
+
+template <typename T, typename U>
+uint32_t copyOut(const std::vector<U>& v, T* dst, size_t cap, uint32_t bit, uint32_t& truncated) {
+    const size_t k = dst ? std::min(cap, v.size()) : 0;
+    for (size_t i = 0; i < k; ++i) dst[i] = static_cast<T>(v[i]);
+    if (k < v.size()) truncated |= bit;
+    return static_cast<uint32_t>(v.size());
+}
+
+int fillResult(const heartpy::HeartMetrics& m, hp_result* out, const hp_result_buffers* bufs) {
+    const uint32_t size = out->size;
+    hp_result r{};
+    r.size = size;
+    r.version = HP_RESULT_VERSION;
+    r.bpm = m.bpm; r.sdnn = m.sdnn; r.rmssd = m.rmssd; r.sdsd = m.sdsd;
+    r.pnn20 = m.pnn20; r.pnn50 = m.pnn50; r.nn20 = m.nn20; r.nn50 = m.nn50; r.mad = m.mad;
+    r.sd1 = m.sd1; r.sd2 = m.sd2; r.sd1sd2Ratio = m.sd1sd2Ratio; r.ellipseArea = m.ellipseArea;
+    r.vlf = m.vlf; r.lf = m.lf; r.hf = m.hf; r.lfhf = m.lfhf; r.totalPower = m.totalPower;
+    r.lfNorm = m.lfNorm; r.hfNorm = m.hfNorm; r.breathingRate = m.breathingRate;
+    const auto& q = m.quality;
+    r.totalBeats = q.totalBeats; r.rejectedBeats = q.rejectedBeats; r.rejectionRate = q.rejectionRate;
+    r.goodQuality = q.goodQuality ? 1 : 0; r.doublingFlag = q.doublingFlag;
+    r.softDoublingFlag = q.softDoublingFlag; r.hardFallbackActive = q.hardFallbackActive;
+    r.snrDb = q.snrDb; r.confidence = q.confidence; r.f0Hz = q.f0Hz; r.maPercActive = q.maPercActive;
+    r.refractoryMsActive = q.refractoryMsActive; r.minRRBoundMs = q.minRRBoundMs;
+    r.pollStagesRun = q.pollStagesRun; r.governorLevel = q.governorLevel; r.pollCostMs = q.pollCostMs;
+    const hp_result_buffers b = bufs ? *bufs : hp_result_buffers{};
+    r.peakCount = copyOut(m.peakList, b.peaks, b.peaksCap, HP_TRUNC_PEAKS, r.truncated);
+    r.peakRawCount = copyOut(m.peakListRaw, b.peaksRaw, b.peaksRawCap, HP_TRUNC_PEAKS_RAW, r.truncated);
+    r.rrCount = copyOut(m.rrList, b.rr, b.rrCap, HP_TRUNC_RR, r.truncated);
+    r.maskCount = copyOut(m.binaryPeakMask, b.mask, b.maskCap, HP_TRUNC_MASK, r.truncated);
+    const std::string& w = q.qualityWarning;
+    r.warningLength = static_cast<uint32_t>(w.size());
+    if (b.warning && b.warningCap > 0) {
+        const size_t k = std::min(w.size(), b.warningCap - 1);
+        std::memcpy(b.warning, w.data(), k);
+        b.warning[k] = '\0';
+        if (k < w.size()) r.truncated |= HP_TRUNC_WARNING;
+    } else if (!w.empty()) r.truncated |= HP_TRUNC_WARNING;
+    std::memcpy(out, &r, std::min<size_t>(size, sizeof(r)));
+    return 1;
+}
+
+bool resultSizeOk(const hp_result* out) {
+    return out && out->size >= offsetof(hp_result, bpm);
+}
+
+static_assert(int(HP_SCALAR_COUNT) == int(heartpy::PollDelta::kScalarCount), "hp_poll_delta scalars");
+
+uint32_t copyBeats(const std::vector<heartpy::BeatRecord>& v, hp_beat* dst, size_t cap, uint32_t bit, uint32_t& truncated) {
+    const size_t k = dst ? std::min(cap, v.size()) : 0;
+    for (size_t i = 0; i < k; ++i) dst[i] = hp_beat{v[i].absIndex, v[i].rrMs, v[i].accepted ? 1 : 0};
+    if (k < v.size()) truncated |= bit;
+    return static_cast<uint32_t>(v.size());
+}
+
+// Truncations that leave the caller's beat mirror incomplete
+constexpr uint32_t kDeltaLost = HP_TRUNC_ADDED | HP_TRUNC_REVISED | HP_TRUNC_REMOVED | HP_TRUNC_RR | HP_TRUNC_MASK;
+
+// Returns the truncation bits
+uint32_t fillDelta(const heartpy::PollDelta& d, hp_poll_delta* out, const hp_delta_buffers* bufs) {
+    const uint32_t size = out->size;
+    hp_poll_delta r{};
+    r.size = size;
+    r.version = HP_DELTA_VERSION;
+    r.seq = d.seq; r.windowStartAbs = d.windowStartAbs;
+    r.reset = d.reset ? 1 : 0; r.rrPerBeat = d.rrPerBeat ? 1 : 0; r.maskPerBeat = d.maskPerBeat ? 1 : 0;
+    r.warningChanged = d.warningChanged ? 1 : 0;
+    r.changedScalars = d.changedScalars;
+    std::memcpy(r.scalars, d.scalars, sizeof(r.scalars));
+    const hp_delta_buffers b = bufs ? *bufs : hp_delta_buffers{};
+    r.addedCount = copyBeats(d.added, b.added, b.addedCap, HP_TRUNC_ADDED, r.truncated);
+    r.revisedCount = copyBeats(d.revised, b.revised, b.revisedCap, HP_TRUNC_REVISED, r.truncated);
+    r.removedCount = copyOut(d.removed, b.removed, b.removedCap, HP_TRUNC_REMOVED, r.truncated);
+    r.rrListCount = copyOut(d.rrList, b.rrList, b.rrListCap, HP_TRUNC_RR, r.truncated);
+    r.maskCount = copyOut(d.mask, b.mask, b.maskCap, HP_TRUNC_MASK, r.truncated);
+    r.warningLength = static_cast<uint32_t>(d.qualityWarning.size());
+    if (d.warningChanged && b.warning && b.warningCap > 0) {
+        const size_t k = std::min(d.qualityWarning.size(), b.warningCap - 1);
+        std::memcpy(b.warning, d.qualityWarning.data(), k);
+        b.warning[k] = '\0';
+        if (k < d.qualityWarning.size()) r.truncated |= HP_TRUNC_WARNING;
+    } else if (d.warningChanged && !d.qualityWarning.empty()) r.truncated |= HP_TRUNC_WARNING;
+    std::memcpy(out, &r, std::min<size_t>(size, sizeof(r)));
+    return r.truncated;
+}
+
+} // namespace
 
 void* hp_rt_create(double fs, const heartpy::Options* opt) {
     auto* h = new _hp_rt_handle();
@@ -1383,10 +2838,103 @@ void  hp_rt_push_ts(void* h, const float* x, const double* ts, size_t n) {
     S->p->push(x, ts, n);
 }
 
+size_t hp_rt_backfill(void* h, const float* x, const double* ts, size_t n, hp_rt_update_cb cb, void* user) {
+    if (!h || !x || n == 0) return 0;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    if (!cb) return S->p->backfill(x, ts, n);
+    return S->p->backfill(x, ts, n, [cb, user](double t, const heartpy::HeartMetrics& m) { cb(user, t, &m); });
+}
+
 int   hp_rt_poll(void* h, heartpy::HeartMetrics* out) {
     if (!h || !out) return 0; auto* S = reinterpret_cast<_hp_rt_handle*>(h); return S->p->poll(*out) ? 1 : 0;
 }
 
+int   hp_rt_poll_into(void* h, hp_result* out, const hp_result_buffers* bufs) {
+    if (!resultSizeOk(out)) return -1;
+    if (!h) return 0;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    if (!S->p->poll(S->staged)) return 0;
+    S->hasStaged = true;
+    return fillResult(S->staged, out, bufs);
+}
+
+int   hp_rt_last_into(void* h, hp_result* out, const hp_result_buffers* bufs) {
+    if (!resultSizeOk(out)) return -1;
+    if (!h) return 0;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    if (!S->hasStaged) return 0;
+    return fillResult(S->staged, out, bufs);
+}
+
+int   hp_rt_poll_delta(void* h, hp_poll_delta* out, const hp_delta_buffers* bufs) {
+    if (!out || out->size < offsetof(hp_poll_delta, seq)) return -1;
+    if (!h) return 0;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    if (S->deltaLost) S->p->resetPollDelta();
+    S->deltaLost = false;
+    if (!S->p->pollDelta(S->delta)) return 0;
+    S->hasDelta = true;
+    S->deltaLost = (fillDelta(S->delta, out, bufs) & kDeltaLost) != 0;
+    return 1;
+}
+
+int   hp_rt_last_delta_into(void* h, hp_poll_delta* out, const hp_delta_buffers* bufs) {
+    if (!out || out->size < offsetof(hp_poll_delta, seq)) return -1;
+    if (!h) return 0;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    if (!S->hasDelta) return 0;
+    S->deltaLost = (fillDelta(S->delta, out, bufs) & kDeltaLost) != 0;
+    return 1;
+}
+
+void  hp_rt_reset_poll_delta(void* h) {
+    if (!h) return;
+    reinterpret_cast<_hp_rt_handle*>(h)->p->resetPollDelta();
+}
+
+int   hp_analyze_into(const float* x, size_t n, double fs, const heartpy::Options* opt,
+                      hp_result* out, const hp_result_buffers* bufs) {
+    if (!resultSizeOk(out) || !x || n == 0 || !(fs > 0.0)) return -1;
+    const std::vector<double> sig(x, x + n);
+    return fillResult(heartpy::analyzeSignal(sig, fs, opt ? *opt : heartpy::Options{}), out, bufs);
+}
+
+size_t hp_rt_checkpoint(void* h, uint8_t* buf, size_t cap) {
+    if (!h) return 0;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    std::vector<uint8_t> blob = S->p->checkpoint();
+    if (buf && cap >= blob.size()) std::memcpy(buf, blob.data(), blob.size());
+    return blob.size();
+}
+
+void* hp_rt_restore(const uint8_t* data, size_t n) {
+    auto a = heartpy::RealtimeAnalyzer::restore(data, n);
+    if (!a) return nullptr;
+    auto* h = new _hp_rt_handle();
+    h->p = a.release();
+    return h;
+}
+
+void  hp_rt_set_beat_callback(void* h, hp_rt_beat_cb cb, void* user) {
+    if (!h) return;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    if (!cb) { S->p->setBeatCallback(nullptr); return; }
+    S->p->setBeatCallback([cb, user](const heartpy::BeatEvent& e) {
+        cb(user, e.absIndex, e.timestamp, e.amplitude, e.rrMs, e.kind == heartpy::BeatEvent::Kind::REPLACED ? 1 : 0);
+    });
+}
+
+int   hp_rt_capture_start(void* h, const char* path, size_t bufferBytes) {
+    if (!h || !path) return 0;
+    auto* S = reinterpret_cast<_hp_rt_handle*>(h);
+    return S->p->startCapture(path, bufferBytes ? bufferBytes : (size_t(1) << 20)) ? 1 : 0;
+}
+
+int   hp_rt_capture_stop(void* h) {
+    if (!h) return 0;
+    return reinterpret_cast<_hp_rt_handle*>(h)->p->stopCapture().blocksFailed == 0 ? 1 : 0;
+}
+
 void  hp_rt_destroy(void* h) {
     if (!h) return; auto* S = reinterpret_cast<_hp_rt_handle*>(h); delete S->p; delete S;
 }
@@ -1401,13 +2949,14 @@ double RealtimeAnalyzer::medianOfRR(const std::vector<double>& rr) {
     return *mid;
 }
 
-void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
-    if ((lastTs_ - lastPsdTime_) < psdUpdateSec_) return;
+void RealtimeAnalyzer::updateSNR(HeartMetrics& out, const std::vector<double>& win) {
+    if ((lastTs_ - lastPsdTime_) < psdUpdateSec_ * psdScale_) return;
     lastPsdTime_ = lastTs_;
+    pollStages_ |= QualityInfo::kStagePsd;
 
     // Use full-rate filtered window for PSD and derive SNR around HR
     const double effFs = (effectiveFs_ > 1e-6 ? effectiveFs_ : fs_);
-    if (effFs <= 0.0 || filt_.size() < 32) return;
+    if (effFs <= 0.0 || win.size() < 32) return;
 
     // Estimate HR frequency f0 (Hz) from streaming RR if available; fallback to out.bpm; reuse last if missing
     double f0 = 0.0;
@@ -1421,10 +2970,6 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     if (f0 <= 0.0) return;
     lastF0Hz_ = f0;
 
-    // Build analysis vector (copy of filt_) — reuse buffer to reduce reallocations
-    yBufferD_.resize(filt_.size());
-    for (size_t i = 0; i < filt_.size(); ++i) yBufferD_[i] = (double)filt_[i];
-
     // Welch PSD on the full-rate filtered signal
     auto coerceNfft = [](int n)->int {
         if (n <= 0) return 256;
@@ -1437,9 +2982,9 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     };
     int nfft = coerceNfft(opt_.nfft);
     // Deterministic mode: force scalar DFT in core
-    heartpy::setDeterministic(opt_.deterministic);
-    auto ps = welchPowerSpectrum(yBufferD_, effFs, nfft, opt_.overlap);
-    const auto &frq = ps.first; const auto &P = ps.second;
+    spectral_.deterministic = opt_.deterministic;
+    welchPowerSpectrum(win, effFs, nfft, opt_.overlap, spectral_, psdFreqs_, psdPow_);
+    const auto &frq = psdFreqs_; const auto &P = psdPow_;
     if (frq.size() < 4 || frq.size() != P.size()) return;
 
     auto inBand = [](double f, double c, double bw){ return std::fabs(f - c) <= bw; };
@@ -1483,7 +3028,7 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     // EMA smoothing over time (tau = 8s when active)
     double now = lastTs_;
     double dt = (lastSnrUpdateTime_ > 0.0) ? (now - lastSnrUpdateTime_) : psdUpdateSec_;
-    if (opt_.deterministic) dt = psdUpdateSec_;
+    if (opt_.deterministic) dt = psdUpdateSec_ * psdScale_;
     double tau = activeSnr ? opt_.snrActiveTauSec : snrTauSec_;
     double alpha = 1.0 - std::exp(-dt / std::max(1e-3, tau));
     if (!snrEmaValid_) { snrEmaDb_ = snrDbInst; snrEmaValid_ = true; }
@@ -1516,11 +3061,11 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     // RR bimodality and pair consistency
     double shortFrac = 0.0, longRR = 0.0, rrCV = 0.0, pairFrac = 0.0;
     double shortMean = 0.0, longMean = 0.0;
+    // Median of this poll's RR list, shared by the checks below (out.rrList is not modified here)
+    const double rrMedian = out.rrList.empty() ? 0.0 : medianOfRR(out.rrList);
     if (!out.rrList.empty()) {
-        std::vector<double> rr = out.rrList;
-        // median
-        std::vector<double> tmp = rr; std::nth_element(tmp.begin(), tmp.begin() + tmp.size()/2, tmp.end());
-        double med = tmp[tmp.size()/2];
+        const std::vector<double>& rr = out.rrList;
+        double med = rrMedian;
         double thr = 0.8 * med;
         double sumLong = 0.0, sumShort = 0.0; int cntLong = 0, cntShort = 0;
         for (double r : rr) { if (r >= thr) { sumLong += r; ++cntLong; } else { sumShort += r; ++cntShort; } }
@@ -1590,8 +3135,7 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     {
         double bpmEst = 0.0;
         if (!out.rrList.empty()) {
-            std::vector<double> tmp = out.rrList; std::nth_element(tmp.begin(), tmp.begin() + tmp.size()/2, tmp.end());
-            double med = tmp[tmp.size()/2]; if (med > 1e-6) bpmEst = 60000.0 / med;
+            if (rrMedian > 1e-6) bpmEst = 60000.0 / rrMedian;
         }
         bool dblActive = (doublingHintActive_ || softDoublingActive_ || doublingActive_);
         if (dblActive && (lastTs_ >= 20.0) && (bpmEst > 0.0 && bpmEst < opt_.chokeBpmThreshold)) {
@@ -1608,13 +3152,12 @@ void RealtimeAnalyzer::updateSNR(HeartMetrics& out) {
     bool psdHintPass = warmupPassed && (ratioHalfFund >= opt_.pHalfOverFundThresholdSoft) && halfStable && (out.quality.rejectionRate <= 0.05) && (rrCV <= 0.30);
     // Optional subdominant PSD fallback (>=1.6 for ~6s, slightly looser drift)
     bool halfStableLoose = false; if (halfF0Hist_.size() >= 2) { double fmin2 = *std::min_element(halfF0Hist_.begin(), halfF0Hist_.end()); double fmax2 = *std::max_element(halfF0Hist_.begin(), halfF0Hist_.end()); halfStableLoose = ((fmax2 - fmin2) <= 0.08); }
-    static double psdLoStart = 0.0;
     bool psdLoNow = warmupPassed && (ratioHalfFund >= opt_.pHalfOverFundThresholdLow) && halfStableLoose && (out.quality.rejectionRate <= 0.05) && (rrCV <= 0.20);
     bool psdLoHold = false;
-    if (psdLoNow) { if (psdLoStart <= 0.0) psdLoStart = lastTs_; if ((lastTs_ - psdLoStart) >= 6.0) psdLoHold = true; }
-    else { psdLoStart = 0.0; }
+    if (psdLoNow) { if (psdLoStart_ <= 0.0) psdLoStart_ = lastTs_; if ((lastTs_ - psdLoStart_) >= 6.0) psdLoHold = true; }
+    else { psdLoStart_ = 0.0; }
     // RR-centric fallback: sustained high BPM, clean & stable RR around ~150 BPM (short mode)
-    double medRR = 0.0; if (!out.rrList.empty()) { std::vector<double> tmp=out.rrList; std::nth_element(tmp.begin(), tmp.begin()+tmp.size()/2, tmp.end()); medRR = tmp[tmp.size()/2]; }
+    double medRR = rrMedian;
     bool rrBand = (medRR >= 370.0 && medRR <= 450.0);
     bool highBpmPersist = bpmHighActive_ && ((lastTs_ - std::max(0.0, bpmHighStartTs_)) >= 8.0);
     bool rrClean = (rrCV <= 0.10) && (out.quality.rejectionRate <= 0.03);
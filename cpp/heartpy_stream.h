@@ -5,71 +5,181 @@
 #include <deque>
 #include <cstddef>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <thread>
+#include <condition_variable>
 #include <algorithm>
 #include <limits>
+#include <functional>
 #include "heartpy_core.h"
+#include "heartpy_capture.h"
 
 namespace heartpy {
 
-// Simple fixed-capacity ring buffer for POD types
+// Fixed-capacity ring buffer for POD types. Capacity is rounded up to a power of two
+// so indexing is a mask; bulk copies and front drops are at most two block moves / O(1).
 template <typename T>
 class RingBuffer {
 public:
     RingBuffer() = default;
     explicit RingBuffer(size_t cap) { reconfigure(cap); }
+    // Resize capacity (rounded up to a power of two), keeping the newest elements
     void reconfigure(size_t cap) {
-        if (cap == 0) cap = 1;
-        std::vector<T> nb(cap);
-        // copy last min(size, cap) elements into new buffer
-        size_t keep = std::min(size_, cap);
-        for (size_t i = 0; i < keep; ++i) {
-            nb[keep - 1 - i] = at(size_ - 1 - i);
-        }
+        size_t c = 1;
+        while (c < cap) c <<= 1;
+        std::vector<T> nb(c);
+        size_t keep = std::min(size_, c);
+        for (size_t i = 0; i < keep; ++i) nb[i] = at(size_ - keep + i);
         buf_.swap(nb);
-        cap_ = cap;
+        cap_ = c; mask_ = c - 1;
         head_ = 0;
         size_ = keep;
     }
     size_t capacity() const { return cap_; }
     size_t size() const { return size_; }
     bool empty() const { return size_ == 0; }
-    // Push single value
+    void clear() { head_ = 0; size_ = 0; }
+    // Push single value (overwrites the oldest when full)
     inline void push_back(const T& v) {
         if (cap_ == 0) reconfigure(1);
         if (size_ < cap_) {
-            buf_[(head_ + size_) % cap_] = v;
+            buf_[(head_ + size_) & mask_] = v;
             ++size_;
         } else {
-            // overwrite oldest
             buf_[head_] = v;
-            head_ = (head_ + 1) % cap_;
+            head_ = (head_ + 1) & mask_;
         }
     }
-    // Push many values
+    // Push many values; only the newest capacity() values are retained
     void push_back_many(const T* data, size_t n) {
         if (!data || n == 0) return;
-        for (size_t i = 0; i < n; ++i) push_back(data[i]);
+        if (cap_ == 0) reconfigure(n);
+        if (n >= cap_) {
+            std::copy(data + (n - cap_), data + n, buf_.begin());
+            head_ = 0; size_ = cap_;
+            return;
+        }
+        size_t over = (size_ + n > cap_) ? (size_ + n - cap_) : 0;
+        drop_front(over);
+        size_t tail = (head_ + size_) & mask_;
+        size_t n1 = std::min(n, cap_ - tail);
+        std::copy(data, data + n1, buf_.begin() + tail);
+        std::copy(data + n1, data + n, buf_.begin());
+        size_ += n;
     }
-    // Access i-th element from oldest (0..size-1)
-    inline const T& at(size_t i) const {
-        return buf_[(head_ + i) % cap_];
+    // Discard the n oldest values in O(1)
+    inline void drop_front(size_t n) {
+        if (n >= size_) { head_ = 0; size_ = 0; return; }
+        head_ = (head_ + n) & mask_;
+        size_ -= n;
     }
-    // Snapshot into contiguous vector (oldest..newest)
-    void snapshot(std::vector<T>& out) const {
+    // Access i-th element from oldest (0..size-1)
+    inline const T& at(size_t i) const { return buf_[(head_ + i) & mask_]; }
+    inline T& at(size_t i) { return buf_[(head_ + i) & mask_]; }
+    inline const T& back() const { return at(size_ - 1); }
+    // Snapshot into contiguous vector (oldest..newest), converting element type if needed
+    template <typename U>
+    void snapshot(std::vector<U>& out) const {
         out.resize(size_);
         if (size_ == 0) return;
-        size_t first = head_;
-        size_t n1 = std::min(size_, cap_ - first);
-        for (size_t i = 0; i < n1; ++i) out[i] = buf_[first + i];
-        for (size_t i = n1; i < size_; ++i) out[i] = buf_[i - n1];
+        size_t n1 = std::min(size_, cap_ - head_);
+        std::copy(buf_.begin() + head_, buf_.begin() + head_ + n1, out.begin());
+        std::copy(buf_.begin(), buf_.begin() + (size_ - n1), out.begin() + n1);
     }
 private:
     std::vector<T> buf_;
     size_t cap_{0};
+    size_t mask_{0};
     size_t head_{0};
     size_t size_{0};
 };
 
+// Order-statistic multiset: size-augmented treap with O(log n) expected insert/erase and
+// k-th smallest queries. Nodes live in a pooled vector with a free list, so once warm,
+// updates do not allocate.
+template <typename T>
+class OrderStatTree {
+public:
+    size_t size() const { return root_ < 0 ? 0 : nodes_[root_].size; }
+    bool empty() const { return root_ < 0; }
+    void clear() { nodes_.clear(); free_.clear(); root_ = -1; }
+    template <typename It>
+    void assign(It first, It last) {
+        nodes_.clear(); free_.clear(); root_ = -1;
+        for (; first != last; ++first) insert(*first);
+    }
+    void insert(const T& v) {
+        int a, b;
+        split(root_, v, false, a, b);
+        root_ = merge(merge(a, alloc(v)), b);
+    }
+    // Removes one occurrence of v; returns false if absent
+    bool erase(const T& v) {
+        int a, mid, b;
+        split(root_, v, false, a, mid);  // a: < v
+        split(mid, v, true, mid, b);     // mid: == v
+        bool found = mid >= 0;
+        if (found) {
+            int dead = mid;
+            mid = merge(nodes_[mid].l, nodes_[mid].r);
+            free_.push_back(dead);
+        }
+        root_ = merge(merge(a, mid), b);
+        return found;
+    }
+    // 0-based k-th smallest; k < size()
+    const T& kth(size_t k) const {
+        int t = root_;
+        for (;;) {
+            size_t ls = sz(nodes_[t].l);
+            if (k < ls) t = nodes_[t].l;
+            else if (k == ls) return nodes_[t].v;
+            else { k -= ls + 1; t = nodes_[t].r; }
+        }
+    }
+    // Upper median (matches nth_element at size()/2)
+    const T& median() const { return kth(size() / 2); }
+    // Nearest-rank quantile, q in [0,1]
+    const T& quantile(double q) const {
+        const size_t n = size();
+        size_t k = static_cast<size_t>(std::max(0.0, std::min(1.0, q)) * static_cast<double>(n));
+        return kth(std::min(k, n - 1));
+    }
+    size_t bytesUsed() const { return nodes_.capacity() * sizeof(Node) + free_.capacity() * sizeof(int); }
+
+private:
+    struct Node { T v; int l, r; uint32_t pri; uint32_t size; };
+    size_t sz(int t) const { return t < 0 ? 0 : nodes_[t].size; }
+    void pull(int t) { nodes_[t].size = static_cast<uint32_t>(1 + sz(nodes_[t].l) + sz(nodes_[t].r)); }
+    int alloc(const T& v) {
+        seed_ ^= seed_ << 13; seed_ ^= seed_ >> 17; seed_ ^= seed_ << 5; // xorshift32
+        Node n {v, -1, -1, seed_, 1};
+        if (!free_.empty()) { int i = free_.back(); free_.pop_back(); nodes_[i] = n; return i; }
+        nodes_.push_back(n);
+        return static_cast<int>(nodes_.size() - 1);
+    }
+    // Left part gets values < v (or <= v when inclusive)
+    void split(int t, const T& v, bool inclusive, int& l, int& r) {
+        if (t < 0) { l = r = -1; return; }
+        bool left = inclusive ? !(v < nodes_[t].v) : (nodes_[t].v < v);
+        if (left) { split(nodes_[t].r, v, inclusive, nodes_[t].r, r); l = t; }
+        else { split(nodes_[t].l, v, inclusive, l, nodes_[t].l); r = t; }
+        pull(t);
+    }
+    int merge(int a, int b) {
+        if (a < 0) return b;
+        if (b < 0) return a;
+        if (nodes_[a].pri > nodes_[b].pri) { nodes_[a].r = merge(nodes_[a].r, b); pull(a); return a; }
+        nodes_[b].l = merge(a, nodes_[b].l); pull(b); return b;
+    }
+    std::vector<Node> nodes_;
+    std::vector<int> free_;
+    int root_ {-1};
+    uint32_t seed_ {2463534242u};
+};
+
 struct SBiquad {
     double b0{0}, b1{0}, b2{0}, a1{0}, a2{0};
     double z1{0}, z2{0};
@@ -93,47 +203,370 @@ struct SBiquadD {
     }
 };
 
+// Causal per-sample preprocessing for the streaming path (streaming counterparts of
+// interpolateClipping / hampelFilter / removeBaselineWander / enhancePeaks).
+// Each input yields its output immediately, except inside a clipped run, which is held
+// for at most clipHoldMax samples so it can be bridged to the next unclipped sample.
+class StreamPreprocessor {
+public:
+    void configure(double fs, const Options& opt);
+    bool active() const { return clip_ || hampel_ || baseline_ || enhance_; }
+    size_t bytesUsed() const;
+    // Checkpoint visitor (see RealtimeAnalyzer::checkpoint)
+    template <typename IO> void visitState(IO& io);
+    // Feed one raw sample (tag travels with it, e.g. its timestamp); appends 0..k outputs
+    void process(float v, double tag, std::vector<float>& outV, std::vector<double>& outTag);
+private:
+    void emitStage2(float v, double tag, std::vector<float>& outV, std::vector<double>& outTag);
+    bool clip_ {false}, hampel_ {false}, baseline_ {false}, enhance_ {false};
+    // clipping bridge
+    double clipThr_ {1020.0};
+    size_t clipHoldMax_ {1};
+    bool   hasGood_ {false};
+    bool   clipUnbridged_ {false};
+    float  lastGood_ {0.0f};
+    std::vector<float> holdV_;
+    std::vector<double> holdTag_;
+    // rolling-median Hampel over the trailing window W: the ring plus its values kept sorted, so a
+    // sample costs one insert/erase shift (O(W) memmove), an O(1) median and an O(log W) MAD.
+    // The sorted copy is not checkpointed; it is rebuilt from the ring when out of step.
+    double hampelThr_ {3.0};
+    std::vector<float> hampelRing_;
+    size_t hampelFed_ {0};
+    std::vector<float> hampelSorted_;
+    // one-pole baseline removal
+    double blAlpha_ {0.0};
+    bool   blStarted_ {false};
+    double blPrevIn_ {0.0}, blPrevOut_ {0.0};
+    // derivative enhancer
+    bool   enStarted_ {false};
+    double enPrev_ {0.0};
+};
+
+// Streaming resampler for timestamped input: a cubic Hermite through the incoming (t, x) points
+// (centred-difference slopes) evaluated on a uniform grid anchored at the first sample. Grid
+// points up to the newest-but-one sample are emitted as each sample arrives. Segments longer than
+// kLinearGap grid periods (dropouts) are bridged linearly; gaps over kRestartSec re-anchor the grid.
+class TimestampResampler {
+public:
+    static constexpr double kLinearGap = 3.0;
+    static constexpr double kRestartSec = 2.0;
+    void configure(double fs);
+    // Appends the grid samples that became computable; returns how many inputs were skipped
+    // because their timestamp did not increase
+    size_t process(const float* x, const double* t, size_t n, std::vector<float>& outX, std::vector<double>& outT);
+    template <typename IO> void visitState(IO& io);
+private:
+    double slope(int i) const;
+    void emitSegment(int a, std::vector<float>& outX, std::vector<double>& outT);
+    double dt_ {0.0};
+    double t_[4] {}, x_[4] {};     // newest input points, oldest first
+    int count_ {0};
+    double anchor_ {0.0};          // grid time k is anchor_ + k * dt_
+    uint64_t k_ {0};
+};
+
+// Single-producer/single-consumer sample queue for push()-side ingestion. The producer never
+// takes a lock; under DROP_OLDEST it overwrites unread slots and the consumer detects the
+// overrun seqlock-style (claim_ is raised before overwriting, tail_ published after writing).
+class IngestQueue {
+public:
+    enum : uint8_t { kBatchStart = 1, kHasTs = 2 };
+    void configure(size_t capacity, Options::Backpressure policy);
+    bool enabled() const { return cap_ > 0; }
+    // Producer side (one thread)
+    void push(const float* x, const double* ts, size_t n);
+    // The consumer is gone for good: BLOCK pushes stop waiting and overwrite unread slots
+    void release() { released_.store(true, std::memory_order_release); }
+    // Consumer side (one thread): pops all published samples; returns the count lost to overwrites
+    size_t drain(std::vector<float>& x, std::vector<double>& ts, std::vector<uint8_t>& flags);
+    unsigned long long decimatedTotal() const { return decimated_.load(std::memory_order_relaxed); }
+    unsigned long long blockedTotal() const { return blocked_.load(std::memory_order_relaxed); }
+    unsigned long long highWater() const { return highWater_.load(std::memory_order_relaxed); }
+    size_t bytesUsed() const { return cap_ * sizeof(Slot); }
+    void restoreCounters(unsigned long long decimated, unsigned long long blocked, unsigned long long highWater) {
+        decimated_ = decimated; blocked_ = blocked; highWater_ = highWater;
+    }
+private:
+    struct Slot { std::atomic<float> v {0.0f}; std::atomic<double> ts {0.0}; std::atomic<uint8_t> flags {0}; };
+    std::unique_ptr<Slot[]> slots_;
+    size_t cap_ {0}, mask_ {0};
+    Options::Backpressure policy_ {Options::Backpressure::DROP_OLDEST};
+    alignas(64) std::atomic<size_t> tail_ {0};
+    alignas(64) std::atomic<size_t> claim_ {0};
+    alignas(64) std::atomic<size_t> head_ {0};
+    std::atomic<unsigned long long> decimated_ {0}, blocked_ {0}, highWater_ {0};
+    std::atomic<bool> released_ {false};
+};
+
+// Wait-free single-writer/single-reader triple buffer. The writer fills back() and publishes;
+// the reader swaps in the freshest published slot with refresh() and reads front().
+template <typename T>
+class TripleBuffer {
+public:
+    T& back() { return slots_[back_]; }
+    void publish() { back_ = mid_.exchange(back_ | kFresh, std::memory_order_acq_rel) & kIdx; }
+    bool refresh() {
+        if (!(mid_.load(std::memory_order_relaxed) & kFresh)) return false;
+        front_ = mid_.exchange(front_, std::memory_order_acq_rel) & kIdx;
+        return true;
+    }
+    const T& front() const { return slots_[front_]; }
+private:
+    static constexpr unsigned kIdx = 3, kFresh = 4;
+    T slots_[3];
+    unsigned back_ {0}, front_ {1};
+    std::atomic<unsigned> mid_ {2};
+};
+
+// Immutable result snapshot published by the background worker
+struct AnalyzerSnapshot {
+    unsigned long long seq = 0;   // increments with every metrics update (0 = none yet)
+    HeartMetrics metrics;
+    QualityInfo quality;
+    std::vector<int> peaks;
+    std::vector<double> rr;
+    std::vector<float> display;
+};
+
+// Provisional beat, emitted from inside sample processing (one sample of look-ahead). A later
+// stronger peak within the refractory period arrives as REPLACED for the same beat; poll()
+// results remain authoritative (window recalibration may still move peaks).
+struct BeatEvent {
+    enum class Kind : uint8_t { ACCEPTED, REPLACED } kind = Kind::ACCEPTED;
+    uint64_t absIndex = 0;     // sample index since stream start (post-preprocessing)
+    double timestamp = 0.0;    // seconds, on the analyzer's timebase
+    float amplitude = 0.0f;    // filtered amplitude at the peak
+    double rrMs = 0.0;         // provisional RR to the previous beat (0 for the first)
+};
+
+// Persistent heap held by one analyzer, per component (bytes; deques are estimated by block).
+// Poll-time temporaries (window snapshot, batch analysis buffers) are not included.
+struct MemoryFootprint {
+    size_t object = 0;           // sizeof(RealtimeAnalyzer)
+    size_t rawWindow = 0;        // raw samples (Options::StorageMode::FULL only)
+    size_t filteredWindow = 0;   // filtered samples (float or int16)
+    size_t display = 0;          // decimator, stage and front ring
+    size_t rollingStats = 0;     // thresholding windows and monotonic deques
+    size_t peaks = 0;            // absolute peak indices and cached peak/RR views
+    size_t ingestQueue = 0;      // SPSC slots and drain buffers
+    size_t preprocessing = 0;    // causal preprocessing state
+    size_t scratch = 0;          // reused scratch vectors
+    size_t snapshots = 0;        // background worker snapshot slots (estimated)
+    size_t total = 0;
+};
+
+// One analysis update of an offline run (RealtimeAnalyzer::analyzeRecording)
+struct StreamUpdate {
+    double t = 0.0;              // stream time of the newest sample the update saw (seconds)
+    HeartMetrics metrics;
+};
+
+// One beat of an incremental poll result (RealtimeAnalyzer::pollDelta), keyed by absolute index
+struct BeatRecord {
+    uint64_t absIndex = 0;
+    double rrMs = std::numeric_limits<double>::quiet_NaN(); // interval ending at this beat (NaN: unknown)
+    bool accepted = true;                                   // binaryPeakMask
+};
+
+// What changed since the previous pollDelta(): apply to a mirror with applyPollDelta()
+struct PollDelta {
+    enum Scalar { kBpm, kSdnn, kRmssd, kSdsd, kPnn20, kPnn50, kSd1, kSd2, kLfHf, kBreathingRate,
+                  kSnrDb, kConfidence, kRejectionRate, kGoodQuality, kScalarCount };
+    uint64_t seq = 0;                 // 1, 2, ... per delta; a gap means the mirror is stale
+    bool reset = false;               // clear the mirror first; `added` then holds the whole window
+    uint64_t windowStartAbs = 0;      // beats below this index expired: drop them
+    std::vector<BeatRecord> added;    // ascending; usually the newest one or two beats
+    std::vector<BeatRecord> revised;  // same index, new rr or accepted flag
+    std::vector<uint64_t> removed;    // withdrawn beats still inside the window
+    // Warm-up batch output is not one RR interval / mask entry per beat: then the full list is
+    // carried instead (rrList, mask) and the beats' own rr/accepted are not meaningful
+    bool rrPerBeat = true, maskPerBeat = true;
+    std::vector<double> rrList;
+    std::vector<int> mask;
+    uint32_t changedScalars = 0;      // bits (1u << Scalar)
+    double scalars[kScalarCount] = {};
+    bool warningChanged = false;
+    std::string qualityWarning;
+};
+
+// Consumer side of pollDelta(): keeps beats ascending and rebuilds peakList (relative to the
+// window start), rrList and binaryPeakMask on request
+struct BeatMirror {
+    std::vector<BeatRecord> beats;
+    uint64_t windowStartAbs = 0;
+    bool rrPerBeat = true, maskPerBeat = true;
+    std::vector<double> rrList;       // used when !rrPerBeat
+    std::vector<int> mask;            // used when !maskPerBeat
+    double scalars[PollDelta::kScalarCount] = {};
+    std::string qualityWarning;
+    void apply(const PollDelta& d);
+    void rebuild(std::vector<int>& peakList, std::vector<double>& rrOut, std::vector<int>& mask) const;
+};
+
 // A minimal, non-breaking streaming API skeleton.
 // Internally uses a batch fallback on the sliding window until
 // fully incremental path (peaks/filters) is implemented in later phases.
 class RealtimeAnalyzer {
 public:
     explicit RealtimeAnalyzer(double fs, const Options& opt = {});
+    ~RealtimeAnalyzer();
 
     void setWindowSeconds(double sec);              // 10–60 seconds typical
     void setUpdateIntervalSeconds(double sec);      // default 1.0 second
-    void setPsdUpdateSeconds(double sec) { std::lock_guard<std::mutex> lock(dataMutex_); psdUpdateSec_ = std::clamp(sec, 0.5, 5.0); }
-    void setDisplayHz(double hz) { std::lock_guard<std::mutex> lock(dataMutex_); displayHz_ = std::clamp(hz, 10.0, 120.0); }
+    void setPsdUpdateSeconds(double sec);
+    void setDisplayHz(double hz);
     // Convenience presets (may adjust filter/threshold defaults)
-    void applyPresetTorch() { opt_.lowHz = 0.7; opt_.highHz = 3.0; opt_.refractoryMs = std::max(300.0, opt_.refractoryMs); opt_.useHPThreshold = true; opt_.maPerc = std::max(10.0, std::min(60.0, opt_.maPerc)); }
-    void applyPresetAmbient() { opt_.lowHz = 0.5; opt_.highHz = 3.5; opt_.thresholdScale = std::max(0.5, opt_.thresholdScale); opt_.refractoryMs = std::max(320.0, opt_.refractoryMs); opt_.useHPThreshold = true; opt_.maPerc = std::max(10.0, std::min(60.0, opt_.maPerc)); }
+    void applyPresetTorch();
+    void applyPresetAmbient();
 
     void push(const float* samples, size_t n, double t0 = 0.0);
     void push(const std::vector<double>& samples, double t0 = 0.0);
     // Optional: per-sample timestamps in seconds for variable-fps sources
     void push(const float* samples, const double* timestamps, size_t n);
+    // No further poll() will drain the ingestion queue (e.g. the session is being closed while a
+    // producer may still push): BLOCK backpressure stops waiting and drops the oldest samples
+    void releaseIngest() { ingest_.release(); }
+    // Catch-up ingestion of a historical batch of any size (e.g. buffered data after a reconnect):
+    // nothing is clamped. Samples are processed in blocks of one update interval, each followed by
+    // an analysis update; onUpdate receives the stream time of the block's last sample and the
+    // result, i.e. the series a live session would have produced. Only the last window of samples
+    // feeds the display decimator. Samples queued by earlier push() calls are processed first.
+    // timestamps may be null. Call it from the polling thread; with the background worker its
+    // updates pause for the duration. Returns the number of updates produced.
+    size_t backfill(const float* samples, const double* timestamps, size_t n,
+                    const std::function<void(double, const HeartMetrics&)>& onUpdate = {});
+    // Offline stream-equivalent analysis: the update series a live session would produce by
+    // pushing `chunk` samples at a time (0 = one update interval) and polling after each push,
+    // computed on the calling thread in one call. No ingestion queue, worker or display feed is
+    // involved, and chunks are never clamped. setup() configures the analyzer before the first
+    // sample (window, update interval, presets). timestamps may be null.
+    static std::vector<StreamUpdate> analyzeRecording(double fs, const Options& opt, const float* samples,
+        const double* timestamps, size_t n, size_t chunk = 0,
+        const std::function<void(RealtimeAnalyzer&)>& setup = {});
 
-    // If a new update is ready (>= update interval), fills out and returns true
+    // If a new update is ready (>= update interval), fills out and returns true.
+    // With Options::backgroundWorker this only reads the latest published snapshot.
     bool poll(HeartMetrics& out);
+    // Incremental poll: on a new update, reports only the beats appended, revised or expired and
+    // the scalars that changed since the previous pollDelta(), so bridges serialize O(changes)
+    // instead of the whole window. The first delta (and the one after resetPollDelta()) is a
+    // reset carrying the full window. Call from the poll() thread; do not mix with poll().
+    bool pollDelta(PollDelta& out);
+    void resetPollDelta();
+
+    QualityInfo getQuality() const;
+    std::vector<int> latestPeaks() const;
+    std::vector<double> latestRR() const;
+    // Nearest-rank quantile (q in [0,1]) of the RR intervals (ms) between the window's peaks;
+    // O(log n) from the running order-statistic set, 0 with fewer than two peaks
+    double rrQuantile(double q) const;
+    // Min/max-decimated filtered window; served from its own lock, never waits on ingestion
+    std::vector<float> displayBuffer() const;
+    MemoryFootprint memoryFootprint() const;
+    // Opt-in beat events. Runs synchronously on the thread that processes samples (push();
+    // poll() or the background worker when the ingestion queue is on) with the analyzer's
+    // lock held: keep it short and do not call back into the analyzer. nullptr disables.
+    void setBeatCallback(std::function<void(const BeatEvent&)> cb);
+    size_t bytesUsed() const { return memoryFootprint().total; }
+
+    // Compact binary checkpoint of the full analysis state (filters, windows, peaks, EMAs,
+    // harmonic-suppression and ma_perc state, counters). Queued samples are processed first.
+    // A restored analyzer continues with identical output, skipping warm-up.
+    std::vector<uint8_t> checkpoint();
+    // Returns nullptr for malformed or incompatible blobs. If runtime is given, its threading
+    // mode (useIngestQueue, backgroundWorker) replaces the saved one; it does not affect the
+    // analysis state.
+    static std::unique_ptr<RealtimeAnalyzer> restore(const uint8_t* data, size_t n, const Options* runtime = nullptr);
 
-    QualityInfo getQuality() const { std::lock_guard<std::mutex> lock(dataMutex_); return lastQuality_; }
-    std::vector<int> latestPeaks() const { std::lock_guard<std::mutex> lock(dataMutex_); return lastPeaks_; }
-    std::vector<double> latestRR() const { std::lock_guard<std::mutex> lock(dataMutex_); return lastRR_; }
-    std::vector<float> displayBuffer() const { std::lock_guard<std::mutex> lock(dataMutex_); return displayBuf_; }
+    // Capture log (heartpy_capture.h): a checkpoint of the current state, then every batch the
+    // analysis consumes (after the ingestion queue), every analysis update and setting change.
+    // Encoding runs under the analyzer's lock into a preallocated buffer; a writer thread does
+    // the file I/O. Returns false if the file cannot be created.
+    bool startCapture(const std::string& path, size_t bufferBytes = size_t(1) << 20);
+    // Flushes and closes the capture; returns its final statistics
+    CaptureStats stopCapture();
+    CaptureStats captureStats() const;
+    // Rebuilds a captured session and re-runs its inputs on the calling thread; onUpdate sees each
+    // update the original session produced. Output matches bit-exactly when pushes do not race an
+    // update (single thread, ingestion queue or background worker) and pollBudgetMs did not drive
+    // the governor from wall-clock costs. nullptr for malformed captures (a torn tail is fine).
+    static std::unique_ptr<RealtimeAnalyzer> replayCapture(const uint8_t* data, size_t n,
+        const std::function<void(const HeartMetrics&)>& onUpdate = {});
 
 private:
+    // Runs one analysis update on the calling thread (poll() body without a worker)
+    bool computeUpdate(HeartMetrics& out);
+    std::vector<float> readDisplay() const;
+    // Background worker (Options::backgroundWorker); started on first push/poll
+    void ensureWorker();
+    void workerLoop();
+    template <typename IO> void visitState(IO& io);
+    void checkpointLocked(std::vector<uint8_t>& out);   // caller holds dataMutex_, ingest drained
     void append(const float* x, size_t n);
+    void appendTs(const float* samples, const double* timestamps, size_t n);
+    // Processes everything queued by push() when the ingestion queue is enabled
+    void drainIngest();
     void trimToWindow();
-    void updateSNR(HeartMetrics& out);
+    void commitAuditCounters(QualityInfo& q);      // fills audit counters, resets per-poll ones
+    // Compute governor: picks this poll's cadence scales; adapts the level from the poll cost
+    void governorBegin();
+    void governorEnd(double costMs);
+    void updateSNR(HeartMetrics& out, const std::vector<double>& win);
+    // Window storage (vector or ring); relative indices run oldest..newest
+    size_t winLen() const { return quant_ ? ringQ_.size() : useRing_ ? ringFilt_.size() : filt_.size(); }
+    float filtAt(size_t rel) const {
+        if (quant_) return ringQ_.at(rel) * qScale_;
+        return useRing_ ? ringFilt_.at(rel) : filt_[rel];
+    }
+    size_t storeRaw(const float* x, size_t n);   // returns the relative index of x[0]
+    void storeFilt(size_t rel, float y);
+    void reconfigureRings(size_t cap);
+    // INT16 storage: re-fit the power-of-two scale (coarser on overflow, finer once per window)
+    void requantize(int exp);
+    // lastPeaks_/lastRR_ are rebuilt from peaksAbs_ lazily (only when read)
+    void markPeaksDirty(double effFs) { peaksDirty_ = true; peaksViewFs_ = effFs; }
+    void materializePeaks();
+    // peaksAbs_ edits go through these so rrIntervals_ tracks the gaps between consecutive peaks
+    void pushPeakAbs(size_t absIdx);
+    void replaceLastPeakAbs(size_t absIdx);
+    void popFrontPeakAbs();
+    void rebuildRRIntervals();
+    void buildPeakViews(std::vector<int>* peaks, std::vector<double>* rr) const;
+    // Incremental display decimation: feed each filtered sample, publish once per push
+    void feedDisplay(float y, double effFs);
+    void emitBeat(BeatEvent::Kind kind, float amp, double effFs);  // peaksAbs_.back() is the beat
+    // Beat latency/revision telemetry
+    void markBatchEntry();                                   // before storing a batch
+    double entryWallOf(size_t absIdx) const;                 // steady-clock seconds, NaN if unknown
+    void trackPolledBeats(const std::vector<int>& peakRel, size_t firstAbsSnap, double effFs);
+    // ma_perc grid: advance every candidate over the samples not yet seen. rmeanAvg is the mean
+    // rolling mean of the 0..1024 scaled window, wden its raw range; the scaled rolling mean is
+    // only formed over the new samples (O(new + 0.75 s) per poll).
+    void advanceMaCandidates(const std::vector<double>& win, double rmeanAvg, double wden,
+                             size_t firstAbsSnap, double fsEff);
+    void publishDisplay();
+    // Runs the causal preprocessing chain; returns false if nothing is ready to emit yet
+    bool preprocessBatch(const float*& x, const double*& ts, size_t& n);
     // Thread safety
     mutable std::mutex dataMutex_;
+    std::unique_ptr<CaptureWriter> capture_;   // guarded by dataMutex_
 
     // Performance scratch buffers (reused to avoid frequent reallocations)
     double medianOfRR(const std::vector<double>& rr);
+    OrderStatTree<size_t> rrIntervals_;      // peak-to-peak gaps (samples) of peaksAbs_
+    double lastRRMedian_ {0.0};              // median of lastRR_, refreshed whenever lastRR_ is rebuilt
     std::vector<double> scratchRR_;
-    std::vector<double> yBufferD_;
     std::vector<double> noiseScratch_;
+    SpectralContext spectral_;               // PSD window/plan/scratch; per analyzer, never shared
+    std::vector<double> psdFreqs_, psdPow_;
     std::vector<char> keepScratch_;
+    std::vector<float> preOut_;
+    std::vector<double> preOutTs_;
+    std::vector<float> tsKeepX_;
+    std::vector<double> tsKeepT_;
+    std::vector<float> rsX_;
+    std::vector<double> rsT_;
 
     double fs_ {0.0};              // nominal fs from constructor
     Options opt_ {};
@@ -154,19 +587,86 @@ private:
     // Sliding window buffers (raw for now; later phases will hold filtered/causal)
     std::vector<float> signal_;
     std::vector<float> filt_;
-    std::vector<float> displayBuf_; // downsampled view for UI
+    // Display decimator: each bucket of 2*stride samples contributes its min and max (in time order)
+    size_t dispBucketLen_ {0};
+    size_t dispFill_ {0};
+    float  dispMin_ {0.0f}, dispMax_ {0.0f};
+    size_t dispMinAt_ {0}, dispMaxAt_ {0};
+    std::vector<float> displayPending_;         // points produced during the current push
+    // Published display (double-buffered): producer stages new points, readers fold them into
+    // their front ring. Guarded by displayMutex_ only.
+    mutable std::mutex displayMutex_;
+    mutable std::vector<float> displayStage_;
+    mutable RingBuffer<float> displayFront_;
+    mutable bool displayReset_ {false};
+    mutable bool displayFresh_ {false};         // staged points not yet folded by a reader
+    size_t displayMaxPub_ {0};
+    size_t displayMax_ {0};                     // producer-side limit (dataMutex_)
+    std::function<void(const BeatEvent&)> beatCb_;
+    // Beats from first report (event or poll) until they leave the window
+    struct BeatTrack { size_t abs; double entryWall; int revisions; bool polled; bool removed; };
+    std::vector<BeatTrack> beatTracks_, beatTracksNext_;   // next: merge scratch, swapped each poll
+    std::deque<std::pair<size_t, double>> batchEntry_;   // (first abs index, steady seconds) per batch
+    std::vector<unsigned long long> beatLatencyHist_;
+    std::vector<unsigned long long> beatRevisionHist_;
+    // Compute governor (opt_.pollBudgetMs)
+    int govLevel_ {0};
+    int govLevelActive_ {0};                 // level applied to this poll (stable signal raises it)
+    double pollCostEmaMs_ {0.0};
+    double psdScale_ {1.0};                  // PSD cadence multiplier for this poll
+    double maScale_ {1.0};                   // ma_perc retune cadence multiplier for this poll
+    bool reuseBatch_ {false};                // reuse batchCache_ instead of analyzeSignal()
+    unsigned batchPolls_ {0};
+    unsigned pollStages_ {0};
+    HeartMetrics batchCache_;
+    bool batchCacheValid_ {false};
     std::vector<SBiquad> bq_;
     std::vector<SBiquadD> bqD_;
-    // Optional ring storage (when opt_.useRingBuffer == true)
+    StreamPreprocessor pre_;
+    TimestampResampler resampler_;           // Options::resampleTimestamps
+    // Optional SPSC ingestion (opt_.useIngestQueue); drained on the consumer side
+    IngestQueue ingest_;
+    std::vector<float> ingX_;
+    std::vector<double> ingTs_;
+    std::vector<uint8_t> ingFlags_;
+    unsigned long long ingestDroppedTotal_ {0};
+    // Background worker and its published snapshots (reader side is mutable: refresh() swaps)
+    std::once_flag workerOnce_;
+    std::thread worker_;
+    std::mutex workerMutex_;
+    std::condition_variable workerCv_;
+    bool workerStop_ {false};
+    std::mutex updateMutex_;                          // worker updates vs backfill()
+    bool backfilling_ {false};                        // guarded by dataMutex_: no ingest drain, no display feed
+    bool displaySuppressed_ {false};                  // guarded by dataMutex_
+    AnalyzerSnapshot workerPub_;                      // writer-side copy of the last publish
+    mutable TripleBuffer<AnalyzerSnapshot> snapshots_;
+    unsigned long long readerSeq_ {0};
+    // pollDelta(): what the consumer's mirror holds after the last delta (reader thread only)
+    HeartMetrics deltaStaged_;
+    std::vector<BeatRecord> deltaBeats_, deltaNext_;
+    double deltaScalars_[PollDelta::kScalarCount] {};
+    std::string deltaWarning_;
+    uint64_t deltaSeq_ {0};
+    bool deltaReset_ {true};
+    // Ring storage (opt_.useRingBuffer, default): O(1) window trimming
     bool useRing_ {false};
     RingBuffer<float> ringSignal_;
     RingBuffer<float> ringFilt_;
-    size_t ringCapacity_ {0};
+    // Compact storage (opt_.storageMode)
+    bool keepRaw_ {true};
+    bool quant_ {false};                        // filtered window held in ringQ_ as int16
+    RingBuffer<int16_t> ringQ_;
+    int qExp_ {-10};                            // sample = q * 2^qExp_
+    float qScale_ {1.0f / 1024.0f};
+    size_t qRefitAbs_ {0};                      // next absolute index at which to try a finer scale
 
     // Cached outputs from last poll
     QualityInfo lastQuality_ {};
     std::vector<int> lastPeaks_ {};
     std::vector<double> lastRR_ {};
+    bool   peaksDirty_ {false};
+    double peaksViewFs_ {0.0};
 
     // Rolling stats for thresholding
     std::deque<float> rollWin_;
@@ -183,7 +683,7 @@ private:
     int refractorySamples_ {0};
     size_t firstAbs_ {0};
     size_t totalAbs_ {0};
-    std::vector<size_t> peaksAbs_;
+    std::deque<size_t> peaksAbs_;
     size_t acceptedPeaksTotal_ {0};
 
     // Audit/telemetry counters
@@ -217,6 +717,21 @@ public:
     double lastMaChangeTime_ {0.0};
     double maUpdateSec_ {3.0};
     double maPercScore_ {1e300}; // lower RR SD score is better
+    // Per-candidate HP detection kept up to date incrementally; retuning only scores the RR sums
+    struct MaCandidate {
+        double ma {0.0};
+        bool   inRun {false};              // inside an above-threshold run
+        size_t runBest {0};                // strongest sample of the open run (abs)
+        double runBestVal {0.0};
+        bool   havePend {false};           // newest peak; may still be replaced within refractory
+        size_t pend {0};
+        double pendVal {0.0};
+        std::deque<size_t> peaks;          // committed peaks inside the window (abs)
+        double gapSum {0.0}, gapSumSq {0.0}; // consecutive committed peak gaps (samples)
+    };
+    std::vector<MaCandidate> maCands_;
+    size_t maEvalAbs_ {0};                 // first abs index the candidates have not evaluated
+    double maLiftRef_ {0.0};               // raw-unit lift basis the cached decisions were made with
 
     // SNR smoothing (EMA)
     double snrEmaDb_ {0.0};
@@ -279,6 +794,7 @@ public:
     double chokeStartTs_ {0.0};
     // RR-based fallback tracking
     int    rrFallbackConsec_ {0};
+    double psdLoStart_ {0.0};                // onset of the sustained low-ratio PSD doubling hint
     bool   rrFallbackActive_ {false};
     bool   rrFallbackDrivingHint_ {false};
     double lastPollBpmEst_ {0.0};
@@ -289,12 +805,106 @@ public:
 
 // Optional plain C bridge (symbols have C linkage; still compiled as C++)
 extern "C" {
+    // Flat, versioned poll/analysis result: plain data only, nothing to free. The caller sets
+    // `size` to sizeof(hp_result); the library writes at most that many bytes (so older callers
+    // keep working as fields are appended) and reports its HP_RESULT_VERSION in `version`.
+    #define HP_RESULT_VERSION 1u
+    enum { HP_TRUNC_PEAKS = 1, HP_TRUNC_PEAKS_RAW = 2, HP_TRUNC_RR = 4, HP_TRUNC_MASK = 8, HP_TRUNC_WARNING = 16 };
+    typedef struct hp_result {
+        uint32_t size;
+        uint32_t version;
+        double bpm, sdnn, rmssd, sdsd, pnn20, pnn50, nn20, nn50, mad;
+        double sd1, sd2, sd1sd2Ratio, ellipseArea;
+        double vlf, lf, hf, lfhf, totalPower, lfNorm, hfNorm, breathingRate;
+        // Quality
+        int32_t totalBeats, rejectedBeats;
+        double rejectionRate;
+        int32_t goodQuality, doublingFlag, softDoublingFlag, hardFallbackActive;
+        double snrDb, confidence, f0Hz, maPercActive, refractoryMsActive, minRRBoundMs;
+        uint32_t pollStagesRun;
+        int32_t governorLevel;
+        double pollCostMs;
+        // Full array lengths; min(length, cap) elements were copied into hp_result_buffers
+        uint32_t peakCount, peakRawCount, rrCount, maskCount, warningLength;
+        uint32_t truncated;   // HP_TRUNC_* bits: the buffer was too small (or absent) for that array
+    } hp_result;
+    // Optional caller-owned arrays (any pointer may be null). mask is aligned to peaksRaw;
+    // warning receives the quality warning NUL-terminated.
+    typedef struct hp_result_buffers {
+        int32_t* peaks;    size_t peaksCap;
+        int32_t* peaksRaw; size_t peaksRawCap;
+        double*  rr;       size_t rrCap;
+        int32_t* mask;     size_t maskCap;
+        char*    warning;  size_t warningCap;
+    } hp_result_buffers;
+
+    // Incremental poll result (RealtimeAnalyzer::pollDelta), same size/version convention.
+    // scalars[] follows heartpy::PollDelta::Scalar; only bits set in changedScalars changed.
+    #define HP_DELTA_VERSION 1u
+    enum { HP_TRUNC_ADDED = 32, HP_TRUNC_REVISED = 64, HP_TRUNC_REMOVED = 128, HP_SCALAR_COUNT = 14 };
+    typedef struct hp_beat { uint64_t absIndex; double rrMs; int32_t accepted; } hp_beat;
+    typedef struct hp_poll_delta {
+        uint32_t size;
+        uint32_t version;
+        uint64_t seq, windowStartAbs;
+        int32_t reset, rrPerBeat, maskPerBeat, warningChanged;
+        uint32_t changedScalars;
+        double scalars[HP_SCALAR_COUNT];
+        // Full lengths; rrList/mask are only non-empty when rrPerBeat/maskPerBeat is 0
+        uint32_t addedCount, revisedCount, removedCount, rrListCount, maskCount, warningLength;
+        uint32_t truncated;   // HP_TRUNC_* bits (ADDED/REVISED/REMOVED/RR/MASK/WARNING)
+    } hp_poll_delta;
+    typedef struct hp_delta_buffers {
+        hp_beat*  added;   size_t addedCap;
+        hp_beat*  revised; size_t revisedCap;
+        uint64_t* removed; size_t removedCap;
+        double*   rrList;  size_t rrListCap;
+        int32_t*  mask;    size_t maskCap;
+        char*     warning; size_t warningCap;
+    } hp_delta_buffers;
+
     void* hp_rt_create(double fs, const heartpy::Options* opt);
     void  hp_rt_set_window(void* h, double sec);
     void  hp_rt_set_update_interval(void* h, double sec);
     void  hp_rt_push(void* h, const float* x, size_t n, double t0);
     // Per-sample timestamped push (seconds)
     void  hp_rt_push_ts(void* h, const float* x, const double* ts, size_t n);
+    // Unclamped catch-up ingestion (RealtimeAnalyzer::backfill); ts may be null, cb may be null.
+    // Returns the number of updates produced.
+    typedef void (*hp_rt_update_cb)(void* user, double t, const heartpy::HeartMetrics* m);
+    size_t hp_rt_backfill(void* h, const float* x, const double* ts, size_t n, hp_rt_update_cb cb, void* user);
     int   hp_rt_poll(void* h, heartpy::HeartMetrics* out);
+    // hp_rt_poll into a flat result and caller buffers (bufs may be null). The metrics are staged
+    // in storage owned by the handle, so with Options::backgroundWorker a poll does no heap
+    // allocation once the arrays have reached their working size. Returns 1 when a new update was
+    // written, 0 when none is ready, -1 when out is null or out->size is too small for the header.
+    int   hp_rt_poll_into(void* h, hp_result* out, const hp_result_buffers* bufs);
+    // Copies the last hp_rt_poll_into result again, e.g. into buffers grown after a truncation.
+    // Returns 1, 0 when nothing was polled yet, -1 as above.
+    int   hp_rt_last_into(void* h, hp_result* out, const hp_result_buffers* bufs);
+    // Batch analysis (heartpy::analyzeSignal) of n float samples into the same flat layout;
+    // opt may be null. Returns 1 on success, -1 on bad arguments.
+    int   hp_analyze_into(const float* x, size_t n, double fs, const heartpy::Options* opt,
+                          hp_result* out, const hp_result_buffers* bufs);
+    // Incremental poll into caller arrays; return values as hp_rt_poll_into. A short beat, RR
+    // or mask buffer leaves the caller's mirror incomplete, so the next delta is a reset unless
+    // the same delta is copied again in full with hp_rt_last_delta_into.
+    int   hp_rt_poll_delta(void* h, hp_poll_delta* out, const hp_delta_buffers* bufs);
+    // Copies the last hp_rt_poll_delta result again, e.g. into buffers grown to its counts.
+    // Returns 1, 0 when nothing was polled yet, -1 as above.
+    int   hp_rt_last_delta_into(void* h, hp_poll_delta* out, const hp_delta_buffers* bufs);
+    // Makes the next delta a reset (e.g. after the consumer lost its mirror)
+    void  hp_rt_reset_poll_delta(void* h);
+    // Checkpoint: returns the blob size; copies it into buf only if cap is large enough
+    size_t hp_rt_checkpoint(void* h, uint8_t* buf, size_t cap);
+    // Returns nullptr for a malformed blob
+    void* hp_rt_restore(const uint8_t* data, size_t n);
+    // Beat events (replaced: 1 when the beat supersedes the previous provisional one)
+    typedef void (*hp_rt_beat_cb)(void* user, uint64_t absIndex, double timestamp, float amplitude, double rrMs, int replaced);
+    void  hp_rt_set_beat_callback(void* h, hp_rt_beat_cb cb, void* user);
+    // Capture log of everything the analysis consumes (bufferBytes 0 = 1 MiB); 1 on success
+    int   hp_rt_capture_start(void* h, const char* path, size_t bufferBytes);
+    // 1 when every block reached the file, 0 after a write error (CaptureStats::blocksFailed)
+    int   hp_rt_capture_stop(void* h);
     void  hp_rt_destroy(void* h);
 }
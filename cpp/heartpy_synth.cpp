@@ -0,0 +1,190 @@
+#include "heartpy_synth.h"
+#include <algorithm>
+#include <cmath>
+
+namespace heartpy {
+
+static constexpr size_t kTableN = 1024;
+static constexpr double kTwoPi = 6.283185307179586476925286766559;
+
+// Circular Gaussian bump on the beat phase
+static inline double bump(double p, double c, double w, double a) {
+    double d = std::fabs(p - c);
+    d = std::min(d, 1.0 - d);
+    return a * std::exp(-0.5 * (d / w) * (d / w));
+}
+
+static inline std::uint64_t splitmix64(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Fixed table of unit normal draws (Box-Muller), built once and shared; gauss() then costs one
+// RNG draw
+static const std::vector<float>& normalTable() {
+    static const std::vector<float> table = []{
+        std::vector<float> t(1u << 14);
+        std::uint64_t s = 0x2545F4914F6CDD1DULL;
+        auto u = [&]{ s = splitmix64(s); return (double(s >> 11) + 0.5) * (1.0 / 9007199254740992.0); };
+        for (size_t k = 0; k < t.size(); k += 2) {
+            const double r = std::sqrt(-2.0 * std::log(u())), a = kTwoPi * u();
+            t[k] = float(r * std::cos(a)); t[k + 1] = float(r * std::sin(a));
+        }
+        return t;
+    }();
+    return table;
+}
+
+SignalGenerator::SignalGenerator(const SynthConfig& cfg) : cfg_(cfg) {
+    if (!(cfg_.fs > 0.0)) cfg_.fs = 50.0;
+    cfg_.bpm = std::clamp(cfg_.bpm, 20.0, 240.0);
+    held_ = cfg_.offset;
+    normal_ = normalTable().data();
+    rng_ = splitmix64(cfg_.seed);
+    if (rng_ == 0) rng_ = 0x9E3779B97F4A7C15ULL;
+
+    // One beat of pulse shape; the extra entry makes interpolation wrap-free
+    table_.resize(kTableN + 1);
+    double mean = 0.0;
+    for (size_t k = 0; k < kTableN; ++k) {
+        const double p = double(k) / kTableN;
+        double v;
+        if (cfg_.waveform == SynthConfig::Waveform::ECG) {
+            v = bump(p, 0.12, 0.025, 0.12) + bump(p, 0.23, 0.008, -0.10) + bump(p, 0.25, 0.010, 1.0)
+              + bump(p, 0.27, 0.010, -0.20) + bump(p, 0.50, 0.050, 0.30);
+        } else {
+            v = bump(p, 0.20, 0.07, 1.0) + bump(p, 0.50, 0.08, cfg_.dicroticRatio);
+            mean += v;
+        }
+        table_[k] = static_cast<float>(v);
+    }
+    if (cfg_.waveform == SynthConfig::Waveform::PPG) {
+        mean /= kTableN;
+        for (size_t k = 0; k < kTableN; ++k) table_[k] -= static_cast<float>(mean);
+    }
+    table_[kTableN] = table_[0];
+    peakPhase_ = double(std::max_element(table_.begin(), table_.end() - 1) - table_.begin()) / kTableN;
+
+    const double dt = 1.0 / cfg_.fs;
+    respRc_ = std::cos(kTwoPi * cfg_.respHz * dt); respRs_ = std::sin(kTwoPi * cfg_.respHz * dt);
+    baseRc_ = std::cos(kTwoPi * cfg_.baselineHz * dt); baseRs_ = std::sin(kTwoPi * cfg_.baselineHz * dt);
+    // Random starting phases so different seeds are not time-aligned
+    const double r0 = kTwoPi * uniform(), b0 = kTwoPi * uniform();
+    respC_ = std::cos(r0); respS_ = std::sin(r0);
+    baseC_ = std::cos(b0); baseS_ = std::sin(b0);
+    rr_ = drawRR();
+    phase_ = uniform();
+}
+
+double SignalGenerator::uniform() {
+    // xorshift64*
+    rng_ ^= rng_ >> 12; rng_ ^= rng_ << 25; rng_ ^= rng_ >> 27;
+    return double((rng_ * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double SignalGenerator::gauss() {
+    rng_ ^= rng_ >> 12; rng_ ^= rng_ << 25; rng_ ^= rng_ >> 27;
+    return normal_[(rng_ * 2685821657736338717ULL) >> 50];
+}
+
+double SignalGenerator::drawRR() {
+    double rr = 60.0 / cfg_.bpm
+              + 1e-3 * (cfg_.hrvLfMs * std::sin(kTwoPi * 0.1 * tNow_) + cfg_.rsaMs * respS_ + cfg_.rrJitterMs * gauss());
+    if (pendingPause_ > 0.0) { rr += pendingPause_; pendingPause_ = 0.0; }
+    else if (cfg_.ectopicProb > 0.0 && uniform() < cfg_.ectopicProb) { pendingPause_ = 0.4 * rr; rr *= 0.6; }
+    return std::clamp(rr, 0.25, 3.0);
+}
+
+double SignalGenerator::step(double& value) {
+    const double dtN = 1.0 / cfg_.fs;
+    double t = double(i_++) * dtN;
+    if (cfg_.jitterMs > 0.0) t += std::clamp(1e-3 * cfg_.jitterMs * gauss(), -0.45 * dtN, 0.45 * dtN);
+    double remaining = i_ == 1 ? 0.0 : t - tPrev_;
+    tPrev_ = t;
+
+    // Pulse phase over the (jittered) interval, crossing beat boundaries and recording peaks
+    double tc = t - remaining, ph = phase_;
+    for (;;) {
+        if (ph < peakPhase_ && (peakPhase_ - ph) * rr_ <= remaining) beats_.push_back(tc + (peakPhase_ - ph) * rr_);
+        const double toEnd = (1.0 - ph) * rr_;
+        if (toEnd > remaining) { ph += remaining / rr_; break; }
+        tc += toEnd; remaining -= toEnd; ph = 0.0;
+        tNow_ = tc;
+        rr_ = drawRR();
+    }
+    phase_ = ph;
+    tNow_ = t;
+
+    const double fi = ph * kTableN;
+    const size_t k = std::min(kTableN - 1, size_t(fi));
+    const double pulse = table_[k] + (fi - double(k)) * (table_[k + 1] - table_[k]);
+    const double a = cfg_.amplitude;
+    double v = a * (1.0 + cfg_.respAm * respS_) * pulse + cfg_.baselineAmp * a * baseS_;
+    if (cfg_.noise > 0.0) v += cfg_.noise * a * gauss();
+
+    if (cfg_.motionPerMin > 0.0) {
+        if (motionLeft_ <= 0.0 && uniform() < cfg_.motionPerMin / 60.0 * dtN) {
+            motionLen_ = motionLeft_ = std::max(1.0, cfg_.motionSec * cfg_.fs);
+            // ~1.5 Hz low-passed noise sits inside the cardiac band
+            motionA_ = 1.0 - std::exp(-kTwoPi * 1.5 * dtN);
+        }
+        if (motionLeft_ > 0.0) {
+            motionLp_ += motionA_ * (gauss() - motionLp_);
+            const double env = std::sin(M_PI * (1.0 - motionLeft_ / motionLen_));
+            v += cfg_.motionAmp * a * env * motionLp_ * std::sqrt((2.0 - motionA_) / motionA_);
+            motionLeft_ -= 1.0;
+        }
+    }
+    if (cfg_.clipLevel > 0.0) v = std::clamp(v, -cfg_.clipLevel * a, cfg_.clipLevel * a);
+    value = cfg_.offset + v;
+
+    // Rotate the slow oscillators; renormalize now and then against rounding drift
+    double c = respC_ * respRc_ - respS_ * respRs_, s = respS_ * respRc_ + respC_ * respRs_;
+    respC_ = c; respS_ = s;
+    c = baseC_ * baseRc_ - baseS_ * baseRs_; s = baseS_ * baseRc_ + baseC_ * baseRs_;
+    baseC_ = c; baseS_ = s;
+    if ((i_ & 4095u) == 0) {
+        double g = 1.0 / std::sqrt(respC_ * respC_ + respS_ * respS_);
+        respC_ *= g; respS_ *= g;
+        g = 1.0 / std::sqrt(baseC_ * baseC_ + baseS_ * baseS_);
+        baseC_ *= g; baseS_ *= g;
+    }
+    return t;
+}
+
+void SignalGenerator::next(float* x, double* t, size_t n) {
+    const double pDrop = cfg_.dropoutPerMin / 60.0 / cfg_.fs;
+    size_t k = 0;
+    while (k < n) {
+        double v;
+        if (pDrop > 0.0 && dropoutLeft_ <= 0.0 && uniform() < pDrop) dropoutLeft_ = std::max(1.0, cfg_.dropoutSec * cfg_.fs);
+        if (dropoutLeft_ > 0.0) {
+            dropoutLeft_ -= 1.0;
+            step(v);
+            if (t) continue;             // timed: the sample never arrives
+            x[k++] = static_cast<float>(held_);
+            continue;
+        }
+        const double ts = step(v);
+        held_ = v;
+        x[k] = static_cast<float>(v);
+        if (t) t[k] = ts;
+        ++k;
+    }
+}
+
+SynthSignal generateSignal(const SynthConfig& cfg, double seconds) {
+    SynthSignal out;
+    SignalGenerator gen(cfg);
+    const size_t n = static_cast<size_t>(std::max(0.0, seconds) * (cfg.fs > 0.0 ? cfg.fs : 50.0));
+    const bool timed = cfg.jitterMs > 0.0 || cfg.dropoutPerMin > 0.0;
+    out.samples.resize(n);
+    if (timed) out.timestamps.resize(n);
+    gen.next(out.samples.data(), timed ? out.timestamps.data() : nullptr, n);
+    out.beatTimes = gen.beatTimes();
+    return out;
+}
+
+} // namespace heartpy
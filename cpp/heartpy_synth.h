@@ -0,0 +1,96 @@
+// Deterministic synthetic PPG/ECG generator for tests and benchmarks
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace heartpy {
+
+struct SynthConfig {
+    enum class Waveform { PPG, ECG };
+    Waveform waveform = Waveform::PPG;
+    double fs = 50.0;
+    std::uint64_t seed = 1;           // same seed + config = same samples, timestamps and beats
+
+    // Rhythm: RR = 60/bpm + Mayer-wave (0.1 Hz) + respiratory sinus arrhythmia + white jitter
+    double bpm = 72.0;
+    double hrvLfMs = 25.0;            // amplitude of the 0.1 Hz RR modulation, ms
+    double rsaMs = 30.0;              // amplitude of the respiration-locked RR modulation, ms
+    double rrJitterMs = 10.0;         // beat-to-beat RR noise (SD), ms
+    double ectopicProb = 0.0;         // per beat: premature beat (60% RR) plus compensatory pause
+
+    // Morphology and respiration
+    double amplitude = 1.0;
+    double offset = 512.0;
+    double dicroticRatio = 0.3;       // PPG dicrotic wave relative to the systolic peak
+    double respHz = 0.25;
+    double respAm = 0.1;              // fractional pulse amplitude modulation by respiration
+    double baselineAmp = 0.3;         // baseline wander (x amplitude)
+    double baselineHz = 0.05;
+    double noise = 0.02;              // white noise SD (x amplitude)
+
+    // Artifacts (rates are mean events per minute; 0 disables)
+    double motionPerMin = 0.0;        // in-band motion bursts
+    double motionSec = 2.0;
+    double motionAmp = 3.0;           // x amplitude
+    double clipLevel = 0.0;           // > 0: saturate at offset ± clipLevel * amplitude
+    double dropoutPerMin = 0.0;       // sensor dropouts: timestamp gaps, or held samples when untimed
+    double dropoutSec = 0.5;
+
+    // Timebase
+    double jitterMs = 0.0;            // per-sample timestamp jitter (SD, ms); the pulse follows the jittered times
+};
+
+// Streaming generator: produces arbitrarily long signals in bounded memory. The pulse shape comes
+// from a precomputed per-beat table and the slow oscillators are rotated phasors, so the per-sample
+// cost is a table lookup plus a few multiply-adds.
+class SignalGenerator {
+public:
+    explicit SignalGenerator(const SynthConfig& cfg);
+
+    // Writes n samples and, if t is non-null, their timestamps (seconds). With timestamps, dropouts
+    // appear as gaps in t; without, as samples held at the last value.
+    void next(float* x, double* t, size_t n);
+    // Ground-truth beat times (systolic peak / R wave, seconds) generated so far
+    const std::vector<double>& beatTimes() const { return beats_; }
+    void clearBeatTimes() { beats_.clear(); }
+    double time() const { return tNow_; }
+
+private:
+    double uniform();
+    double gauss();
+    double drawRR();
+    // Advances every oscillator by one nominal sample; returns the jittered sample time
+    double step(double& value);
+
+    SynthConfig cfg_ {};
+    std::uint64_t rng_ {0};
+    const float* normal_ {nullptr};   // shared table of unit normal draws (2^14 entries)
+    std::vector<float> table_;        // one beat, phase 0..1
+    double peakPhase_ {0.0};
+    // Pulse
+    double phase_ {0.0}, rr_ {1.0}, pendingPause_ {0.0};
+    // Slow oscillators as unit phasors (cos, sin), rotated once per nominal sample
+    double respC_ {1.0}, respS_ {0.0}, respRc_ {1.0}, respRs_ {0.0};
+    double baseC_ {1.0}, baseS_ {0.0}, baseRc_ {1.0}, baseRs_ {0.0};
+    // Artifacts
+    double motionLeft_ {0.0}, motionLen_ {0.0}, motionLp_ {0.0}, motionA_ {0.0};
+    double dropoutLeft_ {0.0};
+    double held_ {0.0};
+    // Timebase
+    std::uint64_t i_ {0};
+    double tNow_ {0.0}, tPrev_ {0.0};
+    std::vector<double> beats_;
+};
+
+// One-shot convenience: seconds of signal with timestamps (empty unless jitterMs > 0 or
+// dropoutPerMin > 0) and the beat truth
+struct SynthSignal {
+    std::vector<float> samples;
+    std::vector<double> timestamps;
+    std::vector<double> beatTimes;
+};
+SynthSignal generateSignal(const SynthConfig& cfg, double seconds);
+
+} // namespace heartpy
@@ -0,0 +1,85 @@
+// Beat events: each accepted/replaced peak is reported from inside push(), before any poll();
+// per-beat latency and revision histograms in QualityInfo
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+static int cbCount = 0;
+static void onBeatC(void*, uint64_t, double, float, double, int) { ++cbCount; }
+
+int main() {
+    const double fs = 50.0;
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+    auto x = heartpy::generateSignal(heartpy::SynthConfig{}, 60.0).samples;
+
+    // Direct push: events arrive within the push that completes the peak
+    {
+        heartpy::RealtimeAnalyzer rt(fs);
+        rt.setWindowSeconds(20.0);
+        std::vector<heartpy::BeatEvent> ev;
+        size_t pushedBefore = 0, late = 0;
+        rt.setBeatCallback([&](const heartpy::BeatEvent& e) {
+            ev.push_back(e);
+            if (e.absIndex + 1 < pushedBefore) ++late;
+        });
+        heartpy::HeartMetrics m;
+        for (size_t i = 0; i + 10 <= x.size(); i += 10) {
+            pushedBefore = i;
+            rt.push(x.data() + i, 10);
+            rt.poll(m);
+        }
+        size_t accepted = 0;
+        std::vector<double> rr;
+        for (auto& e : ev) {
+            if (e.kind == heartpy::BeatEvent::Kind::ACCEPTED) ++accepted;
+            if (e.rrMs > 0.0 && e.timestamp > 20.0) rr.push_back(e.rrMs);
+        }
+        check(late == 0, "events within one sample of look-ahead");
+        check(accepted >= 55 && accepted <= 78, "at most one accepted event per beat");
+        std::sort(rr.begin(), rr.end());
+        check(!rr.empty() && std::fabs(rr[rr.size() / 2] - 833.3) < 40.0, "provisional RR");
+        bool mono = true;
+        for (size_t k = 1; k < ev.size(); ++k) if (ev[k].absIndex < ev[k - 1].absIndex || ev[k].timestamp < ev[k - 1].timestamp) mono = false;
+        check(mono, "event order");
+        check(std::fabs(ev.back().timestamp - ev.back().absIndex / fs) < 1.0 / fs, "event timestamp");
+
+        // Latency/revision histograms: every reported beat lands in one latency bucket, and beats
+        // that left the window are counted once by revisions
+        auto q = rt.getQuality();
+        unsigned long long lat = 0, fin = 0;
+        for (auto v : q.beatLatencyHist) lat += v;
+        for (auto v : q.beatRevisionHist) fin += v;
+        check(q.beatLatencyHist.size() == q.beatLatencyEdgesMs.size() + 1, "latency buckets");
+        check(lat >= 55 && lat <= 90, "latency samples");
+        check(q.beatRevisionHist.size() == 5 && fin >= 30 && q.beatRevisionHist[0] * 2 > fin, "revision histogram");
+    }
+
+    // Background worker: events fire on the worker thread
+    {
+        heartpy::Options o; o.backgroundWorker = true; o.ingestBackpressure = heartpy::Options::Backpressure::BLOCK;
+        heartpy::RealtimeAnalyzer rt(fs, o);
+        std::atomic<int> n{0};
+        rt.setBeatCallback([&](const heartpy::BeatEvent&) { ++n; });
+        for (size_t i = 0; i + 10 <= x.size(); i += 10) rt.push(x.data() + i, 10);
+        for (int k = 0; k < 200 && n.load() < 40; ++k) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        check(n.load() >= 40, "worker events");
+    }
+
+    // C bridge
+    {
+        void* h = hp_rt_create(fs, nullptr);
+        hp_rt_set_beat_callback(h, &onBeatC, nullptr);
+        hp_rt_push(h, x.data(), 1000, 0.0);
+        check(cbCount > 10, "C callback");
+        hp_rt_destroy(h);
+    }
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -1,31 +1,111 @@
-// Minimal poll latency test: measure average poll() call overhead
-#include <iostream>
-#include <vector>
+// Poll latency under producer load: a producer thread pushes paced blocks (real time or
+// accelerated) while the consumer polls. Reports successful-poll latency and push blocking
+// time for vector/ring storage and the torch/ambient presets.
+//
+//   bench_poll_latency [seconds=120] [--fs 50] [--block 0.1] [--speed 20]
+//                      [--use-ring 0|1] [--preset torch|ambient]
+//
+// Without --use-ring/--preset every combination is run (one line each).
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
 #include <thread>
+#include <atomic>
 #include <cmath>
+#include <algorithm>
 #include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+using Clock = std::chrono::steady_clock;
+
+static std::vector<float> make_ppg(double fs, double seconds) {
+    heartpy::SynthConfig c; c.fs = fs;
+    return heartpy::generateSignal(c, seconds).samples;
+}
+
+static double percentile(std::vector<double>& a, double p) {
+    if (a.empty()) return 0.0;
+    std::sort(a.begin(), a.end());
+    size_t k = static_cast<size_t>(std::ceil(p / 100.0 * a.size()));
+    return a[std::min(a.size() - 1, k > 0 ? k - 1 : 0)];
+}
 
-int main() {
-    const double fs = 50.0;
-    heartpy::Options opt; opt.useRingBuffer = false;
+static void run(double fs, double sec, double blockSec, double speed, bool useRing, const std::string& preset) {
+    heartpy::Options opt;
+    opt.useRingBuffer = useRing;
     heartpy::RealtimeAnalyzer rt(fs, opt);
-    rt.setWindowSeconds(30.0);
+    if (preset == "torch") rt.applyPresetTorch();
+    else rt.applyPresetAmbient();
+    rt.setWindowSeconds(60.0);
+    rt.setUpdateIntervalSeconds(1.0);
 
-    // Pre-fill a bit
-    std::vector<float> chunk(1000, 512.0f);
-    rt.push(chunk.data(), chunk.size(), 0.0);
+    const auto x = make_ppg(fs, sec);
+    const size_t blockN = std::max<size_t>(1, static_cast<size_t>(fs * blockSec));
+    const auto period = std::chrono::duration<double>(blockSec / speed);
 
-    // Poll loop
-    const int N = 500;
-    auto t0 = std::chrono::steady_clock::now();
+    std::vector<double> pushUs;
+    pushUs.reserve(x.size() / blockN + 1);
+    std::atomic<bool> done {false};
+    const auto start = Clock::now();
+    std::thread producer([&]{
+        auto next = start;
+        for (size_t i = 0; i < x.size(); i += blockN) {
+            std::this_thread::sleep_until(next);
+            next += std::chrono::duration_cast<Clock::duration>(period);
+            auto t0 = Clock::now();
+            rt.push(x.data() + i, std::min(blockN, x.size() - i));
+            pushUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+        }
+        done = true;
+    });
+
+    // Consumer polls every ~1 ms of wall time; only polls that produced an update are timed
+    std::vector<double> emitMs;
+    emitMs.reserve(static_cast<size_t>(sec) + 1);
+    size_t polls = 0;
     heartpy::HeartMetrics out;
-    for (int i = 0; i < N; ++i) {
-        (void)rt.poll(out);
+    for (;;) {
+        const bool last = done.load();
+        auto t0 = Clock::now();
+        const bool ok = rt.poll(out);
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        ++polls;
+        if (ok) emitMs.push_back(ms);
+        if (last) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
-    auto t1 = std::chrono::steady_clock::now();
-    double us = std::chrono::duration<double, std::micro>(t1 - t0).count() / N;
-    std::cout << "poll_latency_us_avg=" << us << "\n";
-    return 0;
+    producer.join();
+    const double wall = std::chrono::duration<double>(Clock::now() - start).count();
+
+    double blockedMs = 0.0;
+    for (double us : pushUs) blockedMs += us / 1000.0;
+    const size_t pushes = pushUs.size();
+    const size_t emits = emitMs.size();
+    const double p50 = percentile(emitMs, 50.0), p95 = percentile(emitMs, 95.0), p99 = percentile(emitMs, 99.0), pmax = percentile(emitMs, 100.0);
+    const double push50 = percentile(pushUs, 50.0), push99 = percentile(pushUs, 99.0), pushMax = percentile(pushUs, 100.0);
+    std::printf("bench_poll_latency: ring=%s preset=%s fs=%.1f sec=%.0f block=%.3f speed=%.1f wall_s=%.2f polls=%zu emits=%zu "
+                "emit_p50_ms=%.3f emit_p95_ms=%.3f emit_p99_ms=%.3f emit_max_ms=%.3f "
+                "pushes=%zu push_p50_us=%.1f push_p99_us=%.1f push_max_us=%.1f push_blocked_ms=%.2f last_bpm=%.1f\n",
+                useRing ? "ON" : "OFF", preset.c_str(), fs, sec, blockSec, speed, wall, polls, emits,
+                p50, p95, p99, pmax, pushes, push50, push99, pushMax, blockedMs, out.bpm);
 }
 
+int main(int argc, char** argv) {
+    double fs = 50.0, sec = 120.0, blockSec = 0.1, speed = 20.0;
+    std::vector<int> rings {0, 1};
+    std::vector<std::string> presets {"torch", "ambient"};
+    if (argc >= 2 && argv[1][0] != '-') sec = std::atof(argv[1]);
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string k = argv[i], v = argv[i + 1];
+        if (k == "--fs") fs = std::atof(v.c_str());
+        else if (k == "--block") blockSec = std::atof(v.c_str());
+        else if (k == "--speed") speed = std::max(0.01, std::atof(v.c_str()));
+        else if (k == "--use-ring") rings = {(v == "1" || v == "true" || v == "on") ? 1 : 0};
+        else if (k == "--preset") presets = {v};
+    }
+    for (int ring : rings)
+        for (const auto& p : presets) run(fs, sec, blockSec, speed, ring != 0, p);
+    return 0;
+}
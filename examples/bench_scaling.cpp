@@ -0,0 +1,218 @@
+// Multi-session scalability benchmark: N analyzers spread over T threads, each thread pushing and
+// polling its own sessions as fast as possible. Prints one JSON document with a scaling curve.
+//
+//   bench_scaling [--fs 30,50,100] [--threads 1,2,4] [--sessions-per-thread 1,8,32]
+//                 [--seconds 30] [--chunk-ms 100] [--window 20] [--preset torch|ambient] [--replay file]
+//
+// Sessions never share an analyzer, so their mutexes are uncontended: a per-thread efficiency
+// below 1 as T grows points at shared process state (allocator, caches, memory bandwidth).
+// allocsPerUpdate shows how much of that pressure goes through the allocator. rssPerSessionBytes
+// is the resident-set growth over the process baseline divided by N (Linux only; configurations
+// run in ascending N within each rate so the allocator cannot hide growth behind freed memory).
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+static std::atomic<unsigned long long> g_allocs {0};
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return ::operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+static size_t rss_bytes() {
+#ifdef __linux__
+    std::ifstream f("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(f >> pages >> resident)) return 0;
+    return resident * size_t(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+static std::vector<double> parse_list(const char* s) {
+    std::vector<double> v;
+    std::string tok;
+    std::istringstream is(s);
+    while (std::getline(is, tok, ',')) if (!tok.empty()) v.push_back(std::atof(tok.c_str()));
+    return v;
+}
+
+// Per-session variation (rate, seed) so sessions do not run in lockstep
+static std::vector<float> make_ppg(double fs, double seconds, unsigned seed) {
+    heartpy::SynthConfig c;
+    c.fs = fs; c.seed = seed + 1; c.bpm = 60.0 + (seed % 41);
+    return heartpy::generateSignal(c, seconds).samples;
+}
+
+static std::vector<float> load_text(const std::string& path) {
+    std::ifstream f(path);
+    std::vector<float> v;
+    double x;
+    while (f >> x) v.push_back(static_cast<float>(x));
+    return v;
+}
+
+static double pct(std::vector<double>& v, double q) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t k = static_cast<size_t>(std::ceil(q * v.size()));
+    return v[std::min(v.size() - 1, k > 0 ? k - 1 : 0)];
+}
+
+struct Point {
+    double fs = 0.0;
+    int threads = 0, sessions = 0;
+    double samplesPerSec = 0.0, efficiency = 0.0;
+    double p50 = 0.0, p99 = 0.0, max = 0.0;
+    double allocsPerUpdate = 0.0;
+    size_t bytesUsedPerSession = 0, rssPerSession = 0;
+    unsigned long long updates = 0;
+};
+
+int main(int argc, char** argv) {
+    std::vector<double> rates {30.0, 50.0, 100.0}, threadList, sptList {1, 8, 32};
+    double seconds = 30.0, chunkMs = 100.0, window = 20.0;
+    std::string preset, replay;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--fs" && i + 1 < argc) rates = parse_list(argv[++i]);
+        else if (a == "--threads" && i + 1 < argc) threadList = parse_list(argv[++i]);
+        else if (a == "--sessions-per-thread" && i + 1 < argc) sptList = parse_list(argv[++i]);
+        else if (a == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (a == "--chunk-ms" && i + 1 < argc) chunkMs = std::atof(argv[++i]);
+        else if (a == "--window" && i + 1 < argc) window = std::atof(argv[++i]);
+        else if (a == "--preset" && i + 1 < argc) preset = argv[++i];
+        else if (a == "--replay" && i + 1 < argc) replay = argv[++i];
+        else { std::cerr << "unknown argument: " << a << "\n"; return 2; }
+    }
+    const int hw = std::max(1u, std::thread::hardware_concurrency());
+    if (threadList.empty()) for (int t = 1; t <= hw; t *= 2) threadList.push_back(t);
+    std::vector<float> replayed;
+    if (!replay.empty()) {
+        replayed = load_text(replay);
+        if (replayed.empty()) { std::cerr << "No data" << std::endl; return 1; }
+    }
+
+    const size_t rssBase = rss_bytes();
+    std::vector<Point> points;
+    for (double fs : rates) {
+        // Ascending session count keeps the RSS deltas meaningful (see header)
+        std::vector<std::pair<int, int>> configs;
+        for (double t : threadList) for (double s : sptList) configs.push_back({int(t), int(s)});
+        std::stable_sort(configs.begin(), configs.end(), [](auto& a, auto& b){ return a.first * a.second < b.first * b.second; });
+        std::vector<double> perThreadBase(sptList.size() + 1, 0.0);
+        for (auto [T, spt] : configs) {
+            const int N = T * spt;
+            const size_t chunk = std::max<size_t>(1, size_t(fs * chunkMs / 1000.0));
+            std::vector<std::vector<float>> data(std::min(N, 64));
+            for (size_t k = 0; k < data.size(); ++k) data[k] = replayed.empty() ? make_ppg(fs, seconds, unsigned(k)) : replayed;
+            std::vector<std::unique_ptr<heartpy::RealtimeAnalyzer>> rts;
+            for (int k = 0; k < N; ++k) {
+                rts.emplace_back(new heartpy::RealtimeAnalyzer(fs));
+                if (preset == "torch") rts.back()->applyPresetTorch();
+                else if (preset == "ambient") rts.back()->applyPresetAmbient();
+                rts.back()->setWindowSeconds(window);
+            }
+            std::vector<std::vector<double>> lat(T);
+            std::vector<unsigned long long> upd(T, 0), samples(T, 0);
+            std::atomic<int> ready {0};
+            std::atomic<bool> go {false};
+            const unsigned long long a0 = g_allocs.load();
+            std::vector<std::thread> th;
+            for (int t = 0; t < T; ++t) {
+                th.emplace_back([&, t]{
+                    // Thread-local counters and latencies: shared counters would false-share
+                    std::vector<double> local;
+                    local.reserve(size_t(spt * (seconds + 1)));
+                    unsigned long long nSamples = 0, nUpdates = 0;
+                    heartpy::HeartMetrics m;
+                    ready.fetch_add(1);
+                    while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                    // Round-robin over this thread's sessions, one chunk each, like a device hub
+                    const size_t len = data[0].size();
+                    for (size_t i = 0; i < len; i += chunk) {
+                        for (int s = 0; s < spt; ++s) {
+                            const int k = t * spt + s;
+                            const auto& x = data[k % data.size()];
+                            const size_t n = std::min(chunk, x.size() > i ? x.size() - i : 0);
+                            if (n == 0) continue;
+                            rts[k]->push(x.data() + i, n);
+                            nSamples += n;
+                            auto p0 = std::chrono::steady_clock::now();
+                            if (rts[k]->poll(m)) {
+                                local.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - p0).count());
+                                ++nUpdates;
+                            }
+                        }
+                    }
+                    lat[t] = std::move(local);
+                    samples[t] = nSamples;
+                    upd[t] = nUpdates;
+                });
+            }
+            while (ready.load() < T) std::this_thread::yield();
+            const auto t0 = std::chrono::steady_clock::now();
+            go.store(true, std::memory_order_release);
+            for (auto& x : th) x.join();
+            const auto t1 = std::chrono::steady_clock::now();
+            const unsigned long long allocs = g_allocs.load() - a0;
+
+            Point p;
+            p.fs = fs; p.threads = T; p.sessions = N;
+            unsigned long long total = 0;
+            std::vector<double> all;
+            for (int t = 0; t < T; ++t) { total += samples[t]; p.updates += upd[t]; all.insert(all.end(), lat[t].begin(), lat[t].end()); }
+            const double sec = std::chrono::duration<double>(t1 - t0).count();
+            p.samplesPerSec = sec > 0.0 ? total / sec : 0.0;
+            const size_t si = size_t(std::find(sptList.begin(), sptList.end(), double(spt)) - sptList.begin());
+            if (T == 1) perThreadBase[si] = p.samplesPerSec;
+            p.efficiency = perThreadBase[si] > 0.0 ? p.samplesPerSec / (T * perThreadBase[si]) : 0.0;
+            p.p50 = pct(all, 0.50); p.p99 = pct(all, 0.99); p.max = pct(all, 1.0);
+            p.allocsPerUpdate = p.updates ? double(allocs) / p.updates : 0.0;
+            size_t used = 0;
+            for (auto& r : rts) used += r->bytesUsed();
+            p.bytesUsedPerSession = used / N;
+            const size_t rss = rss_bytes();
+            p.rssPerSession = rss > rssBase ? (rss - rssBase) / N : 0;
+            points.push_back(p);
+        }
+    }
+
+    std::ostringstream os;
+    os << "{\"hardwareThreads\":" << hw << ",\"seconds\":" << seconds << ",\"chunkMs\":" << chunkMs
+       << ",\"window\":" << window << ",\"points\":[";
+    for (size_t k = 0; k < points.size(); ++k) {
+        const Point& p = points[k];
+        os << (k ? ",\n" : "\n") << "{\"fs\":" << p.fs << ",\"threads\":" << p.threads << ",\"sessions\":" << p.sessions
+           << ",\"samplesPerSec\":" << p.samplesPerSec << ",\"realtimeSessions\":" << p.samplesPerSec / p.fs
+           << ",\"efficiency\":" << p.efficiency << ",\"updates\":" << p.updates
+           << ",\"updateUs\":{\"p50\":" << p.p50 << ",\"p99\":" << p.p99 << ",\"max\":" << p.max << "}"
+           << ",\"allocsPerUpdate\":" << p.allocsPerUpdate
+           << ",\"bytesUsedPerSession\":" << p.bytesUsedPerSession << ",\"rssPerSessionBytes\":" << p.rssPerSession << "}";
+    }
+    os << "\n]}";
+    std::cout << os.str() << std::endl;
+    return 0;
+}
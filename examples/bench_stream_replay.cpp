@@ -0,0 +1,196 @@
+// Stream replay benchmark: feed a recording through push()/poll() as fast as possible and report
+// throughput, poll latency percentiles, allocations per poll and (optionally) the metric series.
+//
+//   bench_stream_replay [file] [--fs 50] [--format text|f32|f64] [--timestamps] [--chunk 10]
+//                       [--update 1.0] [--window 60] [--preset torch|ambient] [--repeat 1]
+//                       [--series out.jsonl]
+//
+// text: one sample per line, or "t value" per line (timestamps are picked up automatically);
+// '#' lines and unparsable headers are skipped. f32/f64: raw native-endian samples, or
+// interleaved (t, value) pairs with --timestamps. Without a file a 72 bpm synthetic PPG (heartpy_synth) is used.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+// Global allocation counter (every operator new in the process, library included)
+static std::atomic<unsigned long long> g_allocs {0};
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return ::operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+struct Recording {
+    std::vector<float> x;
+    std::vector<double> t;   // empty = nominal fs timebase
+};
+
+static bool load_text(const std::string& path, Recording& rec) {
+    std::ifstream f(path);
+    if (!f.good()) return false;
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream is(line);
+        double a, b;
+        if (!(is >> a)) continue;
+        if (is >> b) { rec.t.push_back(a); rec.x.push_back(static_cast<float>(b)); }
+        else rec.x.push_back(static_cast<float>(a));
+    }
+    // Mixed one/two-column files are treated as untimed
+    if (!rec.t.empty() && rec.t.size() != rec.x.size()) rec.t.clear();
+    return !rec.x.empty();
+}
+
+template <typename T>
+static bool load_binary(const std::string& path, bool timestamps, Recording& rec) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.good()) return false;
+    std::vector<T> v;
+    T buf[4096];
+    while (f.read(reinterpret_cast<char*>(buf), sizeof(buf)) || f.gcount() > 0) {
+        v.insert(v.end(), buf, buf + f.gcount() / sizeof(T));
+        if (!f) break;
+    }
+    if (timestamps) {
+        for (size_t i = 0; i + 1 < v.size(); i += 2) { rec.t.push_back(double(v[i])); rec.x.push_back(float(v[i + 1])); }
+    } else {
+        for (T s : v) rec.x.push_back(float(s));
+    }
+    return !rec.x.empty();
+}
+
+static Recording make_ppg(double fs, double seconds) {
+    heartpy::SynthConfig c; c.fs = fs;
+    Recording rec;
+    rec.x = heartpy::generateSignal(c, seconds).samples;
+    return rec;
+}
+
+static double pct(std::vector<double>& v, double q) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t k = static_cast<size_t>(std::ceil(q * v.size()));
+    return v[std::min(v.size() - 1, k > 0 ? k - 1 : 0)];
+}
+
+int main(int argc, char** argv) {
+    std::string path, format = "text", preset, seriesPath;
+    double fs = 50.0, update = 1.0, window = 60.0;
+    size_t chunk = 10;
+    int repeat = 1;
+    bool timestamps = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--fs" && i + 1 < argc) fs = std::atof(argv[++i]);
+        else if (a == "--format" && i + 1 < argc) format = argv[++i];
+        else if (a == "--timestamps") timestamps = true;
+        else if (a == "--chunk" && i + 1 < argc) chunk = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--update" && i + 1 < argc) update = std::atof(argv[++i]);
+        else if (a == "--window" && i + 1 < argc) window = std::atof(argv[++i]);
+        else if (a == "--preset" && i + 1 < argc) preset = argv[++i];
+        else if (a == "--repeat" && i + 1 < argc) repeat = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--series" && i + 1 < argc) seriesPath = argv[++i];
+        else if (!a.empty() && a[0] != '-') path = a;
+        else { std::cerr << "unknown argument: " << a << "\n"; return 2; }
+    }
+
+    Recording rec;
+    bool ok = true;
+    if (path.empty()) rec = make_ppg(fs, 300.0);
+    else if (format == "text") ok = load_text(path, rec);
+    else if (format == "f32") ok = load_binary<float>(path, timestamps, rec);
+    else if (format == "f64") ok = load_binary<double>(path, timestamps, rec);
+    else { std::cerr << "unknown format: " << format << "\n"; return 2; }
+    if (!ok) { std::cerr << "No data" << std::endl; return 1; }
+    const bool timed = !rec.t.empty();
+
+    std::ofstream series;
+    if (!seriesPath.empty()) series.open(seriesPath);
+
+    using clock = std::chrono::steady_clock;
+    std::vector<double> pollUs, updateUs, allocsPerPoll;
+    pollUs.reserve(rec.x.size() / chunk * repeat + 1);
+    updateUs.reserve(pollUs.capacity());
+    allocsPerPoll.reserve(pollUs.capacity());
+    double pushSec = 0.0, pollSec = 0.0;
+    unsigned long long pushAllocs = 0, updates = 0, updateAllocs = 0;
+    heartpy::HeartMetrics m;
+    for (int r = 0; r < repeat; ++r) {
+        heartpy::RealtimeAnalyzer rt(fs);
+        if (preset == "torch") rt.applyPresetTorch();
+        else if (preset == "ambient") rt.applyPresetAmbient();
+        rt.setWindowSeconds(window);
+        rt.setUpdateIntervalSeconds(update);
+        for (size_t i = 0; i < rec.x.size(); i += chunk) {
+            const size_t n = std::min(chunk, rec.x.size() - i);
+            unsigned long long a0 = g_allocs.load(std::memory_order_relaxed);
+            auto t0 = clock::now();
+            if (timed) rt.push(rec.x.data() + i, rec.t.data() + i, n);
+            else rt.push(rec.x.data() + i, n);
+            auto t1 = clock::now();
+            unsigned long long a1 = g_allocs.load(std::memory_order_relaxed);
+            const bool got = rt.poll(m);
+            auto t2 = clock::now();
+            unsigned long long a2 = g_allocs.load(std::memory_order_relaxed);
+            pushSec += std::chrono::duration<double>(t1 - t0).count();
+            pollSec += std::chrono::duration<double>(t2 - t1).count();
+            pushAllocs += a1 - a0;
+            const double us = std::chrono::duration<double, std::micro>(t2 - t1).count();
+            pollUs.push_back(us);
+            allocsPerPoll.push_back(double(a2 - a1));
+            if (!got) continue;
+            ++updates;
+            updateAllocs += a2 - a1;
+            updateUs.push_back(us);
+            if (series.is_open() && r == 0) {
+                const double ts = timed ? rec.t[i + n - 1] : (i + n) / fs;
+                series << "{\"t\":" << ts << ",\"bpm\":" << m.bpm << ",\"sdnn\":" << m.sdnn
+                       << ",\"rmssd\":" << m.rmssd << ",\"breathingRate\":" << m.breathingRate
+                       << ",\"snrDb\":" << m.quality.snrDb << ",\"confidence\":" << m.quality.confidence
+                       << ",\"goodQuality\":" << (m.quality.goodQuality ? "true" : "false")
+                       << ",\"pollUs\":" << us << "}\n";
+            }
+        }
+    }
+
+    const double total = double(rec.x.size()) * repeat;
+    double allocSum = 0.0, allocMax = 0.0;
+    for (size_t k = 0; k < allocsPerPoll.size(); ++k) { allocSum += allocsPerPoll[k]; allocMax = std::max(allocMax, allocsPerPoll[k]); }
+    const size_t polls = pollUs.size();
+    std::vector<double> upd = updateUs;
+    std::ostringstream os;
+    os << "{\"samples\":" << rec.x.size() << ",\"timestamps\":" << (timed ? "true" : "false")
+       << ",\"chunk\":" << chunk << ",\"repeat\":" << repeat
+       << ",\"samplesPerSec\":" << (pushSec + pollSec > 0.0 ? total / (pushSec + pollSec) : 0.0)
+       << ",\"realtimeFactor\":" << (pushSec + pollSec > 0.0 ? total / fs / (pushSec + pollSec) : 0.0)
+       << ",\"pushSec\":" << pushSec << ",\"pollSec\":" << pollSec
+       << ",\"polls\":" << polls << ",\"updates\":" << updates
+       << ",\"pollUs\":{\"p50\":" << pct(pollUs, 0.50) << ",\"p90\":" << pct(pollUs, 0.90)
+       << ",\"p99\":" << pct(pollUs, 0.99) << ",\"max\":" << pct(pollUs, 1.0) << "}"
+       << ",\"updateUs\":{\"p50\":" << pct(upd, 0.50) << ",\"p90\":" << pct(upd, 0.90)
+       << ",\"p99\":" << pct(upd, 0.99) << ",\"max\":" << pct(upd, 1.0) << "}"
+       << ",\"allocsPerPoll\":{\"mean\":" << (polls ? allocSum / polls : 0.0) << ",\"max\":" << allocMax << "}"
+       << ",\"allocsPerUpdate\":" << (updates ? double(updateAllocs) / updates : 0.0)
+       << ",\"allocsPerPush\":" << (polls ? double(pushAllocs) / polls : 0.0)
+       << ",\"lastBpm\":" << m.bpm << "}";
+    std::cout << os.str() << std::endl;
+    return 0;
+}
@@ -0,0 +1,77 @@
+// Checkpoint/restore: a restored analyzer continues with output identical to the original
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <string>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+static void feed(heartpy::RealtimeAnalyzer& rt, const std::vector<float>& x, size_t from, size_t to, bool ts, std::string* log) {
+    const double fs = 50.0;
+    heartpy::HeartMetrics m;
+    for (size_t i = from; i + 10 <= to; i += 10) {
+        if (ts) {
+            double t[10];
+            for (size_t k = 0; k < 10; ++k) t[k] = (i + k) / fs;
+            rt.push(x.data() + i, t, 10);
+        } else {
+            rt.push(x.data() + i, 10);
+        }
+        if (rt.poll(m) && log) {
+            *log += std::to_string(m.bpm) + " " + std::to_string(m.sdnn) + " " + std::to_string(m.quality.snrDb) + " "
+                  + std::to_string(m.quality.confidence) + " " + std::to_string(m.quality.maPercActive) + "|";
+            for (int p : m.peakList) *log += std::to_string(p) + ",";
+            *log += "\n";
+        }
+    }
+}
+
+int main() {
+    const double fs = 50.0;
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+    auto x = heartpy::generateSignal(heartpy::SynthConfig{}, 90.0).samples;
+    const size_t cut = 40 * 50;
+
+    struct Case { const char* name; heartpy::Options opt; bool ts; };
+    std::vector<Case> cases(5);
+    cases[0].name = "ring";
+    cases[1].name = "vector"; cases[1].opt.useRingBuffer = false;
+    cases[2].name = "int16"; cases[2].opt.storageMode = heartpy::Options::StorageMode::INT16;
+    cases[3].name = "timestamps"; cases[3].ts = true;
+    cases[4].name = "queue+preprocess"; cases[4].opt.useIngestQueue = true; cases[4].opt.hampelCorrect = true; cases[4].opt.removeBaselineWander = true;
+    for (auto& c : cases) {
+        heartpy::RealtimeAnalyzer a(fs, c.opt);
+        a.setWindowSeconds(20.0);
+        feed(a, x, 0, cut, c.ts, nullptr);
+        std::vector<uint8_t> blob = a.checkpoint();
+        auto b = heartpy::RealtimeAnalyzer::restore(blob.data(), blob.size());
+        check(b != nullptr, c.name);
+        if (!b) continue;
+        check(b->checkpoint() == blob, (std::string(c.name) + ": re-checkpoint").c_str());
+        std::string la, lb;
+        feed(a, x, cut, x.size(), c.ts, &la);
+        feed(*b, x, cut, x.size(), c.ts, &lb);
+        check(!la.empty() && la == lb, (std::string(c.name) + ": identical continuation").c_str());
+        check(a.getQuality().confidence == b->getQuality().confidence, (std::string(c.name) + ": quality").c_str());
+    }
+
+    // Malformed blobs are rejected; the C bridge round-trips
+    {
+        heartpy::RealtimeAnalyzer a(fs);
+        feed(a, x, 0, cut, false, nullptr);
+        std::vector<uint8_t> blob = a.checkpoint();
+        check(!heartpy::RealtimeAnalyzer::restore(blob.data(), blob.size() - 1), "truncated blob");
+        blob[0] ^= 0xFF;
+        check(!heartpy::RealtimeAnalyzer::restore(blob.data(), blob.size()), "bad magic");
+        void* h = hp_rt_create(fs, nullptr);
+        const size_t n = hp_rt_checkpoint(h, nullptr, 0);
+        std::vector<uint8_t> buf(n);
+        check(n > 0 && hp_rt_checkpoint(h, buf.data(), buf.size()) == n, "C checkpoint");
+        void* h2 = hp_rt_restore(buf.data(), buf.size());
+        check(h2 != nullptr, "C restore");
+        hp_rt_destroy(h); hp_rt_destroy(h2);
+    }
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
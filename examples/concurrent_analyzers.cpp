@@ -0,0 +1,65 @@
+// Independent analyzers on separate threads: results match a serial run regardless of mixed options;
+// batch analysis follows Options::deterministic only, never the process-wide default
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cmath>
+#include <string>
+#include <cstring>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+// bpm, SNR and peaks of every update; SNR exposes which spectral path (FFT or DFT) ran
+static std::string trace(int k) {
+    const double fs = 50.0;
+    heartpy::Options o; o.deterministic = (k % 2) == 0;
+    heartpy::RealtimeAnalyzer rt(fs, o);
+    rt.setWindowSeconds(20.0);
+    heartpy::SynthConfig sc; sc.fs = fs; sc.bpm = 66.0 + 3.0 * k;
+    auto x = heartpy::generateSignal(sc, 40.0).samples;
+    std::string log;
+    heartpy::HeartMetrics m;
+    for (size_t i = 0; i + 10 <= x.size(); i += 10) {
+        rt.push(x.data() + i, 10);
+        if (!rt.poll(m)) continue;
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%.17g %.17g|", m.bpm, m.quality.snrDb);
+        log += buf;
+        for (int p : m.peakList) log += std::to_string(p) + ",";
+        log += "\n";
+    }
+    return log;
+}
+
+int main() {
+    const int n = 6;
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+    std::vector<std::string> serial(n), parallel(n);
+    for (int k = 0; k < n; ++k) serial[k] = trace(k);
+    for (int round = 0; round < 3; ++round) {
+        std::vector<std::thread> th;
+        for (int k = 0; k < n; ++k) th.emplace_back([&, k]{ parallel[k] = trace(k); });
+        for (auto& t : th) t.join();
+        for (int k = 0; k < n; ++k) check(!serial[k].empty() && parallel[k] == serial[k], "parallel matches serial");
+    }
+    // setDeterministic() must not leak into analyzeSignal/analyzeRRIntervals
+    {
+        auto x = heartpy::generateSignal(heartpy::SynthConfig{}, 120.0).samples;
+        std::vector<double> sig(x.begin(), x.end());
+        heartpy::Options o;
+        auto bits = [](const heartpy::HeartMetrics& m) {
+            const double v[] = {m.lf, m.hf, m.lfhf, m.breathingRate};
+            return std::string(reinterpret_cast<const char*>(v), sizeof(v));
+        };
+        const auto ref = heartpy::analyzeSignal(sig, 50.0, o);
+        const auto refRR = heartpy::analyzeRRIntervals(ref.rrList, o);
+        heartpy::setDeterministic(true);
+        const auto m = heartpy::analyzeSignal(sig, 50.0, o);
+        const auto mRR = heartpy::analyzeRRIntervals(ref.rrList, o);
+        heartpy::setDeterministic(false);
+        check(bits(m) == bits(ref) && bits(mRR) == bits(refRR), "batch ignores the global default");
+    }
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
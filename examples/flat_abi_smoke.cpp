@@ -0,0 +1,159 @@
+// Flat C ABI: hp_rt_poll_into / hp_analyze_into match the C++ results, report lengths and
+// truncation, honour the caller's struct size, and poll without heap traffic (worker mode)
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <chrono>
+#include <thread>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+// Allocations made by this thread only (the worker allocates concurrently)
+static thread_local size_t g_allocs = 0;
+void* operator new(size_t n) {
+    ++g_allocs;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+// Bitwise, so NaN metrics of a short window compare equal too
+static bool eq(double a, double b) { return std::memcmp(&a, &b, sizeof(a)) == 0; }
+
+template <typename T, typename U>
+static bool sameArray(const std::vector<U>& v, const T* a, uint32_t count) {
+    if (count != v.size()) return false;
+    for (size_t i = 0; i < v.size(); ++i) if (a[i] != static_cast<T>(v[i])) return false;
+    return true;
+}
+
+static bool sameResult(const heartpy::HeartMetrics& m, const hp_result& r, const int32_t* pk, const int32_t* raw,
+                       const double* rr, const int32_t* mask, const char* warning) {
+    return r.version == HP_RESULT_VERSION && r.truncated == 0 && eq(r.bpm, m.bpm) && eq(r.sdnn, m.sdnn)
+        && eq(r.rmssd, m.rmssd) && eq(r.pnn50, m.pnn50) && eq(r.sd1, m.sd1) && eq(r.lfhf, m.lfhf)
+        && eq(r.breathingRate, m.breathingRate) && r.totalBeats == m.quality.totalBeats
+        && r.goodQuality == (m.quality.goodQuality ? 1 : 0) && eq(r.snrDb, m.quality.snrDb)
+        && eq(r.confidence, m.quality.confidence) && r.pollStagesRun == m.quality.pollStagesRun
+        && sameArray(m.peakList, pk, r.peakCount) && sameArray(m.peakListRaw, raw, r.peakRawCount)
+        && sameArray(m.rrList, rr, r.rrCount) && sameArray(m.binaryPeakMask, mask, r.maskCount)
+        && m.quality.qualityWarning == warning;
+}
+
+int main() {
+    const double fs = 50.0;
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+    heartpy::SynthConfig cfg; cfg.fs = fs; cfg.jitterMs = 2.0; cfg.motionPerMin = 2.0; cfg.ectopicProb = 0.03;
+    const auto sig = heartpy::generateSignal(cfg, 180.0);
+    const size_t n = sig.samples.size();
+
+    std::vector<int32_t> pk(512), raw(512), mask(512);
+    std::vector<double> rr(512);
+    char warning[256];
+    hp_result_buffers bufs{pk.data(), pk.size(), raw.data(), raw.size(), rr.data(), rr.size(),
+                           mask.data(), mask.size(), warning, sizeof(warning)};
+
+    // 1) Same session through hp_rt_poll and hp_rt_poll_into: identical values and arrays
+    {
+        void* a = hp_rt_create(fs, nullptr);
+        void* b = hp_rt_create(fs, nullptr);
+        hp_rt_set_window(a, 20.0); hp_rt_set_window(b, 20.0);
+        heartpy::HeartMetrics m;
+        int polls = 0, same = 0;
+        for (size_t i = 0; i + 10 <= n; i += 10) {
+            hp_rt_push(a, sig.samples.data() + i, 10, 0.0);
+            hp_rt_push(b, sig.samples.data() + i, 10, 0.0);
+            hp_result r{}; r.size = sizeof(r);
+            const int ga = hp_rt_poll(a, &m), gb = hp_rt_poll_into(b, &r, &bufs);
+            if (ga != gb) { same = -1; break; }
+            if (ga) { ++polls; same += sameResult(m, r, pk.data(), raw.data(), rr.data(), mask.data(), warning) ? 1 : 0; }
+        }
+        check(polls > 100 && same == polls, "poll_into == poll");
+        // A short RR buffer: the same update is copied again in full after growing it
+        hp_result r{}; r.size = sizeof(r);
+        double few[2];
+        hp_result_buffers small{}; small.rr = few; small.rrCap = 2;
+        bool retried = false;
+        for (size_t i = 0; i + 10 <= size_t(5 * fs) && !retried; i += 10) {
+            hp_rt_push(b, sig.samples.data() + i, 10, 0.0);
+            if (hp_rt_poll_into(b, &r, &small) == 1 && (r.truncated & HP_TRUNC_RR)) {
+                std::vector<double> grown(r.rrCount);
+                small.rr = grown.data(); small.rrCap = grown.size();
+                hp_result again{}; again.size = sizeof(again);
+                retried = hp_rt_last_into(b, &again, &small) == 1 && !(again.truncated & HP_TRUNC_RR)
+                       && again.rrCount == r.rrCount && eq(again.bpm, r.bpm) && eq(grown[0], few[0]) && eq(grown[1], few[1]);
+            }
+        }
+        check(retried, "last_into refills grown buffers");
+        hp_rt_destroy(a); hp_rt_destroy(b);
+    }
+
+    // 2) Batch entry point == analyzeSignal
+    {
+        std::vector<double> x(sig.samples.begin(), sig.samples.begin() + size_t(60 * fs));
+        const auto m = heartpy::analyzeSignal(x, fs);
+        hp_result r{}; r.size = sizeof(r);
+        check(hp_analyze_into(sig.samples.data(), x.size(), fs, nullptr, &r, &bufs) == 1
+              && sameResult(m, r, pk.data(), raw.data(), rr.data(), mask.data(), warning), "analyze_into == analyzeSignal");
+
+        // Small or absent buffers: full lengths, prefix copied, truncation bits set
+        int32_t few[3] = {-1, -1, -1};
+        hp_result_buffers small{few, 2, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0};
+        hp_result t{}; t.size = sizeof(t);
+        hp_analyze_into(sig.samples.data(), x.size(), fs, nullptr, &t, &small);
+        check(t.peakCount == m.peakList.size() && few[0] == m.peakList[0] && few[1] == m.peakList[1] && few[2] == -1,
+              "truncated copy keeps the full length");
+        check((t.truncated & HP_TRUNC_PEAKS) && (t.truncated & HP_TRUNC_RR) && (t.truncated & HP_TRUNC_MASK)
+              && t.rrCount == m.rrList.size(), "truncation flags");
+
+        // An older, shorter struct: nothing past its size is written
+        unsigned char blob[sizeof(hp_result) + 8];
+        std::memset(blob, 0xAB, sizeof(blob));
+        hp_result* o = reinterpret_cast<hp_result*>(blob);
+        const uint32_t oldSize = uint32_t(offsetof(hp_result, sd1));
+        o->size = oldSize;
+        check(hp_analyze_into(sig.samples.data(), x.size(), fs, nullptr, o, nullptr) == 1 && o->version == HP_RESULT_VERSION
+              && o->bpm == m.bpm && o->size == oldSize && blob[oldSize] == 0xAB && blob[sizeof(blob) - 1] == 0xAB,
+              "writes stop at the caller's size");
+        hp_result tiny{}; tiny.size = 4;
+        check(hp_analyze_into(sig.samples.data(), x.size(), fs, nullptr, &tiny, nullptr) == -1, "undersized struct rejected");
+        check(hp_rt_poll_into(nullptr, nullptr, nullptr) == -1 && hp_analyze_into(nullptr, 0, fs, nullptr, &r, nullptr) == -1,
+              "bad arguments rejected");
+    }
+
+    // 3) Background worker: once the staged arrays reach their working size, polls into caller
+    //    buffers allocate nothing on this thread (growth as beat counts rise is the only traffic)
+    {
+        heartpy::SynthConfig c; c.fs = fs;
+        const auto steady = heartpy::generateSignal(c, 180.0);
+        heartpy::Options o; o.backgroundWorker = true;
+        void* h = hp_rt_create(fs, &o);
+        hp_rt_set_window(h, 20.0);
+        const size_t warm = size_t(40 * fs);
+        size_t polls = 0, allocs = 0, cppPolls = 0, cppAllocs = 0, k = 0;
+        for (size_t i = 0; i + 10 <= n; i += 10) {
+            hp_rt_push(h, steady.samples.data() + i, 10, 0.0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            const size_t before = g_allocs;
+            if (++k % 4 == 0) {
+                // For comparison: hp_rt_poll into a fresh HeartMetrics, as the bridges do
+                heartpy::HeartMetrics fresh;
+                if (hp_rt_poll(h, &fresh) && i >= warm) { ++cppPolls; cppAllocs += g_allocs - before; }
+                continue;
+            }
+            hp_result r{}; r.size = sizeof(r);
+            if (hp_rt_poll_into(h, &r, &bufs) && i >= warm) { ++polls; allocs += g_allocs - before; }
+        }
+        std::cout << "worker polls: " << polls << ", allocations per poll_into: " << (polls ? double(allocs) / polls : 0.0)
+                  << " (hp_rt_poll into a fresh result: " << (cppPolls ? double(cppAllocs) / cppPolls : 0.0) << ")\n";
+        check(polls > 20 && allocs * 10 <= polls, "poll_into is allocation-free once warm");
+        hp_rt_destroy(h);
+    }
+
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
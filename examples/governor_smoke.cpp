@@ -0,0 +1,60 @@
+// Compute governor: stage cadence follows the poll budget and signal difficulty; flat windows short-circuit
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+struct Stats { int polls = 0, batch = 0, grid = 0, psd = 0, flat = 0, maxLevel = 0; double bpm = 0.0; bool good = true; };
+
+static Stats run(const std::vector<float>& x, double budgetMs) {
+    using Q = heartpy::QualityInfo;
+    heartpy::Options o; o.useHPThreshold = true; o.pollBudgetMs = budgetMs;
+    heartpy::RealtimeAnalyzer rt(50.0, o);
+    rt.setWindowSeconds(20.0);
+    Stats st;
+    heartpy::HeartMetrics m;
+    for (size_t i = 0; i + 10 <= x.size(); i += 10) {
+        rt.push(x.data() + i, 10);
+        if (!rt.poll(m)) continue;
+        ++st.polls;
+        const unsigned s = m.quality.pollStagesRun;
+        st.batch += (s & Q::kStageBatch) ? 1 : 0;
+        st.grid += (s & Q::kStageMaGrid) ? 1 : 0;
+        st.psd += (s & Q::kStagePsd) ? 1 : 0;
+        st.flat += (s & Q::kStageFlatSkip) ? 1 : 0;
+        st.maxLevel = std::max(st.maxLevel, m.quality.governorLevel);
+        st.bpm = m.bpm;
+        st.good = m.quality.goodQuality;
+    }
+    return st;
+}
+
+int main() {
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+    auto x = heartpy::generateSignal(heartpy::SynthConfig{}, 90.0).samples;
+
+    Stats off = run(x, 0.0);
+    check(off.batch == off.polls && off.maxLevel == 0 && off.flat == 0, "governor off runs every stage");
+
+    // Generous budget: cost never triggers, but a stable signal still relaxes retuning and PSD
+    Stats stable = run(x, 1000.0);
+    check(stable.maxLevel == 1, "stable signal level");
+    check(stable.grid < off.grid && stable.psd < off.psd, "stable signal skips retune/PSD");
+    check(std::fabs(stable.bpm - 72.0) < 3.0, "stable bpm");
+
+    // Impossible budget: escalates to the cheapest level, batch analysis runs on ~1/4 of polls
+    Stats tight = run(x, 1e-6);
+    check(tight.maxLevel == 3, "tight budget level");
+    check(tight.batch * 2 < tight.polls && tight.psd < stable.psd, "tight budget skips stages");
+    check(std::fabs(tight.bpm - 72.0) < 3.0, "tight budget bpm");
+
+    // Flat input (sensor saturated / no contact): analysis short-circuits
+    std::vector<float> flat(50 * 40, 1023.0f);
+    Stats f = run(flat, 5.0);
+    check(f.flat > 0 && f.bpm == 0.0 && !f.good, "flat window short-circuit");
+
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+// ma_perc retune smoke: incremental candidates pick a sane ma_perc, survive checkpoint/restore and amplitude steps;
+// before/after against the legacy full-window grid (Options::maGridIncremental = false)
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <string>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+static std::string feed(heartpy::RealtimeAnalyzer& rt, const std::vector<float>& x, size_t from, size_t to,
+                        heartpy::HeartMetrics* last = nullptr, unsigned* stages = nullptr) {
+    std::string log;
+    heartpy::HeartMetrics m;
+    for (size_t i = from; i + 10 <= to; i += 10) {
+        rt.push(x.data() + i, 10);
+        if (!rt.poll(m)) continue;
+        log += std::to_string(m.bpm) + " " + std::to_string(m.quality.maPercActive) + "|";
+        for (int p : m.peakList) log += std::to_string(p) + ",";
+        log += "\n";
+        if (last) *last = m;
+        if (stages) *stages |= m.quality.pollStagesRun;
+    }
+    return log;
+}
+
+int main() {
+    const double fs = 50.0;
+    int failures = 0;
+    heartpy::SynthConfig sc; sc.fs = fs;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+
+    // 1) HP thresholding: the grid runs and settles on an in-range ma_perc with the right rate
+    {
+        heartpy::RealtimeAnalyzer rt(fs);
+        rt.applyPresetTorch();
+        rt.setWindowSeconds(20.0);
+        auto x = heartpy::generateSignal(sc, 60.0).samples;
+        heartpy::HeartMetrics last;
+        unsigned stages = 0;
+        feed(rt, x, 0, x.size(), &last, &stages);
+        check((stages & heartpy::QualityInfo::kStageMaGrid) != 0, "grid retune ran");
+        check(last.quality.maPercActive >= 10.0 && last.quality.maPercActive <= 60.0, "ma_perc in range");
+        check(std::fabs(last.bpm - 72.0) < 3.0, "bpm");
+    }
+
+    // 2) Candidate state travels with the checkpoint: restored and original stay identical
+    {
+        heartpy::RealtimeAnalyzer rt(fs);
+        rt.applyPresetTorch();
+        rt.setWindowSeconds(20.0);
+        auto x = heartpy::generateSignal(sc, 60.0).samples;
+        const size_t cut = static_cast<size_t>(35.0 * fs);
+        feed(rt, x, 0, cut);
+        auto blob = rt.checkpoint();
+        auto copy = heartpy::RealtimeAnalyzer::restore(blob.data(), blob.size());
+        check(copy != nullptr, "restore");
+        if (copy) {
+            const std::string a = feed(rt, x, cut, x.size());
+            const std::string b = feed(*copy, x, cut, x.size());
+            check(!a.empty() && a == b, "checkpoint parity");
+        }
+    }
+
+    // 3) A 3x amplitude step invalidates cached decisions; detection recovers
+    {
+        heartpy::RealtimeAnalyzer rt(fs);
+        rt.applyPresetTorch();
+        rt.setWindowSeconds(20.0);
+        auto x = heartpy::generateSignal(sc, 90.0).samples;
+        for (size_t i = static_cast<size_t>(30.0 * fs); i < x.size(); ++i) x[i] = float(sc.offset + 3.0 * (x[i] - sc.offset));
+        heartpy::HeartMetrics last;
+        feed(rt, x, 0, x.size(), &last);
+        check(std::fabs(last.bpm - 72.0) < 3.0, "bpm after amplitude step");
+    }
+
+    // 4) Behaviour change vs the legacy grid: with motion and ectopics the incremental candidates
+    //    pick different peaks on many polls and track the true rate more closely
+    {
+        heartpy::SynthConfig c; c.fs = fs; c.motionPerMin = 2.0; c.ectopicProb = 0.03;
+        const auto sig = heartpy::generateSignal(c, 240.0);
+        const double winSec = 20.0;
+        auto run = [&](bool incremental, std::vector<double>& bpm, std::vector<double>& truth, unsigned& stages) {
+            heartpy::Options o; o.maGridIncremental = incremental;
+            heartpy::RealtimeAnalyzer rt(fs, o);
+            rt.applyPresetTorch();
+            rt.setWindowSeconds(winSec);
+            heartpy::HeartMetrics m;
+            for (size_t i = 0; i + 10 <= sig.samples.size(); i += 10) {
+                rt.push(sig.samples.data() + i, 10);
+                if (!rt.poll(m)) continue;
+                stages |= m.quality.pollStagesRun;
+                // Truth: mean rate of the generated beats inside the window
+                const double tEnd = (i + 10) / fs;
+                double first = -1.0, last = -1.0; int beats = 0;
+                for (double b : sig.beatTimes) {
+                    if (b < tEnd - winSec || b >= tEnd) continue;
+                    if (first < 0.0) first = b;
+                    last = b; ++beats;
+                }
+                bpm.push_back(m.bpm);
+                truth.push_back(beats >= 2 ? 60.0 * (beats - 1) / (last - first) : NAN);
+            }
+        };
+        std::vector<double> legacy, inc, truth, truth2;
+        unsigned legacyStages = 0, incStages = 0;
+        run(false, legacy, truth, legacyStages);
+        run(true, inc, truth2, incStages);
+        const size_t warm = 100;   // polls (~25 s) before the window is full and the grid settles
+        double errLegacy = 0.0, errInc = 0.0;
+        size_t counted = 0, differ = 0;
+        for (size_t k = warm; k < std::min(legacy.size(), inc.size()); ++k) {
+            if (std::isnan(truth[k])) continue;
+            errLegacy += std::fabs(legacy[k] - truth[k]);
+            errInc += std::fabs(inc[k] - truth[k]);
+            if (std::fabs(legacy[k] - inc[k]) > 1.0) ++differ;
+            ++counted;
+        }
+        if (counted) { errLegacy /= counted; errInc /= counted; }
+        std::cout << "legacy grid: " << errLegacy << " bpm mean error, incremental: " << errInc
+                  << " bpm; " << differ << "/" << counted << " polls differ by >1 bpm\n";
+        check(legacy.size() == inc.size() && counted > 250, "both grids produce the same polls");
+        check((legacyStages & heartpy::QualityInfo::kStageMaGrid) && (incStages & heartpy::QualityInfo::kStageMaGrid), "both grids ran");
+        check(errInc < 1.0 && errInc <= errLegacy, "incremental grid at least as accurate as the legacy grid");
+    }
+
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
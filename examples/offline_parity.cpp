@@ -0,0 +1,99 @@
+// Offline analysis: analyzeRecording() reproduces a live push()/poll() session's update series
+// bit for bit (chunk sizes, timestamps, presets, settings) and reports its speedup
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <chrono>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+static std::string fmt(double t, const heartpy::HeartMetrics& m) {
+    // Hex floats: equal strings mean equal bits (t in decimal: untimed input accumulates its clock)
+    char buf[320];
+    std::snprintf(buf, sizeof(buf), "%.6f %a %a %a %a %a %a %d|", t, m.bpm, m.sdnn, m.rmssd, m.breathingRate,
+                  m.quality.snrDb, m.quality.confidence, m.quality.goodQuality ? 1 : 0);
+    std::string s = buf;
+    for (int p : m.peakList) s += std::to_string(p) + ",";
+    return s + "\n";
+}
+
+struct Case {
+    const char* name;
+    size_t chunk;
+    bool ts;
+    heartpy::Options opt;
+    double window, update;
+    bool torch;
+};
+
+static void setup(heartpy::RealtimeAnalyzer& rt, const Case& c) {
+    if (c.torch) rt.applyPresetTorch();
+    rt.setWindowSeconds(c.window);
+    if (c.update > 0.0) rt.setUpdateIntervalSeconds(c.update);
+}
+
+static std::string live(const Case& c, const heartpy::SynthSignal& sig, double fs, double* sec) {
+    heartpy::RealtimeAnalyzer rt(fs, c.opt);
+    setup(rt, c);
+    std::string log;
+    heartpy::HeartMetrics m;
+    const size_t n = sig.samples.size();
+    const auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i += c.chunk) {
+        const size_t k = std::min(c.chunk, n - i);
+        if (c.ts) rt.push(sig.samples.data() + i, sig.timestamps.data() + i, k);
+        else rt.push(sig.samples.data() + i, k);
+        if (rt.poll(m)) log += fmt(c.ts ? sig.timestamps[i + k - 1] : (i + k) / fs, m);
+    }
+    *sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return log;
+}
+
+int main() {
+    const double fs = 50.0;
+    int failures = 0;
+    auto check = [&](bool ok, const std::string& what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+    heartpy::SynthConfig cfg; cfg.fs = fs; cfg.jitterMs = 2.0; cfg.motionPerMin = 1.0; cfg.ectopicProb = 0.02;
+    const auto sig = heartpy::generateSignal(cfg, 300.0);
+
+    std::vector<Case> cases(5);
+    cases[0] = {"chunk 10", 10, false, {}, 60.0, 1.0, false};
+    cases[1] = {"chunk 25, timestamps", 25, true, {}, 20.0, 0.0, false};
+    cases[2] = {"chunk 7, torch", 7, false, {}, 30.0, 0.5, true};
+    cases[3] = {"ring off, int16", 10, true, {}, 30.0, 1.0, false};
+    cases[3].opt.useRingBuffer = false;
+    cases[4] = {"preprocessing", 13, false, {}, 30.0, 1.0, false};
+    cases[4].opt.hampelCorrect = true; cases[4].opt.removeBaselineWander = true;
+    cases[0].opt.storageMode = heartpy::Options::StorageMode::INT16;
+    double liveSec = 0.0, offSec = 0.0;
+    for (const auto& c : cases) {
+        double sec = 0.0;
+        const std::string a = live(c, sig, fs, &sec);
+        liveSec += sec;
+        const auto t0 = std::chrono::steady_clock::now();
+        const auto ups = heartpy::RealtimeAnalyzer::analyzeRecording(fs, c.opt, sig.samples.data(),
+            c.ts ? sig.timestamps.data() : nullptr, sig.samples.size(), c.chunk,
+            [&](heartpy::RealtimeAnalyzer& rt) { setup(rt, c); });
+        offSec += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::string b;
+        for (const auto& u : ups) b += fmt(u.t, u.metrics);
+        check(!a.empty() && a == b, std::string(c.name) + ": offline == live");
+    }
+
+    // chunk 0 = one update interval: the same series backfill() produces
+    {
+        std::string a, b;
+        heartpy::RealtimeAnalyzer rt(fs);
+        rt.setWindowSeconds(20.0);
+        rt.backfill(sig.samples.data(), nullptr, sig.samples.size(), [&](double t, const heartpy::HeartMetrics& m) { a += fmt(t, m); });
+        for (const auto& u : heartpy::RealtimeAnalyzer::analyzeRecording(fs, {}, sig.samples.data(), nullptr, sig.samples.size(), 0,
+                 [](heartpy::RealtimeAnalyzer& r) { r.setWindowSeconds(20.0); }))
+            b += fmt(u.t, u.metrics);
+        check(!a.empty() && a == b, "chunk 0 == backfill");
+    }
+
+    std::cout << "offline: " << liveSec / offSec << "x the live push/poll loop (" << liveSec * 1e3 << " ms -> " << offSec * 1e3 << " ms)\n";
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+// Order-statistic set: randomized insert/erase/k-th against a sorted reference; analyzer RR quantiles
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+int main() {
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+
+    // 1) Randomized multiset operations (duplicates included) match a sorted vector
+    {
+        heartpy::OrderStatTree<int> t;
+        std::vector<int> ref;
+        unsigned s = 12345u;
+        bool ok = true;
+        for (int step = 0; step < 20000 && ok; ++step) {
+            s = 1664525u * s + 1013904223u;
+            int v = (int)((s >> 8) % 64);
+            if (ref.empty() || (s & 3u) != 0u) {
+                t.insert(v);
+                ref.insert(std::upper_bound(ref.begin(), ref.end(), v), v);
+            } else {
+                bool present = std::binary_search(ref.begin(), ref.end(), v);
+                ok = (t.erase(v) == present);
+                if (present) ref.erase(std::lower_bound(ref.begin(), ref.end(), v));
+            }
+            ok = ok && t.size() == ref.size();
+            if (ok && !ref.empty()) {
+                size_t k = (s >> 4) % ref.size();
+                ok = t.kth(k) == ref[k] && t.median() == ref[ref.size() / 2];
+            }
+            if (ref.size() > 300) { while (ref.size() > 100) { t.erase(ref.back()); ref.pop_back(); } }
+        }
+        check(ok, "treap matches reference");
+        check(!ref.empty() && t.quantile(0.0) == ref.front() && t.quantile(1.0) == ref.back(), "quantile bounds");
+        t.clear();
+        check(t.empty() && t.size() == 0, "clear");
+    }
+
+    // 2) Analyzer: running RR quantiles agree with the materialized RR list
+    {
+        heartpy::Options o; o.useHPThreshold = true;
+        heartpy::RealtimeAnalyzer rt(50.0, o);
+        rt.setWindowSeconds(20.0);
+        check(rt.rrQuantile(0.5) == 0.0, "no peaks -> 0");
+        auto x = heartpy::generateSignal(heartpy::SynthConfig{}, 45.0).samples;
+        for (size_t i = 0; i + 10 <= x.size(); i += 10) rt.push(x.data() + i, 10);
+        // Read before any poll so the RR view is the raw peak-to-peak list
+        std::vector<double> rr = rt.latestRR();
+        std::sort(rr.begin(), rr.end());
+        check(rr.size() >= 10, "enough beats");
+        if (!rr.empty()) {
+            check(rt.rrQuantile(0.5) == rr[rr.size() / 2], "median");
+            check(rt.rrQuantile(0.0) == rr.front() && rt.rrQuantile(1.0) == rr.back(), "min/max");
+            check(rt.rrQuantile(0.9) == rr[std::min(rr.size() - 1, (size_t)(0.9 * rr.size()))], "p90");
+            check(std::fabs(60000.0 / rt.rrQuantile(0.5) - 72.0) < 4.0, "median bpm");
+        }
+    }
+
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
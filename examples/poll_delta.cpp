@@ -0,0 +1,205 @@
+// Incremental polling: a BeatMirror fed by pollDelta() reproduces every full poll (peaks, RR,
+// mask, scalars, warning) through warm-up, motion and ectopics; resets, the C entry point with
+// short buffers (and re-copied into grown ones), and the per-poll payload compared with the full result
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cstring>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+static bool eq(double a, double b) { return std::memcmp(&a, &b, sizeof(a)) == 0; }
+
+static bool sameRR(const std::vector<double>& a, const std::vector<double>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) if (!eq(a[i], b[i])) return false;
+    return true;
+}
+
+// The mirror's view against a full poll of an identical analyzer
+static bool mirrors(const heartpy::BeatMirror& mir, const heartpy::HeartMetrics& m) {
+    std::vector<int> pk, mask;
+    std::vector<double> rr;
+    mir.rebuild(pk, rr, mask);
+    using S = heartpy::PollDelta;
+    return pk == m.peakList && sameRR(rr, m.rrList) && mask == m.binaryPeakMask
+        && eq(mir.scalars[S::kBpm], m.bpm) && eq(mir.scalars[S::kRmssd], m.rmssd) && eq(mir.scalars[S::kSd2], m.sd2)
+        && eq(mir.scalars[S::kSnrDb], m.quality.snrDb) && eq(mir.scalars[S::kConfidence], m.quality.confidence)
+        && mir.scalars[S::kGoodQuality] == (m.quality.goodQuality ? 1.0 : 0.0)
+        && mir.qualityWarning == m.quality.qualityWarning;
+}
+
+// A PollDelta rebuilt from the C layout
+static heartpy::PollDelta fromFlat(const hp_poll_delta& out, const hp_delta_buffers& b) {
+    heartpy::PollDelta d;
+    d.reset = out.reset != 0; d.windowStartAbs = out.windowStartAbs;
+    d.rrPerBeat = out.rrPerBeat != 0; d.maskPerBeat = out.maskPerBeat != 0;
+    for (uint32_t k = 0; k < out.addedCount; ++k) d.added.push_back({b.added[k].absIndex, b.added[k].rrMs, b.added[k].accepted != 0});
+    for (uint32_t k = 0; k < out.revisedCount; ++k) d.revised.push_back({b.revised[k].absIndex, b.revised[k].rrMs, b.revised[k].accepted != 0});
+    d.removed.assign(b.removed, b.removed + out.removedCount);
+    d.rrList.assign(b.rrList, b.rrList + out.rrListCount);
+    d.mask.assign(b.mask, b.mask + out.maskCount);
+    d.changedScalars = out.changedScalars;
+    std::memcpy(d.scalars, out.scalars, sizeof(d.scalars));
+    d.warningChanged = out.warningChanged != 0;
+    if (d.warningChanged) d.qualityWarning = b.warning;
+    return d;
+}
+
+int main() {
+    const double fs = 50.0;
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+    heartpy::SynthConfig cfg; cfg.fs = fs; cfg.jitterMs = 2.0; cfg.motionPerMin = 2.0; cfg.ectopicProb = 0.03;
+    const auto sig = heartpy::generateSignal(cfg, 240.0);
+    const size_t n = sig.samples.size();
+
+    // 1) Mirror == full poll on every update, with a reset midway; payload size vs the full result
+    {
+        heartpy::RealtimeAnalyzer full(fs), inc(fs);
+        full.setWindowSeconds(20.0); inc.setWindowSeconds(20.0);
+        heartpy::HeartMetrics m;
+        heartpy::PollDelta d;
+        heartpy::BeatMirror mir;
+        int polls = 0, matched = 0, resets = 0, warmDeltas = 0;
+        bool seqOk = true, warmupCovered = false;
+        size_t fullBytes = 0, deltaBytes = 0, beatsChanged = 0;
+        for (size_t i = 0; i < n; i += 10) {
+            if (i == n / 2) inc.resetPollDelta();
+            full.push(sig.samples.data() + i, 10);
+            inc.push(sig.samples.data() + i, 10);
+            const bool a = full.poll(m), b = inc.pollDelta(d);
+            if (a != b) { seqOk = false; break; }
+            if (!a) continue;
+            ++polls;
+            seqOk = seqOk && d.seq == uint64_t(polls);
+            if (d.reset) ++resets;
+            if (!d.rrPerBeat) warmupCovered = true;
+            mir.apply(d);
+            if (mirrors(mir, m)) ++matched;
+            if (i >= size_t(40 * fs) && !d.reset) {
+                // What a bridge would serialize: full arrays vs the changes
+                fullBytes += m.peakList.size() * 4 + m.rrList.size() * 8 + m.binaryPeakMask.size() * 4 + 14 * 8;
+                deltaBytes += (d.added.size() + d.revised.size()) * 13 + d.removed.size() * 8 + 8
+                            + size_t(__builtin_popcount(d.changedScalars)) * 8 + d.rrList.size() * 8 + d.mask.size() * 4;
+                beatsChanged += d.added.size() + d.revised.size() + d.removed.size();
+                ++warmDeltas;
+            }
+        }
+        check(polls > 350 && matched == polls, "mirror == full poll");
+        check(seqOk && resets == 2, "sequence numbers and resets");
+        check(warmupCovered, "warm-up output carried as full RR lists");
+        std::cout << "delta: " << double(beatsChanged) / warmDeltas << " beats changed per poll, "
+                  << double(deltaBytes) / warmDeltas << " B vs " << double(fullBytes) / warmDeltas << " B per poll ("
+                  << 100.0 * deltaBytes / fullBytes << "%)\n";
+        check(deltaBytes * 4 < fullBytes, "delta payload well under the full result");
+    }
+
+    // 2) A restored analyzer keeps the window start and starts its deltas with a reset
+    {
+        heartpy::RealtimeAnalyzer a(fs);
+        a.setWindowSeconds(20.0);
+        heartpy::PollDelta d;
+        for (size_t i = 0; i < size_t(60 * fs); i += 10) {
+            a.push(sig.samples.data() + i, 10);
+            a.pollDelta(d);
+        }
+        auto blob = a.checkpoint();
+        auto b = heartpy::RealtimeAnalyzer::restore(blob.data(), blob.size());
+        check(b && d.windowStartAbs > 0 && b->getQuality().windowStartAbs == d.windowStartAbs, "window start survives a restore");
+        bool got = false;
+        for (size_t i = size_t(60 * fs); i < size_t(70 * fs) && !got; i += 10) {
+            b->push(sig.samples.data() + i, 10);
+            got = b->pollDelta(d);
+        }
+        check(got && d.reset && d.seq == 1 && !d.added.empty(), "restore starts with a reset");
+    }
+
+    // 3) C entry point: mirror built from flat arrays matches; short buffers force a reset
+    {
+        void* h = hp_rt_create(fs, nullptr);
+        heartpy::RealtimeAnalyzer full(fs);
+        hp_rt_set_window(h, 20.0); full.setWindowSeconds(20.0);
+        std::vector<hp_beat> added(256), revised(256);
+        std::vector<uint64_t> removed(256);
+        std::vector<double> rr(512);
+        std::vector<int32_t> mask(512);
+        char warning[128];
+        heartpy::BeatMirror mir;
+        heartpy::HeartMetrics m;
+        int polls = 0, checked = 0, matched = 0, shorts = 0, resetsAfterShort = 0;
+        bool shortSeen = false;
+        for (size_t i = 0; i < n; i += 10) {
+            hp_rt_push(h, sig.samples.data() + i, 10, 0.0);
+            full.push(sig.samples.data() + i, 10);
+            // Every 50th poll gets no room for beats
+            const bool starve = polls % 50 == 49;
+            hp_delta_buffers bufs{added.data(), starve ? 0 : added.size(), revised.data(), revised.size(),
+                                  removed.data(), removed.size(), rr.data(), rr.size(), mask.data(), mask.size(), warning, sizeof(warning)};
+            hp_poll_delta out{}; out.size = sizeof(out);
+            const int got = hp_rt_poll_delta(h, &out, &bufs);
+            if (!full.poll(m) || got != 1) continue;
+            ++polls;
+            if (shortSeen && out.reset) ++resetsAfterShort;
+            shortSeen = (out.truncated & HP_TRUNC_ADDED) != 0;
+            if (shortSeen) { ++shorts; continue; }   // this delta is incomplete; the next one rebuilds the mirror
+            mir.apply(fromFlat(out, bufs));
+            ++checked;
+            if (mirrors(mir, m)) ++matched;
+        }
+        check(checked > 350 && matched == checked, "C mirror == full poll");
+        check(shorts >= 5 && resetsAfterShort >= shorts - 1, "short buffers force a reset");
+        hp_poll_delta tiny{}; tiny.size = 4;
+        check(hp_rt_poll_delta(h, &tiny, nullptr) == -1, "undersized struct rejected");
+        hp_rt_destroy(h);
+    }
+
+    // 4) Buffers grown to the reported counts and the same delta copied again: the mirror stays
+    //    complete and no reset follows
+    {
+        void* h = hp_rt_create(fs, nullptr);
+        heartpy::RealtimeAnalyzer full(fs);
+        hp_rt_set_window(h, 60.0); full.setWindowSeconds(60.0);
+        std::vector<hp_beat> added(4), revised(4);
+        std::vector<uint64_t> removed(4);
+        std::vector<double> rr(4);
+        std::vector<int32_t> mask(4);
+        char warning[128];
+        heartpy::BeatMirror mir;
+        heartpy::HeartMetrics m;
+        int checked = 0, matched = 0, regrown = 0, resets = 0;
+        hp_poll_delta none{}; none.size = sizeof(none);
+        check(hp_rt_last_delta_into(h, &none, nullptr) == 0, "nothing to re-copy before a delta");
+        for (size_t i = 0; i < n; i += 10) {
+            hp_rt_push(h, sig.samples.data() + i, 10, 0.0);
+            full.push(sig.samples.data() + i, 10);
+            hp_delta_buffers bufs{added.data(), added.size(), revised.data(), revised.size(), removed.data(), removed.size(),
+                                  rr.data(), rr.size(), mask.data(), mask.size(), warning, sizeof(warning)};
+            hp_poll_delta out{}; out.size = sizeof(out);
+            const int got = hp_rt_poll_delta(h, &out, &bufs);
+            if (!full.poll(m) || got != 1) continue;
+            if (out.reset) ++resets;
+            if (out.truncated & (HP_TRUNC_ADDED | HP_TRUNC_REVISED | HP_TRUNC_REMOVED | HP_TRUNC_RR | HP_TRUNC_MASK)) {
+                added.resize(std::max<size_t>(added.size(), out.addedCount));
+                revised.resize(std::max<size_t>(revised.size(), out.revisedCount));
+                removed.resize(std::max<size_t>(removed.size(), out.removedCount));
+                rr.resize(std::max<size_t>(rr.size(), out.rrListCount));
+                mask.resize(std::max<size_t>(mask.size(), out.maskCount));
+                bufs = hp_delta_buffers{added.data(), added.size(), revised.data(), revised.size(), removed.data(), removed.size(),
+                                        rr.data(), rr.size(), mask.data(), mask.size(), warning, sizeof(warning)};
+                if (hp_rt_last_delta_into(h, &out, &bufs) != 1 || out.truncated) continue;
+                ++regrown;
+            }
+            mir.apply(fromFlat(out, bufs));
+            ++checked;
+            if (mirrors(mir, m)) ++matched;
+        }
+        check(regrown >= 1 && checked > 350 && matched == checked, "re-copied delta keeps the mirror complete");
+        check(resets == 1, "re-copy cancels the forced reset");
+        hp_rt_destroy(h);
+    }
+
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
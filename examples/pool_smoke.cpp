@@ -0,0 +1,123 @@
+// AnalyzerPool smoke: many sessions on a few workers, batched push/poll, memory budgets
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include "../cpp/heartpy_pool.h"
+#include "../cpp/heartpy_synth.h"
+
+int main() {
+    const double fs = 50.0;
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+
+    // Budgets: per-session estimate above the cap is rejected; global cap bounds the count
+    {
+        heartpy::Options o; o.useIngestQueue = true; // what open() plans for
+        const size_t est = heartpy::AnalyzerPool::estimateSessionBytes(fs, o, 20.0);
+        heartpy::PoolConfig cfg; cfg.workers = 1; cfg.sessionMemoryBudgetBytes = est; cfg.globalMemoryBudgetBytes = 3 * est;
+        heartpy::AnalyzerPool pool(cfg);
+        check(pool.open(fs, o, 120.0) == 0, "per-session budget");
+        int opened = 0;
+        for (int i = 0; i < 5; ++i) if (pool.open(fs, o, 20.0) != 0) ++opened;
+        check(opened == 3, "global budget");
+        check(pool.stats().rejectedOpensTotal == 3 && pool.stats().bytesReserved == 3 * est, "budget accounting");
+    }
+
+    // 64 sessions on 4 workers, fed in rounds through pushMany
+    {
+        heartpy::PoolConfig cfg; cfg.workers = 4; cfg.sweepSeconds = 0.005;
+        heartpy::AnalyzerPool pool(cfg);
+        heartpy::Options o; o.ingestBackpressure = heartpy::Options::Backpressure::BLOCK;
+        const int sessions = 64;
+        std::vector<heartpy::SessionId> ids;
+        for (int i = 0; i < sessions; ++i) ids.push_back(pool.open(fs, o, 20.0));
+        heartpy::SynthConfig sc; sc.fs = fs; sc.bpm = 72.0;
+        auto x = heartpy::generateSignal(sc, 60.0).samples;
+        const size_t chunk = 10;
+        std::vector<heartpy::AnalyzerPool::PushItem> items(sessions);
+        std::vector<heartpy::AnalyzerPool::PollResult> results;
+        std::vector<double> lastBpm(sessions + 1, 0.0);
+        size_t updates = 0;
+        for (size_t i = 0; i + chunk <= x.size(); i += chunk) {
+            for (int s = 0; s < sessions; ++s) items[s] = {ids[s], x.data() + i, nullptr, chunk};
+            check(pool.pushMany(items.data(), items.size()) == (size_t)sessions, "pushMany delivered");
+            // ~70x realtime: keeps each session's poll cadence within its update interval
+            std::this_thread::sleep_for(std::chrono::milliseconds(3));
+            if ((i / chunk) % 25 == 0) {
+                updates += pool.pollMany(results);
+                for (auto& r : results) lastBpm[r.id] = r.metrics.bpm;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        updates += pool.pollMany(results);
+        for (auto& r : results) lastBpm[r.id] = r.metrics.bpm;
+        int good = 0;
+        for (auto id : ids) if (std::fabs(lastBpm[id] - 72.0) < 3.0) ++good;
+        check(good == sessions, "all sessions converge");
+        check(updates > 0 && pool.stats().updatesTotal >= updates, "updates counted");
+        // Migration: a checkpointed session reopens warm (no second warm-up)
+        auto blob = pool.checkpoint(ids[1]);
+        heartpy::SessionId moved = pool.restore(blob.data(), blob.size());
+        check(!blob.empty() && moved != 0, "checkpoint/restore session");
+        {
+            heartpy::AnalyzerPool::PushItem more {moved, x.data() + x.size() - 100, nullptr, 100};
+            pool.pushMany(&more, 1);
+            double bpm = 0.0;
+            for (int k = 0; k < 100 && bpm == 0.0; ++k) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                pool.pollMany(results);
+                for (auto& r : results) if (r.id == moved) bpm = r.metrics.bpm;
+            }
+            check(std::fabs(bpm - 72.0) < 3.0, "restored session is warm");
+        }
+        // Closing a session with an update still pending drops that update
+        {
+            pool.pollMany(results);
+            const unsigned long long before = pool.stats().updatesTotal;
+            heartpy::AnalyzerPool::PushItem more {ids[2], x.data() + x.size() - 100, nullptr, 100};
+            for (int k = 0; k < 100 && pool.stats().updatesTotal == before; ++k) {
+                pool.pushMany(&more, 1);
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            pool.close(ids[2]);
+            pool.pollMany(results);
+            bool stale = false;
+            for (auto& r : results) stale = stale || r.id == ids[2];
+            check(pool.stats().updatesTotal > before && !stale, "closed session not polled");
+        }
+        pool.close(moved);
+        pool.close(ids[0]);
+        heartpy::AnalyzerPool::PushItem stale {ids[0], x.data(), nullptr, chunk};
+        check(pool.pushMany(&stale, 1) == 0 && pool.stats().unknownPushesTotal == 1, "closed session");
+        check(pool.stats().sessions == (size_t)sessions - 2, "session count");
+    }
+    // A producer stuck on a full BLOCK queue holds no pool lock; closing its session releases it
+    {
+        heartpy::PoolConfig cfg; cfg.workers = 1; cfg.sweepSeconds = 1.0;   // drains ~32 samples per second
+        heartpy::AnalyzerPool pool(cfg);
+        heartpy::Options o; o.ingestBackpressure = heartpy::Options::Backpressure::BLOCK; o.ingestQueueSeconds = 0.5;
+        const heartpy::SessionId id = pool.open(fs, o, 20.0);
+        std::vector<float> x(400, 512.0f);
+        std::atomic<bool> done {false};
+        std::thread producer([&]{
+            heartpy::AnalyzerPool::PushItem it {id, x.data(), nullptr, x.size()};
+            pool.pushMany(&it, 1);
+            done = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        const auto t0 = std::chrono::steady_clock::now();
+        const heartpy::SessionId other = pool.open(fs, o, 20.0);
+        pool.close(other);
+        const double openCloseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        check(!done && openCloseMs < 200.0, "open/close not stalled by a blocked push");
+        pool.close(id);
+        for (int k = 0; k < 100 && !done; ++k) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        check(done, "close releases a blocked push");
+        producer.join();
+    }
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+// Parity check: fused preprocessing must match the staged functions bit-for-bit
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include "../cpp/heartpy_core.h"
+#include "../cpp/heartpy_synth.h"
+
+static std::vector<double> staged(const std::vector<double>& in, double fs, const heartpy::Options& o) {
+    std::vector<double> p = in;
+    if (o.interpClipping) p = heartpy::interpolateClipping(p, fs, o.clippingThreshold);
+    if (o.hampelCorrect) p = heartpy::hampelFilter(p, o.hampelWindow, o.hampelThreshold);
+    if (o.removeBaselineWander) p = heartpy::removeBaselineWander(p, fs);
+    if (o.enhancePeaks) p = heartpy::enhancePeaks(p, fs);
+    return p;
+}
+
+int main() {
+    const double fs = 50.0;
+    int failures = 0, cases = 0;
+    for (double seconds : {0.02, 0.06, 0.2, 30.0}) {
+        heartpy::SynthConfig sc; sc.fs = fs;
+        sc.amplitude = 300.0; sc.offset = 800.0; sc.noise = 0.07;
+        sc.clipLevel = 0.74;                                       // sensor saturation (~1022) for clipping
+        const auto x = heartpy::generateSignal(sc, seconds).samples;
+        std::vector<double> sig(x.begin(), x.end());
+        for (size_t i = 0; i < sig.size(); i += 97) sig[i] += (i / 97) % 2 ? 200.0 : -200.0; // spikes for Hampel
+        for (int mask = 0; mask < 16; ++mask) {
+            for (int hw : {0, 3, 6, 11}) {
+                heartpy::Options o;
+                o.interpClipping = (mask & 1) != 0; o.clippingThreshold = 1020.0;
+                o.hampelCorrect = (mask & 2) != 0; o.hampelWindow = hw;
+                o.removeBaselineWander = (mask & 4) != 0;
+                o.enhancePeaks = (mask & 8) != 0;
+                auto a = staged(sig, fs, o);
+                auto b = heartpy::preprocessSignal(sig, fs, o);
+                ++cases;
+                bool same = (a.size() == b.size()) && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0);
+                if (!same) {
+                    ++failures;
+                    std::cout << "MISMATCH n=" << sig.size() << " mask=" << mask << " hampelWindow=" << hw << "\n";
+                }
+            }
+        }
+    }
+    std::cout << (failures == 0 ? "OK" : "FAIL") << ": " << (cases - failures) << "/" << cases << " cases identical\n";
+    return failures == 0 ? 0 : 1;
+}
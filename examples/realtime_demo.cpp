@@ -67,8 +67,7 @@ int main(int argc, char** argv) {
     if (preset == "torch") { opt.lowHz = 0.7; opt.highHz = 3.0; opt.refractoryMs = std::max(300.0, opt.refractoryMs); opt.useHPThreshold = true; }
     else if (preset == "ambient") { opt.lowHz = 0.5; opt.highHz = 3.5; opt.refractoryMs = std::max(320.0, opt.refractoryMs); opt.useHPThreshold = true; }
 
-    // Note: analyzeSignal uses batch; deterministic affects internal spectral path via setDeterministic()
-    heartpy::setDeterministic(opt.deterministic);
+    // Note: analyzer and batch spectral paths both follow opt.deterministic (no global toggle needed)
 
     // Synthesize a clean-ish PPG around 72 BPM
     auto signal = make_ppg(fs, seconds, 72.0);
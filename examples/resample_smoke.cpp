@@ -0,0 +1,117 @@
+// Timestamp resampler: grid exactness, reconstruction, latency, gaps, and analyzer accuracy
+// under frame-timing jitter (Options::resampleTimestamps)
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+int main() {
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+    const double fs = 30.0;
+
+    // 1) Samples already on the grid come back unchanged, at most one input sample late
+    {
+        heartpy::TimestampResampler r; r.configure(fs);
+        std::vector<float> x, ox; std::vector<double> t, ot;
+        bool latencyOk = true;
+        for (int i = 0; i < 300; ++i) {
+            x.push_back(float(std::sin(0.37 * i) * 100.0 + 500.0));
+            t.push_back(5.0 + i * (1.0 / fs));
+            r.process(&x.back(), &t.back(), 1, ox, ot);
+            if (i >= 2 && ox.size() < size_t(i)) latencyOk = false;   // grid up to the previous sample
+        }
+        bool same = ox.size() >= 298;
+        for (size_t i = 0; same && i < ox.size(); ++i) same = ox[i] == x[i] && std::fabs(ot[i] - t[i]) < 1e-9;
+        check(same, "on-grid input passes through");
+        check(latencyOk, "one sample of latency");
+    }
+
+    // 2) Jittered sampling of a smooth pulse is reconstructed on the uniform grid
+    {
+        heartpy::TimestampResampler r; r.configure(fs);
+        std::vector<float> ox; std::vector<double> ot;
+        unsigned s = 11u;
+        auto rnd = [&]{ s = 1664525u * s + 1013904223u; return ((s >> 8) & 0xFFFFFF) / double(0xFFFFFF) - 0.5; };
+        auto f = [](double t) { return std::sin(2 * M_PI * 1.2 * t) + 0.3 * std::sin(2 * M_PI * 2.4 * t + 0.5); };
+        for (int i = 0; i < 3000; ++i) {
+            const double t = i / fs + 0.012 * rnd();   // ±6 ms frame jitter
+            const float v = float(f(t));
+            r.process(&v, &t, 1, ox, ot);
+        }
+        double maxErr = 0.0, maxStep = 0.0, minStep = 1.0;
+        for (size_t i = 0; i < ox.size(); ++i) {
+            maxErr = std::max(maxErr, std::fabs(ox[i] - f(ot[i])));
+            if (i) { maxStep = std::max(maxStep, ot[i] - ot[i - 1]); minStep = std::min(minStep, ot[i] - ot[i - 1]); }
+        }
+        check(ox.size() > 2990, "jittered input fills the grid");
+        check(std::fabs(maxStep - 1.0 / fs) < 1e-9 && std::fabs(minStep - 1.0 / fs) < 1e-9, "uniform output spacing");
+        check(maxErr < 0.02, "cubic reconstruction error");
+    }
+
+    // 3) Non-increasing timestamps are skipped; short gaps are bridged without overshoot;
+    //    gaps over kRestartSec re-anchor the grid
+    {
+        heartpy::TimestampResampler r; r.configure(fs);
+        std::vector<float> ox; std::vector<double> ot;
+        const float x[] = {1, 2, 3, 3, 4, 10, 10, 10, 10, 20, 21, 22};
+        const double t[] = {0.0, 1 / fs, 2 / fs, 1.5 / fs, 3 / fs, 4 / fs, 0.4, 0.4 + 1 / fs, 0.4 + 2 / fs, 3.0, 3.0 + 1 / fs, 3.0 + 2 / fs};
+        check(r.process(x, t, 12, ox, ot) == 1, "backtrack skipped");
+        bool bridged = true, reanchored = false;
+        for (size_t i = 0; i < ot.size(); ++i) {
+            if (ot[i] > 4 / fs && ot[i] < 0.4) bridged = bridged && ox[i] >= 10.0f - 1e-4f && ox[i] <= 10.0f + 1e-4f;
+            if (std::fabs(ot[i] - 3.0) < 1e-12) reanchored = true;
+        }
+        check(bridged, "dropout bridged linearly");
+        check(reanchored, "long gap re-anchors the grid");
+    }
+
+    // 4) Analyzer: camera-like timing (29.3 fps nominal 30, ±6 ms jitter) keeps BPM accurate
+    {
+        heartpy::SynthConfig c; c.fs = 29.3; c.jitterMs = 6.0; c.hrvLfMs = 0.0; c.rsaMs = 0.0; c.rrJitterMs = 0.0; c.noise = 0.01; c.seed = 3;
+        const auto sig = heartpy::generateSignal(c, 120.0);
+        double err[2] = {0.0, 0.0};
+        for (int on = 0; on < 2; ++on) {
+            heartpy::Options o; o.resampleTimestamps = on != 0;
+            heartpy::RealtimeAnalyzer rt(fs, o);
+            rt.setWindowSeconds(20.0);
+            heartpy::HeartMetrics m;
+            int k = 0;
+            for (size_t i = 0; i + 3 <= sig.samples.size(); i += 3) {
+                rt.push(sig.samples.data() + i, sig.timestamps.data() + i, 3);
+                if (rt.poll(m) && sig.timestamps[i] > 30.0) { err[on] += std::fabs(m.bpm - c.bpm); ++k; }
+            }
+            err[on] /= std::max(1, k);
+        }
+        std::cout << "mean |bpm error|: off=" << err[0] << " resampled=" << err[1] << "\n";
+        check(err[1] < 0.5 && err[1] < 0.5 * err[0], "resampling reduces jitter error");
+    }
+
+    // 5) Resampler state is part of the checkpoint
+    {
+        heartpy::SynthConfig c; c.fs = 29.3; c.jitterMs = 4.0;
+        const auto sig = heartpy::generateSignal(c, 60.0);
+        heartpy::Options o; o.resampleTimestamps = true;
+        heartpy::RealtimeAnalyzer a(fs, o);
+        a.setWindowSeconds(20.0);
+        const size_t cut = 901;   // not a multiple of the batch: the resampler holds a partial segment
+        a.push(sig.samples.data(), sig.timestamps.data(), cut);
+        auto blob = a.checkpoint();
+        auto b = heartpy::RealtimeAnalyzer::restore(blob.data(), blob.size());
+        std::string la, lb;
+        heartpy::HeartMetrics m;
+        for (size_t i = cut; i + 7 <= sig.samples.size(); i += 7) {
+            a.push(sig.samples.data() + i, sig.timestamps.data() + i, 7);
+            b->push(sig.samples.data() + i, sig.timestamps.data() + i, 7);
+            if (a.poll(m)) la += std::to_string(m.bpm) + " " + std::to_string(m.rmssd) + "\n";
+            if (b->poll(m)) lb += std::to_string(m.bpm) + " " + std::to_string(m.rmssd) + "\n";
+        }
+        check(!la.empty() && la == lb, "restored resampler continues identically");
+    }
+
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
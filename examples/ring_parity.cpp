@@ -0,0 +1,72 @@
+// Parity check: ring-buffer storage must match the legacy vector storage poll-for-poll
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <string>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+static std::string trace(bool ring, bool ts, int preset, double windowSec) {
+    const double fs = 50.0;
+    heartpy::Options opt; opt.useRingBuffer = ring;
+    heartpy::RealtimeAnalyzer rt(fs, opt);
+    if (preset == 1) rt.applyPresetTorch();
+    if (preset == 2) rt.applyPresetAmbient();
+    rt.setWindowSeconds(windowSec);
+    heartpy::SynthConfig cfg; cfg.fs = fs;
+    auto x = heartpy::generateSignal(cfg, 90.0).samples;
+    const size_t chunk = 10;
+    std::string log;
+    heartpy::HeartMetrics m;
+    for (size_t i = 0; i + chunk <= x.size(); i += chunk) {
+        if (ts) {
+            std::vector<double> t(chunk);
+            for (size_t k = 0; k < chunk; ++k) t[k] = (i + k) / fs;
+            rt.push(x.data() + i, t.data(), chunk);
+        } else {
+            rt.push(x.data() + i, chunk);
+        }
+        if (rt.poll(m)) {
+            char buf[160];
+            std::snprintf(buf, sizeof(buf), "%.9g %.9g %.9g %zu|", m.bpm, m.rmssd, m.quality.snrDb, m.peakList.size());
+            log += buf;
+            for (int p : m.peakList) log += std::to_string(p) + ",";
+            for (float v : rt.displayBuffer()) log += std::to_string(v) + ",";
+            for (int p : rt.latestPeaks()) log += std::to_string(p) + ",";
+            log += "\n";
+        }
+    }
+    return log;
+}
+
+int main() {
+    int failures = 0, cases = 0;
+    // RingBuffer basics: wrap-around, bulk push, O(1) front drop, regrow keeps newest
+    {
+        heartpy::RingBuffer<float> rb(5); // rounds up to 8
+        std::vector<float> a = {1, 2, 3, 4, 5, 6};
+        rb.push_back_many(a.data(), a.size());
+        rb.drop_front(4);
+        std::vector<float> b = {7, 8, 9, 10, 11};
+        rb.push_back_many(b.data(), b.size());
+        std::vector<float> snap; rb.snapshot(snap);
+        std::vector<float> want = {5, 6, 7, 8, 9, 10, 11};
+        ++cases; if (rb.capacity() != 8 || snap != want || rb.at(2) != 7 || rb.back() != 11) { ++failures; std::cout << "MISMATCH ring basics\n"; }
+        rb.reconfigure(4);
+        rb.snapshot(snap);
+        ++cases; if (snap != std::vector<float>({8, 9, 10, 11})) { ++failures; std::cout << "MISMATCH ring reconfigure\n"; }
+    }
+    for (bool ts : {false, true}) {
+        for (int preset : {0, 1, 2}) {
+            for (double w : {10.0, 30.0}) {
+                ++cases;
+                if (trace(true, ts, preset, w) != trace(false, ts, preset, w)) {
+                    ++failures;
+                    std::cout << "MISMATCH ts=" << ts << " preset=" << preset << " window=" << w << "\n";
+                }
+            }
+        }
+    }
+    std::cout << (failures == 0 ? "OK" : "FAIL") << ": " << (cases - failures) << "/" << cases << " cases identical\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+// Compact window storage: FILTERED_ONLY is result-identical to FULL, INT16 stays within tolerance;
+// memoryFootprint() reflects the savings
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <string>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+#include "../cpp/heartpy_pool.h"
+
+struct Run { std::string log; double bpm = 0.0; heartpy::MemoryFootprint mem; };
+
+static Run run(heartpy::Options::StorageMode mode, bool ring) {
+    const double fs = 50.0;
+    heartpy::Options o; o.storageMode = mode; o.useRingBuffer = ring;
+    heartpy::RealtimeAnalyzer rt(fs, o);
+    rt.setWindowSeconds(20.0);
+    auto x = heartpy::generateSignal(heartpy::SynthConfig{}, 60.0).samples;
+    Run r;
+    heartpy::HeartMetrics m;
+    for (size_t i = 0; i + 10 <= x.size(); i += 10) {
+        rt.push(x.data() + i, 10);
+        if (rt.poll(m)) {
+            r.bpm = m.bpm;
+            r.log += std::to_string(m.bpm) + "|";
+            for (int p : m.peakList) r.log += std::to_string(p) + ",";
+            r.log += "\n";
+        }
+    }
+    r.mem = rt.memoryFootprint();
+    return r;
+}
+
+int main() {
+    using SM = heartpy::Options::StorageMode;
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+
+    for (bool ring : {true, false}) {
+        Run full = run(SM::FULL, ring), filt = run(SM::FILTERED_ONLY, ring), q16 = run(SM::INT16, ring);
+        check(full.log == filt.log, "filtered-only parity");
+        check(full.mem.rawWindow > 0 && filt.mem.rawWindow == 0 && q16.mem.rawWindow == 0, "raw window dropped");
+        check(filt.mem.total < full.mem.total, "filtered-only saves memory");
+        check(std::fabs(q16.bpm - 72.0) < 3.0, "int16 bpm");
+        if (ring) check(2 * q16.mem.filteredWindow == filt.mem.filteredWindow, "int16 halves the window");
+        check(full.mem.total == full.mem.object + full.mem.rawWindow + full.mem.filteredWindow + full.mem.display
+              + full.mem.rollingStats + full.mem.peaks + full.mem.ingestQueue + full.mem.preprocessing
+              + full.mem.scratch + full.mem.snapshots, "breakdown sums to total");
+    }
+
+    // Ring storage follows the window: shrinking it releases capacity
+    {
+        heartpy::RealtimeAnalyzer rt(50.0);
+        size_t before = rt.memoryFootprint().filteredWindow;
+        rt.setWindowSeconds(10.0);
+        check(rt.memoryFootprint().filteredWindow < before, "ring shrinks with window");
+    }
+
+    // Pool: compact sessions plan and measure less
+    {
+        heartpy::Options full, compact; compact.storageMode = SM::INT16;
+        check(heartpy::AnalyzerPool::estimateSessionBytes(50.0, compact, 20.0) < heartpy::AnalyzerPool::estimateSessionBytes(50.0, full, 20.0), "pool estimate");
+        heartpy::PoolConfig cfg; cfg.workers = 1;
+        heartpy::AnalyzerPool pool(cfg);
+        pool.open(50.0, compact, 20.0);
+        auto st = pool.stats();
+        check(st.bytesUsed > 0 && st.bytesUsed <= st.bytesReserved, "measured within estimate");
+    }
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
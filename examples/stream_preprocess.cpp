@@ -0,0 +1,149 @@
+// StreamPreprocessor: the clipping bridge (held samples keep their tags; leading and >200 ms runs
+// pass through; lastTs_ counts held samples once bridged), the sorted-window Hampel against the
+// copy-and-select reference, spike replacement, and baseline/enhancer against the batch functions
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+static bool same(const std::vector<float>& a, const std::vector<float>& b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+}
+
+static std::vector<float> runAll(const heartpy::Options& o, double fs, const std::vector<float>& x) {
+    heartpy::StreamPreprocessor p;
+    p.configure(fs, o);
+    std::vector<float> out; std::vector<double> tags;
+    for (size_t i = 0; i < x.size(); ++i) p.process(x[i], (double)i, out, tags);
+    return out;
+}
+
+// Trailing-window Hampel as first written: copy the window and select twice per sample
+static std::vector<float> hampelRef(const std::vector<float>& x, int window, double thr) {
+    const size_t W = 2 * (size_t)std::max(0, window / 2) + 1;
+    std::vector<float> out;
+    for (size_t i = 0; i < x.size(); ++i) {
+        std::vector<float> s(x.begin() + (i + 1 >= W ? i + 1 - W : 0), x.begin() + i + 1);
+        auto mid = s.begin() + s.size() / 2;
+        std::nth_element(s.begin(), mid, s.end());
+        const float med = *mid;
+        for (auto& u : s) u = std::fabs(u - med);
+        std::nth_element(s.begin(), mid, s.end());
+        out.push_back(std::fabs(x[i] - med) > thr * *mid ? med : x[i]);
+    }
+    return out;
+}
+
+int main() {
+    const double fs = 50.0;   // hold limit: round(0.2 * fs) = 10 samples
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+    heartpy::Options clipOnly; clipOnly.interpClipping = true;
+
+    // 1) Clipping bridge, sample by sample
+    {
+        std::vector<float> x = {1023, 1023, 1023, 500, 600, 1023, 1023, 1023, 1023, 700};
+        for (int k = 0; k < 12; ++k) x.push_back(1023);
+        x.push_back(800);
+        heartpy::StreamPreprocessor p;
+        p.configure(fs, clipOnly);
+        std::vector<float> out; std::vector<double> tags;
+        std::vector<size_t> sizes;
+        for (size_t i = 0; i < x.size(); ++i) { p.process(x[i], 10.0 + 0.02 * i, out, tags); sizes.push_back(out.size()); }
+        check(sizes[0] == 1 && sizes[1] == 2 && sizes[2] == 3 && out[0] == 1023.0f, "leading run passes through");
+        check(sizes[5] == 5 && sizes[8] == 5, "short run held");
+        check(sizes[9] == 10 && out[5] == 620.0f && out[6] == 640.0f && out[7] == 660.0f && out[8] == 680.0f && out[9] == 700.0f,
+              "short run bridged linearly");
+        check(sizes[19] == 10 && sizes[20] == 21 && sizes[21] == 22, "run over 200 ms released unbridged, then passed through");
+        bool tagsOk = tags.size() == x.size(), longRunRaw = true;
+        for (size_t i = 0; tagsOk && i < x.size(); ++i) tagsOk = tags[i] == 10.0 + 0.02 * i;
+        for (size_t i = 10; i < x.size(); ++i) longRunRaw = longRunRaw && out[i] == x[i];
+        check(tagsOk, "held samples keep their own tags");
+        check(longRunRaw, "long run output unchanged");
+    }
+
+    // 2) Short interior runs: identical to interpolateClipping; stream time counts held samples
+    //    once bridged (runs straddle the 1 s append chunks)
+    {
+        heartpy::SynthConfig sc; sc.fs = fs;
+        auto sig = heartpy::generateSignal(sc, 60.0);
+        std::vector<float> x(sig.samples.size());
+        for (size_t i = 0; i < x.size(); ++i) x[i] = float(512.0 + 300.0 * (sig.samples[i] - sc.offset));
+        for (size_t i = 48; i + 4 < x.size() - 1; i += 150) for (size_t k = 0; k < 4; ++k) x[i + k] = 1023.0f;
+        std::vector<double> ts(x.size());
+        for (size_t i = 0; i < ts.size(); ++i) ts[i] = 1000.0 + i / fs;
+        const std::vector<double> xd(x.begin(), x.end());
+        const auto bd = heartpy::interpolateClipping(xd, fs, clipOnly.clippingThreshold);
+        const std::vector<float> bridged(bd.begin(), bd.end());
+        check(same(runAll(clipOnly, fs, x), bridged), "stream bridge == interpolateClipping");
+
+        const auto a = heartpy::RealtimeAnalyzer::analyzeRecording(fs, clipOnly, x.data(), ts.data(), x.size());
+        const auto b = heartpy::RealtimeAnalyzer::analyzeRecording(fs, heartpy::Options{}, bridged.data(), ts.data(), bridged.size());
+        bool onGrid = !a.empty(), ordered = true;
+        for (size_t k = 0; k < a.size(); ++k) {
+            const double idx = (a[k].t - 1000.0) * fs;
+            onGrid = onGrid && std::fabs(idx - std::round(idx)) < 1e-6;
+            if (k) ordered = ordered && a[k].t >= a[k - 1].t;
+        }
+        check(onGrid && ordered, "update times are input timestamps, in order");
+        check(!a.empty() && !b.empty() && a.back().t == ts.back() && b.back().t == ts.back(), "held samples reach lastTs once bridged");
+        check(!a.empty() && !b.empty() && std::fabs(a.back().metrics.bpm - b.back().metrics.bpm) < 1.0, "same rate as the batch-bridged input");
+        const auto c = heartpy::RealtimeAnalyzer::analyzeRecording(fs, clipOnly, x.data(), nullptr, x.size());
+        check(!c.empty() && std::fabs(c.back().t - x.size() / fs) < 1e-9, "nominal time counts every sample");
+    }
+
+    // 3) Sorted-window Hampel == copy-and-select reference, bit for bit
+    {
+        heartpy::SynthConfig sc; sc.fs = fs; sc.noise = 0.2; sc.motionPerMin = 4.0;
+        auto sig = heartpy::generateSignal(sc, 120.0);
+        std::vector<float> x(sig.samples.begin(), sig.samples.end());
+        for (size_t i = 37; i < x.size(); i += 97) x[i] += (i % 2 ? 8.0f : -8.0f);
+        for (size_t i = 500; i < 520; ++i) x[i] = x[499];   // ties
+        bool all = true;
+        for (int w : {1, 2, 6, 11}) {
+            heartpy::Options o; o.hampelCorrect = true; o.hampelWindow = w;
+            all = all && same(runAll(o, fs, x), hampelRef(x, w, o.hampelThreshold));
+        }
+        check(all, "Hampel == reference");
+    }
+
+    // 4) A spike on a steady ramp is replaced by the trailing median; the rest passes (the
+    //    trailing median lags a ramp by 3 steps, inside 3 MADs)
+    {
+        std::vector<float> x(400);
+        for (size_t i = 0; i < x.size(); ++i) x[i] = float(500.0 + 0.05 * i);
+        x[200] = 800.0f;
+        heartpy::Options o; o.hampelCorrect = true;
+        const auto y = runAll(o, fs, x);
+        size_t changed = 0;
+        for (size_t i = 0; i < x.size(); ++i) if (y[i] != x[i]) ++changed;
+        check(y[200] == x[197], "spike -> trailing median");
+        check(changed == 1, "steady samples untouched");
+    }
+
+    // 5) Baseline removal matches removeBaselineWander; the enhancer matches enhancePeaks on a
+    //    steady ramp (backward and central differences agree there)
+    {
+        heartpy::SynthConfig sc; sc.fs = fs;
+        auto sig = heartpy::generateSignal(sc, 30.0);
+        std::vector<float> x(sig.samples.begin(), sig.samples.end());
+        const auto bd = heartpy::removeBaselineWander(std::vector<double>(x.begin(), x.end()), fs);
+        heartpy::Options ob; ob.removeBaselineWander = true;
+        check(same(runAll(ob, fs, x), std::vector<float>(bd.begin(), bd.end())), "baseline == removeBaselineWander");
+
+        std::vector<float> ramp(200);
+        for (size_t i = 0; i < ramp.size(); ++i) ramp[i] = float(400.0 + 0.5 * i);
+        const auto ed = heartpy::enhancePeaks(std::vector<double>(ramp.begin(), ramp.end()), fs);
+        heartpy::Options oe; oe.enhancePeaks = true;
+        const auto ey = runAll(oe, fs, ramp);
+        double worst = 0.0;
+        for (size_t i = 1; i + 1 < ramp.size(); ++i) worst = std::max(worst, std::fabs(ey[i] - ed[i]));
+        check(ey[0] == ramp[0] && worst < 1e-3, "enhancer == enhancePeaks on a ramp");
+    }
+
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
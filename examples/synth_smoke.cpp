@@ -0,0 +1,104 @@
+// Synthetic generator smoke: determinism, chunking, beat truth, artifacts and timebase
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include "../cpp/heartpy_synth.h"
+#include "../cpp/heartpy_stream.h"
+
+int main() {
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+
+    // 1) Same seed reproduces everything; another seed does not; chunked == one-shot
+    {
+        heartpy::SynthConfig c; c.jitterMs = 3.0; c.motionPerMin = 2.0; c.ectopicProb = 0.05;
+        auto a = heartpy::generateSignal(c, 60.0);
+        auto b = heartpy::generateSignal(c, 60.0);
+        check(a.samples == b.samples && a.timestamps == b.timestamps && a.beatTimes == b.beatTimes, "deterministic by seed");
+        c.seed = 2;
+        check(heartpy::generateSignal(c, 60.0).samples != a.samples, "seed changes the signal");
+        c.seed = 1;
+        heartpy::SignalGenerator g(c);
+        std::vector<float> x(a.samples.size());
+        std::vector<double> t(x.size());
+        for (size_t i = 0; i < x.size(); i += 7) g.next(x.data() + i, t.data() + i, std::min<size_t>(7, x.size() - i));
+        check(x == a.samples && t == a.timestamps, "chunked generation");
+    }
+
+    // 2) Beat truth matches the configured rate and the analyzer agrees on clean PPG
+    {
+        heartpy::SynthConfig c; c.bpm = 66.0;
+        auto s = heartpy::generateSignal(c, 90.0);
+        const auto& bt = s.beatTimes;
+        const double truth = bt.size() > 1 ? 60.0 * (bt.size() - 1) / (bt.back() - bt.front()) : 0.0;
+        check(std::fabs(truth - 66.0) < 2.0, "truth rate");
+        heartpy::RealtimeAnalyzer rt(c.fs);
+        rt.setWindowSeconds(20.0);
+        heartpy::HeartMetrics m, last;
+        for (size_t i = 0; i + 10 <= s.samples.size(); i += 10) { rt.push(s.samples.data() + i, 10); if (rt.poll(m)) last = m; }
+        check(std::fabs(last.bpm - 66.0) < 4.0, "analyzer bpm on synthetic PPG");
+    }
+
+    // 3) ECG: each R wave is the local maximum around its truth time
+    {
+        heartpy::SynthConfig c; c.waveform = heartpy::SynthConfig::Waveform::ECG; c.fs = 250.0; c.noise = 0.0; c.baselineAmp = 0.0;
+        auto s = heartpy::generateSignal(c, 20.0);
+        int good = 0, total = 0;
+        for (double b : s.beatTimes) {
+            const long k = std::lround(b * c.fs);
+            if (k < 5 || k + 5 >= (long)s.samples.size()) continue;
+            ++total;
+            const long at = long(std::max_element(s.samples.begin() + k - 5, s.samples.begin() + k + 6) - s.samples.begin());
+            if (std::labs(at - k) <= 1 && s.samples[at] > c.offset + 0.5) ++good;
+        }
+        check(total > 10 && good == total, "ECG R waves at truth");
+    }
+
+    // 4) Timebase: jitter keeps timestamps increasing; dropouts are gaps (timed) or holds (untimed)
+    {
+        heartpy::SynthConfig c; c.jitterMs = 4.0; c.dropoutPerMin = 6.0; c.dropoutSec = 0.5;
+        auto s = heartpy::generateSignal(c, 120.0);
+        bool increasing = true; int gaps = 0; double devSq = 0.0;
+        for (size_t i = 1; i < s.timestamps.size(); ++i) {
+            const double dt = s.timestamps[i] - s.timestamps[i - 1];
+            if (dt <= 0.0) increasing = false;
+            if (dt > 0.4) ++gaps;
+            else devSq += (dt - 1.0 / c.fs) * (dt - 1.0 / c.fs);
+        }
+        check(increasing, "timestamps increase");
+        check(gaps > 0, "dropout gaps");
+        check(std::sqrt(devSq / s.timestamps.size()) > 1e-3, "timestamp jitter");
+        heartpy::SignalGenerator g(c);
+        std::vector<float> x(size_t(120.0 * c.fs));
+        g.next(x.data(), nullptr, x.size());
+        size_t run = 0, longest = 0;
+        for (size_t i = 1; i < x.size(); ++i) { run = x[i] == x[i - 1] ? run + 1 : 0; longest = std::max(longest, run); }
+        check(longest >= size_t(0.4 * c.fs), "untimed dropouts hold");
+    }
+
+    // 5) Clipping saturates at the configured level
+    {
+        heartpy::SynthConfig c; c.clipLevel = 0.5;
+        auto s = heartpy::generateSignal(c, 30.0);
+        const auto mm = std::minmax_element(s.samples.begin(), s.samples.end());
+        check(*mm.second <= c.offset + 0.5 + 1e-3 && *mm.first >= c.offset - 0.5 - 1e-3, "clip bounds");
+        check(std::count(s.samples.begin(), s.samples.end(), *mm.second) > 50, "clipped runs");
+    }
+
+    // Throughput (informational)
+    {
+        heartpy::SynthConfig c; c.fs = 100.0;
+        heartpy::SignalGenerator g(c);
+        std::vector<float> x(1 << 16);
+        const auto t0 = std::chrono::steady_clock::now();
+        size_t total = 0;
+        for (int r = 0; r < 64; ++r) { g.next(x.data(), nullptr, x.size()); total += x.size(); }
+        const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "synth: " << total / sec / 1e6 << " Msamples/s (" << total * sizeof(float) / sec / 1e6 << " MB/s)\n";
+    }
+
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
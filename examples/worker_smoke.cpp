@@ -0,0 +1,47 @@
+// Background worker smoke: DSP runs off the caller thread; poll()/getters read published snapshots
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include "../cpp/heartpy_stream.h"
+#include "../cpp/heartpy_synth.h"
+
+int main() {
+    const double fs = 50.0;
+    int failures = 0;
+    auto check = [&](bool ok, const char* what) { if (!ok) { ++failures; std::cout << "FAIL " << what << "\n"; } };
+    for (auto policy : {heartpy::Options::Backpressure::DROP_OLDEST, heartpy::Options::Backpressure::BLOCK}) {
+        heartpy::Options o; o.backgroundWorker = true; o.ingestBackpressure = policy;
+        heartpy::RealtimeAnalyzer rt(fs, o);
+        rt.setWindowSeconds(20.0);
+        auto x = heartpy::generateSignal(heartpy::SynthConfig{}, 60.0).samples;
+        std::atomic<bool> done{false};
+        std::thread producer([&]{
+            for (size_t i = 0; i + 10 <= x.size(); i += 10) {
+                rt.push(x.data() + i, 10);
+                std::this_thread::sleep_for(std::chrono::milliseconds(2)); // ~25x realtime
+            }
+            done = true;
+        });
+        heartpy::HeartMetrics m, last;
+        int updates = 0;
+        size_t maxDisplay = 0;
+        while (!done.load()) {
+            if (rt.poll(m)) { last = m; ++updates; }
+            maxDisplay = std::max(maxDisplay, rt.displayBuffer().size());
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        producer.join();
+        // Let the worker catch up with the tail of the stream
+        for (int k = 0; k < 100; ++k) { if (rt.poll(m)) { last = m; ++updates; } std::this_thread::sleep_for(std::chrono::milliseconds(5)); }
+        check(updates > 5, "worker publishes updates");
+        check(std::fabs(last.bpm - 72.0) < 3.0, "worker bpm");
+        check(!rt.latestPeaks().empty() && !rt.latestRR().empty(), "snapshot peaks/RR");
+        check(maxDisplay > 0, "snapshot display");
+        check(!rt.poll(m), "poll reports each update once");
+    }
+    std::cout << (failures == 0 ? "OK" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -32,5 +32,32 @@ describe('RealtimeAnalyzer path selection', () => {
     expect(logSpy).toHaveBeenCalledWith('HeartPy: using NativeModules path');
     await a.destroy();
   });
-});
 
+  it('backfill on NativeModules uses rtBackfill when the module has it', async () => {
+    const { NativeModules } = require('react-native');
+    const M = NativeModules.HeartPyModule;
+    M.rtBackfill = jest.fn(async () => [{ bpm: 60, t: 1 }]);
+    RealtimeAnalyzer.setConfig({ jsiEnabled: false });
+    const a = await RealtimeAnalyzer.create(50, {});
+    const r = await a.backfill(new Float32Array(20000));
+    expect(M.rtBackfill).toHaveBeenCalledTimes(1);
+    expect(r).toHaveLength(1);
+    await a.destroy();
+    delete M.rtBackfill;
+  });
+
+  it('backfill fallback pushes one update interval at a time and polls after each', async () => {
+    const { NativeModules } = require('react-native');
+    const M = NativeModules.HeartPyModule;
+    (M.rtPush as jest.Mock).mockClear();
+    (M.rtPoll as jest.Mock).mockClear();
+    RealtimeAnalyzer.setConfig({ jsiEnabled: false, maxSamplesPerPush: 5000 });
+    const a = await RealtimeAnalyzer.create(50, {});
+    await a.backfill(new Float32Array(1000));
+    // 1 s at 50 Hz per push: nothing beyond the native 10 s batch clamp is dropped
+    expect(M.rtPush).toHaveBeenCalledTimes(20);
+    expect((M.rtPush as jest.Mock).mock.calls[0][1]).toHaveLength(50);
+    expect(M.rtPoll).toHaveBeenCalledTimes(20);
+    await a.destroy();
+  });
+});
@@ -396,6 +396,35 @@ Java_com_heartpy_HeartPyModule_rtPollNative(JNIEnv* env, jclass, jlong h) {
     return env->NewStringUTF(json.c_str());
 }
 
+// Unclamped catch-up ingestion; a JSON array with one {t, ...metrics} per analysis update
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_heartpy_HeartPyModule_rtBackfillNative(JNIEnv* env, jclass, jlong h, jdoubleArray jData, jdoubleArray jTs) {
+    if (!h || !jData) return nullptr;
+    jsize len = env->GetArrayLength(jData);
+    if (len <= 0) return nullptr;
+    std::vector<double> tmp(len), tsv;
+    env->GetDoubleArrayRegion(jData, 0, len, tmp.data());
+    if (jTs) {
+        if (env->GetArrayLength(jTs) != len) return nullptr;
+        tsv.resize(len);
+        env->GetDoubleArrayRegion(jTs, 0, len, tsv.data());
+    }
+    std::vector<float> x(len);
+    for (jsize i = 0; i < len; ++i) x[i] = static_cast<float>(tmp[i]);
+    std::string json = "[";
+    hp_rt_backfill((void*)h, x.data(), tsv.empty() ? nullptr : tsv.data(), (size_t)len,
+        [](void* user, double t, const heartpy::HeartMetrics* m) {
+            auto& js = *static_cast<std::string*>(user);
+            if (js.size() > 1) js += ",";
+            std::ostringstream os; os.precision(17);   // t may be an epoch timestamp
+            os << "{\"t\":" << t << ",";
+            js += os.str();
+            js += to_json(*m, false).substr(1);
+        }, &json);
+    json += "]";
+    return env->NewStringUTF(json.c_str());
+}
+
 extern "C" JNIEXPORT void JNICALL
 Java_com_heartpy_HeartPyModule_rtDestroyNative(JNIEnv* env, jclass, jlong h) {
     if (!h) return;
@@ -597,6 +626,58 @@ static void installBinding(facebook::jsi::Runtime& rt) {
     );
     rt.global().setProperty(rt, "__hpRtPush", fnPush);
 
+    // __hpRtBackfill(handle:number, data:Float32Array, timestamps?:Float64Array) -> Array<{t, bpm, rrList, quality}>
+    // Unclamped catch-up ingestion (no MAX_SAMPLES_PER_PUSH); one entry per analysis update.
+    auto fnBackfill = Function::createFromHostFunction(
+        rt,
+        PropNameID::forAscii(rt, "__hpRtBackfill"),
+        3,
+        [](Runtime& rt, const Value&, const Value* args, size_t count) -> Value {
+            if (count < 2) throw JSError(rt, "HEARTPY_E102: missing data");
+            if (!args[0].isNumber()) throw JSError(rt, "HEARTPY_E101: invalid handle");
+            uint32_t id = (uint32_t)args[0].asNumber();
+            void* p = hp_handle_get(id);
+            if (!p) throw JSError(rt, "HEARTPY_E101: invalid handle");
+            if (!args[1].isObject()) throw JSError(rt, "HEARTPY_E102: invalid buffer");
+            auto o = args[1].asObject(rt);
+            size_t len = (size_t)o.getProperty(rt, "length").asNumber();
+            if (len == 0) throw JSError(rt, "HEARTPY_E102: empty buffer");
+            std::vector<float> x(len);
+            for (size_t i = 0; i < len; ++i) x[i] = (float)o.getPropertyAtIndex(rt, (uint32_t)i).asNumber();
+            std::vector<double> ts;
+            if (count > 2 && args[2].isObject()) {
+                auto to = args[2].asObject(rt);
+                size_t lt = (size_t)to.getProperty(rt, "length").asNumber();
+                if (lt != len) throw JSError(rt, "HEARTPY_E102: timestamps length mismatch");
+                ts.resize(lt);
+                for (size_t i = 0; i < lt; ++i) ts[i] = to.getPropertyAtIndex(rt, (uint32_t)i).asNumber();
+            }
+            struct Upd { double t; heartpy::HeartMetrics m; };
+            std::vector<Upd> ups;
+            hp_rt_backfill(p, x.data(), ts.empty() ? nullptr : ts.data(), len,
+                [](void* user, double t, const heartpy::HeartMetrics* m) {
+                    static_cast<std::vector<Upd>*>(user)->push_back({t, *m});
+                }, &ups);
+            Array res(rt, ups.size());
+            for (size_t k = 0; k < ups.size(); ++k) {
+                const auto& out = ups[k].m;
+                Object obj(rt);
+                obj.setProperty(rt, "t", ups[k].t);
+                obj.setProperty(rt, "bpm", out.bpm);
+                Array rr(rt, out.rrList.size());
+                for (size_t i = 0; i < out.rrList.size(); ++i) rr.setValueAtIndex(rt, i, out.rrList[i]);
+                obj.setProperty(rt, "rrList", rr);
+                Object q(rt);
+                q.setProperty(rt, "snrDb", out.quality.snrDb);
+                q.setProperty(rt, "confidence", out.quality.confidence);
+                obj.setProperty(rt, "quality", q);
+                res.setValueAtIndex(rt, k, obj);
+            }
+            return res;
+        }
+    );
+    rt.global().setProperty(rt, "__hpRtBackfill", fnBackfill);
+
     // __hpRtPoll(handle:number) -> object | null
     auto fnPoll = Function::createFromHostFunction(
         rt,
@@ -607,21 +688,31 @@ static void installBinding(facebook::jsi::Runtime& rt) {
             uint32_t id = (uint32_t)args[0].asNumber();
             void* p = hp_handle_get(id);
             if (!p) throw JSError(rt, "HEARTPY_E111: invalid handle");
-            heartpy::HeartMetrics out;
-            if (!hp_rt_poll(p, &out)) return Value::null();
+            // Flat result into a reused buffer: no HeartMetrics is built or walked on this thread.
+            // A longer RR list grows the buffer and is copied again from the same update.
+            static thread_local std::vector<double> rrBuf(512);
+            hp_result out{}; out.size = sizeof(out);
+            hp_result_buffers bufs{}; bufs.rr = rrBuf.data(); bufs.rrCap = rrBuf.size();
+            if (hp_rt_poll_into(p, &out, &bufs) != 1) return Value::null();
+            if (out.truncated & HP_TRUNC_RR) {
+                rrBuf.resize(out.rrCount);
+                bufs.rr = rrBuf.data(); bufs.rrCap = rrBuf.size();
+                hp_rt_last_into(p, &out, &bufs);
+            }
             Object obj(rt);
             obj.setProperty(rt, "bpm", out.bpm);
             // rrList
             {
-                Array rr(rt, out.rrList.size());
-                for (size_t i=0;i<out.rrList.size();++i) rr.setValueAtIndex(rt, i, out.rrList[i]);
+                const size_t n = out.rrCount;
+                Array rr(rt, n);
+                for (size_t i=0;i<n;++i) rr.setValueAtIndex(rt, i, rrBuf[i]);
                 obj.setProperty(rt, "rrList", rr);
             }
             // quality
             {
                 Object q(rt);
-                q.setProperty(rt, "snrDb", out.quality.snrDb);
-                q.setProperty(rt, "confidence", out.quality.confidence);
+                q.setProperty(rt, "snrDb", out.snrDb);
+                q.setProperty(rt, "confidence", out.confidence);
                 obj.setProperty(rt, "quality", q);
             }
             return obj;
@@ -629,6 +720,91 @@ static void installBinding(facebook::jsi::Runtime& rt) {
     );
     rt.global().setProperty(rt, "__hpRtPoll", fnPoll);
 
+    // __hpRtPollDelta(handle:number) -> object | null
+    // Incremental poll: { seq, reset, windowStartAbs, added/revised: [absIndex, rrMs, accepted, ...],
+    // removed: [absIndex...], rrList?/mask? (warm-up only), scalars: {changed only}, qualityWarning? }
+    auto fnPollDelta = Function::createFromHostFunction(
+        rt,
+        PropNameID::forAscii(rt, "__hpRtPollDelta"),
+        1,
+        [](Runtime& rt, const Value&, const Value* args, size_t count) -> Value {
+            if (count < 1 || !args[0].isNumber()) throw JSError(rt, "HEARTPY_E111: invalid handle");
+            uint32_t id = (uint32_t)args[0].asNumber();
+            void* p = hp_handle_get(id);
+            if (!p) throw JSError(rt, "HEARTPY_E111: invalid handle");
+            // Reused across calls on the JS thread. A reset lists the whole window, so a delta that
+            // does not fit grows the buffers to its counts and is copied again from the same poll.
+            static thread_local std::vector<hp_beat> added(512), revised(512);
+            static thread_local std::vector<uint64_t> removed(512);
+            static thread_local std::vector<double> rrList(512);
+            static thread_local std::vector<int32_t> mask(512);
+            char warning[256];
+            auto buffers = [&]() {
+                return hp_delta_buffers{added.data(), added.size(), revised.data(), revised.size(), removed.data(), removed.size(),
+                                        rrList.data(), rrList.size(), mask.data(), mask.size(), warning, sizeof(warning)};
+            };
+            hp_delta_buffers bufs = buffers();
+            hp_poll_delta d{}; d.size = sizeof(d);
+            if (hp_rt_poll_delta(p, &d, &bufs) != 1) return Value::null();
+            if (d.truncated & (HP_TRUNC_ADDED | HP_TRUNC_REVISED | HP_TRUNC_REMOVED | HP_TRUNC_RR | HP_TRUNC_MASK)) {
+                added.resize(std::max<size_t>(added.size(), d.addedCount));
+                revised.resize(std::max<size_t>(revised.size(), d.revisedCount));
+                removed.resize(std::max<size_t>(removed.size(), d.removedCount));
+                rrList.resize(std::max<size_t>(rrList.size(), d.rrListCount));
+                mask.resize(std::max<size_t>(mask.size(), d.maskCount));
+                bufs = buffers();
+                hp_rt_last_delta_into(p, &d, &bufs);
+            }
+            auto beats = [&](const std::vector<hp_beat>& v, uint32_t n) {
+                n = std::min<uint32_t>(n, (uint32_t)v.size());
+                Array a(rt, 3 * (size_t)n);
+                for (uint32_t i = 0; i < n; ++i) {
+                    a.setValueAtIndex(rt, 3 * i, (double)v[i].absIndex);
+                    a.setValueAtIndex(rt, 3 * i + 1, v[i].rrMs);
+                    a.setValueAtIndex(rt, 3 * i + 2, v[i].accepted);
+                }
+                return a;
+            };
+            Object obj(rt);
+            obj.setProperty(rt, "seq", (double)d.seq);
+            obj.setProperty(rt, "reset", d.reset != 0);
+            obj.setProperty(rt, "windowStartAbs", (double)d.windowStartAbs);
+            obj.setProperty(rt, "added", beats(added, d.addedCount));
+            obj.setProperty(rt, "revised", beats(revised, d.revisedCount));
+            {
+                const uint32_t n = std::min<uint32_t>(d.removedCount, (uint32_t)removed.size());
+                Array a(rt, n);
+                for (uint32_t i = 0; i < n; ++i) a.setValueAtIndex(rt, i, (double)removed[i]);
+                obj.setProperty(rt, "removed", a);
+            }
+            if (!d.rrPerBeat) {
+                const uint32_t n = std::min<uint32_t>(d.rrListCount, (uint32_t)rrList.size());
+                Array a(rt, n);
+                for (uint32_t i = 0; i < n; ++i) a.setValueAtIndex(rt, i, rrList[i]);
+                obj.setProperty(rt, "rrList", a);
+            }
+            if (!d.maskPerBeat) {
+                const uint32_t n = std::min<uint32_t>(d.maskCount, (uint32_t)mask.size());
+                Array a(rt, n);
+                for (uint32_t i = 0; i < n; ++i) a.setValueAtIndex(rt, i, mask[i]);
+                obj.setProperty(rt, "mask", a);
+            }
+            static const char* const kScalarNames[HP_SCALAR_COUNT] = {
+                "bpm", "sdnn", "rmssd", "sdsd", "pnn20", "pnn50", "sd1", "sd2", "lfhf", "breathingRate",
+                "snrDb", "confidence", "rejectionRate", "goodQuality"};
+            Object sc(rt);
+            for (int i = 0; i < HP_SCALAR_COUNT; ++i)
+                if (d.changedScalars & (1u << i)) sc.setProperty(rt, kScalarNames[i], d.scalars[i]);
+            obj.setProperty(rt, "scalars", sc);
+            if (d.warningChanged) obj.setProperty(rt, "qualityWarning", String::createFromUtf8(rt, warning));
+            // Not expected after the re-copy; kept so a consumer never applies a partial delta silently
+            if (d.truncated & (HP_TRUNC_ADDED | HP_TRUNC_REVISED | HP_TRUNC_REMOVED | HP_TRUNC_RR | HP_TRUNC_MASK))
+                obj.setProperty(rt, "truncated", true);
+            return obj;
+        }
+    );
+    rt.global().setProperty(rt, "__hpRtPollDelta", fnPollDelta);
+
     // __hpRtDestroy(handle:number)
     auto fnDestroy = Function::createFromHostFunction(
         rt,
@@ -94,6 +94,7 @@ public class HeartPyModule extends ReactContextBaseJavaModule {
     private static native void rtPushNative(long handle, double[] samples, double t0);
     private static native void rtPushTsNative(long handle, double[] samples, double[] timestamps);
     private static native String rtPollNative(long handle);
+    private static native String rtBackfillNative(long handle, double[] samples, double[] timestamps);
     private static native void rtDestroyNative(long handle);
     private static native String rtValidateOptionsNative(double fs,
                                                          double lowHz, double highHz,
@@ -748,6 +749,27 @@ public class HeartPyModule extends ReactContextBaseJavaModule {
         }
     }
 
+    // Catch-up ingestion without MAX_SAMPLES_PER_PUSH; resolves to one entry per analysis update
+    @ReactMethod
+    public void rtBackfill(double handle, double[] samples, double[] timestamps, Promise promise) {
+        try {
+            final long h = (long) handle;
+            if (h == 0L) { promise.reject("HEARTPY_E101", "Invalid or destroyed handle"); return; }
+            if (samples == null || samples.length == 0) { promise.reject("HEARTPY_E102", "Invalid data buffer: empty buffer"); return; }
+            if (timestamps != null && timestamps.length != samples.length) { promise.reject("HEARTPY_E102", "Invalid buffers: timestamps length mismatch"); return; }
+            executorFor(h).submit(() -> {
+                try {
+                    String json = rtBackfillNative(h, samples, timestamps);
+                    promise.resolve(json == null ? Arguments.createArray() : toWritableArray(new org.json.JSONArray(json)));
+                } catch (Exception e) {
+                    promise.reject("HEARTPY_E900", e);
+                }
+            });
+        } catch (Exception e) {
+            promise.reject("HEARTPY_E900", e);
+        }
+    }
+
     @ReactMethod
     public void rtDestroy(double handle, Promise promise) {
         try {
@@ -709,6 +709,105 @@ RCT_EXPORT_BLOCKING_SYNCHRONOUS_METHOD(installJSI)
 
 // MARK: - Realtime Streaming (NativeModules P0)
 
+// Realtime metrics as returned by rtPoll (one entry of rtBackfill adds t)
+static NSMutableDictionary* metricsDictionary(const heartpy::HeartMetrics& res) {
+    NSMutableDictionary* out = [NSMutableDictionary new];
+    out[@"bpm"] = @(res.bpm);
+    // Arrays
+    {
+        NSMutableArray* ibi = [NSMutableArray arrayWithCapacity:res.ibiMs.size()];
+        for (double v : res.ibiMs) [ibi addObject:@(v)];
+        out[@"ibiMs"] = ibi;
+        NSMutableArray* rr = [NSMutableArray arrayWithCapacity:res.rrList.size()];
+        for (double v : res.rrList) [rr addObject:@(v)];
+        out[@"rrList"] = rr;
+        NSMutableArray* peaks = [NSMutableArray arrayWithCapacity:res.peakList.size()];
+        for (int idx : res.peakList) [peaks addObject:@(idx)];
+        out[@"peakList"] = peaks;
+    }
+    // Time domain
+    out[@"sdnn"] = @(res.sdnn);
+    out[@"rmssd"] = @(res.rmssd);
+    out[@"sdsd"] = @(res.sdsd);
+    out[@"pnn20"] = @(res.pnn20);
+    out[@"pnn50"] = @(res.pnn50);
+    out[@"nn20"] = @(res.nn20);
+    out[@"nn50"] = @(res.nn50);
+    out[@"mad"] = @(res.mad);
+    // Poincaré
+    out[@"sd1"] = @(res.sd1);
+    out[@"sd2"] = @(res.sd2);
+    out[@"sd1sd2Ratio"] = @(res.sd1sd2Ratio);
+    out[@"ellipseArea"] = @(res.ellipseArea);
+    // Frequency domain
+    out[@"vlf"] = @(res.vlf);
+    out[@"lf"] = @(res.lf);
+    out[@"hf"] = @(res.hf);
+    out[@"lfhf"] = @(res.lfhf);
+    out[@"totalPower"] = @(res.totalPower);
+    out[@"lfNorm"] = @(res.lfNorm);
+    out[@"hfNorm"] = @(res.hfNorm);
+    // Breathing
+    out[@"breathingRate"] = @(res.breathingRate);
+    // Quality
+    {
+        NSMutableDictionary* q = [NSMutableDictionary new];
+        q[@"totalBeats"] = @(res.quality.totalBeats);
+        q[@"rejectedBeats"] = @(res.quality.rejectedBeats);
+        q[@"rejectionRate"] = @(res.quality.rejectionRate);
+        q[@"goodQuality"] = @(res.quality.goodQuality);
+        // Streaming quality fields (if available)
+        q[@"snrDb"] = @(res.quality.snrDb);
+        q[@"confidence"] = @(res.quality.confidence);
+        q[@"f0Hz"] = @(res.quality.f0Hz);
+        q[@"maPercActive"] = @(res.quality.maPercActive);
+        q[@"doublingFlag"] = @(res.quality.doublingFlag);
+        q[@"softDoublingFlag"] = @(res.quality.softDoublingFlag);
+        q[@"doublingHintFlag"] = @(res.quality.doublingHintFlag);
+        q[@"hardFallbackActive"] = @(res.quality.hardFallbackActive);
+        q[@"rrFallbackModeActive"] = @(res.quality.rrFallbackModeActive);
+        q[@"refractoryMsActive"] = @(res.quality.refractoryMsActive);
+        q[@"minRRBoundMs"] = @(res.quality.minRRBoundMs);
+        q[@"pairFrac"] = @(res.quality.pairFrac);
+        q[@"rrShortFrac"] = @(res.quality.rrShortFrac);
+        q[@"rrLongMs"] = @(res.quality.rrLongMs);
+        q[@"pHalfOverFund"] = @(res.quality.pHalfOverFund);
+        if (!res.quality.qualityWarning.empty()) {
+            q[@"qualityWarning"] = [NSString stringWithUTF8String:res.quality.qualityWarning.c_str()];
+        }
+        out[@"quality"] = q;
+    }
+    // P1 FIX: Add peakListRaw and remove faulty windowStartAbs calculation
+    {
+        NSMutableArray* peakListRaw = [NSMutableArray arrayWithCapacity:res.peakListRaw.size()];
+        for (int idx : res.peakListRaw) [peakListRaw addObject:@(idx)];
+        out[@"peakListRaw"] = peakListRaw;
+        
+        // P1 FIX: Remove faulty windowStartAbs calculation
+        // The previous heuristic (peakListRaw.size() - 150) was incorrect and caused overflow
+        // For now, set to 0 to indicate early detection phase
+        // In production, the native core should provide the actual window start
+        double windowStartAbs = 0.0; // Default for early detection
+        out[@"windowStartAbs"] = @(windowStartAbs);
+    }
+    // Binary segments (if any)
+    {
+        NSMutableArray* segs = [NSMutableArray arrayWithCapacity:res.binarySegments.size()];
+        for (const auto& s : res.binarySegments) {
+            NSMutableDictionary* d = [NSMutableDictionary new];
+            d[@"index"] = @(s.index);
+            d[@"startBeat"] = @(s.startBeat);
+            d[@"endBeat"] = @(s.endBeat);
+            d[@"totalBeats"] = @(s.totalBeats);
+            d[@"rejectedBeats"] = @(s.rejectedBeats);
+            d[@"accepted"] = @(s.accepted);
+            [segs addObject:d];
+        }
+        out[@"binarySegments"] = segs;
+    }
+    return out;
+}
+
 // Create realtime analyzer and return opaque handle (as number)
 RCT_EXPORT_METHOD(rtCreate:(double)fs
                   options:(NSDictionary *)options
@@ -812,103 +911,42 @@ RCT_EXPORT_METHOD(rtPoll:(nonnull NSNumber*)handle
         heartpy::HeartMetrics res;
         if (!hp_rt_poll(h, &res)) { resolve(nil); return; }
 
-        NSMutableDictionary* out = [NSMutableDictionary new];
-        out[@"bpm"] = @(res.bpm);
-        // Arrays
-        {
-            NSMutableArray* ibi = [NSMutableArray arrayWithCapacity:res.ibiMs.size()];
-            for (double v : res.ibiMs) [ibi addObject:@(v)];
-            out[@"ibiMs"] = ibi;
-            NSMutableArray* rr = [NSMutableArray arrayWithCapacity:res.rrList.size()];
-            for (double v : res.rrList) [rr addObject:@(v)];
-            out[@"rrList"] = rr;
-            NSMutableArray* peaks = [NSMutableArray arrayWithCapacity:res.peakList.size()];
-            for (int idx : res.peakList) [peaks addObject:@(idx)];
-            out[@"peakList"] = peaks;
-        }
-        // Time domain
-        out[@"sdnn"] = @(res.sdnn);
-        out[@"rmssd"] = @(res.rmssd);
-        out[@"sdsd"] = @(res.sdsd);
-        out[@"pnn20"] = @(res.pnn20);
-        out[@"pnn50"] = @(res.pnn50);
-        out[@"nn20"] = @(res.nn20);
-        out[@"nn50"] = @(res.nn50);
-        out[@"mad"] = @(res.mad);
-        // Poincaré
-        out[@"sd1"] = @(res.sd1);
-        out[@"sd2"] = @(res.sd2);
-        out[@"sd1sd2Ratio"] = @(res.sd1sd2Ratio);
-        out[@"ellipseArea"] = @(res.ellipseArea);
-        // Frequency domain
-        out[@"vlf"] = @(res.vlf);
-        out[@"lf"] = @(res.lf);
-        out[@"hf"] = @(res.hf);
-        out[@"lfhf"] = @(res.lfhf);
-        out[@"totalPower"] = @(res.totalPower);
-        out[@"lfNorm"] = @(res.lfNorm);
-        out[@"hfNorm"] = @(res.hfNorm);
-        // Breathing
-        out[@"breathingRate"] = @(res.breathingRate);
-        // Quality
-        {
-            NSMutableDictionary* q = [NSMutableDictionary new];
-            q[@"totalBeats"] = @(res.quality.totalBeats);
-            q[@"rejectedBeats"] = @(res.quality.rejectedBeats);
-            q[@"rejectionRate"] = @(res.quality.rejectionRate);
-            q[@"goodQuality"] = @(res.quality.goodQuality);
-            // Streaming quality fields (if available)
-            q[@"snrDb"] = @(res.quality.snrDb);
-            q[@"confidence"] = @(res.quality.confidence);
-            q[@"f0Hz"] = @(res.quality.f0Hz);
-            q[@"maPercActive"] = @(res.quality.maPercActive);
-            q[@"doublingFlag"] = @(res.quality.doublingFlag);
-            q[@"softDoublingFlag"] = @(res.quality.softDoublingFlag);
-            q[@"doublingHintFlag"] = @(res.quality.doublingHintFlag);
-            q[@"hardFallbackActive"] = @(res.quality.hardFallbackActive);
-            q[@"rrFallbackModeActive"] = @(res.quality.rrFallbackModeActive);
-            q[@"refractoryMsActive"] = @(res.quality.refractoryMsActive);
-            q[@"minRRBoundMs"] = @(res.quality.minRRBoundMs);
-            q[@"pairFrac"] = @(res.quality.pairFrac);
-            q[@"rrShortFrac"] = @(res.quality.rrShortFrac);
-            q[@"rrLongMs"] = @(res.quality.rrLongMs);
-            q[@"pHalfOverFund"] = @(res.quality.pHalfOverFund);
-            if (!res.quality.qualityWarning.empty()) {
-                q[@"qualityWarning"] = [NSString stringWithUTF8String:res.quality.qualityWarning.c_str()];
-            }
-            out[@"quality"] = q;
-        }
-        // P1 FIX: Add peakListRaw and remove faulty windowStartAbs calculation
-        {
-            NSMutableArray* peakListRaw = [NSMutableArray arrayWithCapacity:res.peakListRaw.size()];
-            for (int idx : res.peakListRaw) [peakListRaw addObject:@(idx)];
-            out[@"peakListRaw"] = peakListRaw;
-            
-            // P1 FIX: Remove faulty windowStartAbs calculation
-            // The previous heuristic (peakListRaw.size() - 150) was incorrect and caused overflow
-            // For now, set to 0 to indicate early detection phase
-            // In production, the native core should provide the actual window start
-            double windowStartAbs = 0.0; // Default for early detection
-            out[@"windowStartAbs"] = @(windowStartAbs);
+        resolve(metricsDictionary(res));
+    } @catch (NSException* e) {
+        reject(@"rt_poll_exception", e.reason, nil);
+    }
+}
+
+// Catch-up ingestion without the per-push limit; resolves to one entry per analysis update
+RCT_EXPORT_METHOD(rtBackfill:(nonnull NSNumber*)handle
+                  samples:(NSArray<NSNumber*>*)xs
+                  timestamps:(NSArray<NSNumber*>*)ts
+                  resolver:(RCTPromiseResolveBlock)resolve
+                  rejecter:(RCTPromiseRejectBlock)reject)
+{
+    @try {
+        if (handle == nil || xs == nil || xs.count == 0 || (ts != nil && ts.count != xs.count)) {
+            reject(@"rt_backfill_invalid_args", @"Invalid handle or mismatched arrays", nil);
+            return;
         }
-        // Binary segments (if any)
-        {
-            NSMutableArray* segs = [NSMutableArray arrayWithCapacity:res.binarySegments.size()];
-            for (const auto& s : res.binarySegments) {
-                NSMutableDictionary* d = [NSMutableDictionary new];
-                d[@"index"] = @(s.index);
-                d[@"startBeat"] = @(s.startBeat);
-                d[@"endBeat"] = @(s.endBeat);
-                d[@"totalBeats"] = @(s.totalBeats);
-                d[@"rejectedBeats"] = @(s.rejectedBeats);
-                d[@"accepted"] = @(s.accepted);
-                [segs addObject:d];
-            }
-            out[@"binarySegments"] = segs;
+        void* h = (void*)[handle longValue];
+        std::vector<float> samples; samples.reserve(xs.count);
+        for (NSNumber* v in xs) samples.push_back([v floatValue]);
+        std::vector<double> timestamps;
+        if (ts != nil) {
+            timestamps.reserve(ts.count);
+            for (NSNumber* t in ts) timestamps.push_back([t doubleValue]);
         }
+        NSMutableArray* out = [NSMutableArray new];
+        hp_rt_backfill(h, samples.data(), timestamps.empty() ? nullptr : timestamps.data(), samples.size(),
+            [](void* user, double t, const heartpy::HeartMetrics* m) {
+                NSMutableDictionary* d = metricsDictionary(*m);
+                d[@"t"] = @(t);
+                [(__bridge NSMutableArray*)user addObject:d];
+            }, (__bridge void*)out);
         resolve(out);
     } @catch (NSException* e) {
-        reject(@"rt_poll_exception", e.reason, nil);
+        reject(@"rt_backfill_exception", e.reason, nil);
     }
 }
 
@@ -288,6 +288,23 @@ export function analyzeJSI(signal: number[] | Float64Array, fs: number, options?
 
 type HeartPyMetrics = HeartPyResult; // streaming returns same shape
 
+// Incremental poll result (JSI): beats are flat triples [absIndex, rrMs, accepted, ...] keyed by
+// absolute sample index. Drop mirrored beats below windowStartAbs; on reset, clear the mirror.
+export type HeartPyPollDelta = {
+    seq: number;
+    reset: boolean;
+    windowStartAbs: number;
+    added: number[];
+    revised: number[];
+    removed: number[];
+    rrList?: number[];            // warm-up only: the full RR list (not one interval per beat)
+    mask?: number[];              // likewise for binaryPeakMask
+    scalars: Partial<Record<'bpm' | 'sdnn' | 'rmssd' | 'sdsd' | 'pnn20' | 'pnn50' | 'sd1' | 'sd2' | 'lfhf'
+        | 'breathingRate' | 'snrDb' | 'confidence' | 'rejectionRate' | 'goodQuality', number>>; // changed only
+    qualityWarning?: string;      // present when it changed
+    truncated?: boolean;          // incomplete: skip it, the next delta is a reset
+};
+
 export async function rtCreate(fs: number, options?: HeartPyOptions): Promise<number> {
     const { NativeModules } = require('react-native');
     const Native: any = NativeModules?.HeartPyModule;
@@ -371,10 +388,26 @@ export async function rtPushTs(handle: number, samples: number[] | Float32Array,
     return p?.then?.(() => { recordDuration(pushDurationsMs, Date.now() - t1); }) ?? p;
 }
 
+// Unclamped catch-up ingestion (NativeModules path); one entry per analysis update
+export async function rtBackfill(handle: number, samples: number[] | Float32Array, timestamps?: number[] | Float64Array): Promise<Array<HeartPyMetrics & { t?: number }>> {
+    const { NativeModules } = require('react-native');
+    const Native: any = NativeModules?.HeartPyModule;
+    if (!Native?.rtBackfill) throw new Error('HeartPyModule.rtBackfill not available');
+    jsCalls++;
+    const xs = (samples instanceof Float32Array ? Array.from(samples) : samples) as number[];
+    const ts = timestamps == null ? null : (timestamps instanceof Float64Array ? Array.from(timestamps) : timestamps) as number[];
+    if (!handle) { const e: any = new Error('Invalid or destroyed handle'); e.code = 'HEARTPY_E101'; throw e; }
+    if (!xs?.length) { const e: any = new Error('Invalid data buffer: empty buffer'); e.code = 'HEARTPY_E102'; throw e; }
+    nmCalls++;
+    return (await Native.rtBackfill(handle, xs, ts)) ?? [];
+}
+
 export class RealtimeAnalyzer {
     private handle: number = 0;
     private mode: 'nm' | 'jsi' = 'nm';
     private jsiId: number = 0; // 32-bit id when JSI is used
+    private fs: number = 0;
+    private updateSec: number = 1.0; // native default; not configurable from JS
     private constructor(h: number) { this.handle = h; }
 
     static async create(fs: number, options?: HeartPyOptions): Promise<RealtimeAnalyzer> {
@@ -402,6 +435,7 @@ export class RealtimeAnalyzer {
                 }
                 const id = g.__hpRtCreate(fs, options ?? {});
                 const inst = new RealtimeAnalyzer(0);
+                inst.fs = fs;
                 inst.mode = 'jsi';
                 inst.jsiId = id | 0;
                 if (options?.windowSeconds != null) {
@@ -422,6 +456,7 @@ export class RealtimeAnalyzer {
 
         const h = await rtCreate(fs, options);
         const inst = new RealtimeAnalyzer(h);
+        inst.fs = fs;
         if (options?.windowSeconds != null) {
             try {
                 await inst.setWindow(options.windowSeconds);
@@ -484,6 +519,19 @@ export class RealtimeAnalyzer {
         }
     }
 
+    // Only what changed since the previous pollDelta(); do not mix with poll() on one analyzer
+    async pollDelta(): Promise<HeartPyPollDelta | null> {
+        if (this.mode !== 'jsi') throw new Error('pollDelta requires the JSI bridge');
+        if (!this.jsiId) throw new Error('RealtimeAnalyzer destroyed');
+        const g: any = global as any;
+        if (typeof g.__hpRtPollDelta !== 'function') throw new Error('HeartPy JSI pollDelta not available');
+        jsiCalls++;
+        const t1 = Date.now();
+        const res = g.__hpRtPollDelta(this.jsiId);
+        recordDuration(pollDurationsMs, Date.now() - t1);
+        return res ?? null;
+    }
+
     async destroy(): Promise<void> {
         if (this.mode === 'jsi') {
             if (!this.jsiId) return;
@@ -505,6 +553,38 @@ export class RealtimeAnalyzer {
         return rtPushTs(this.handle, (samples as any), (timestamps as any));
     }
 
+    // Catch-up ingestion of a large historical batch (e.g. after a reconnect) without the
+    // per-push size limits. Resolves to one entry per analysis update, in stream order.
+    // JSI and NativeModules with rtBackfill: a single native call. Otherwise pushes of at most one
+    // update interval (native push keeps only the last 10 s of a batch) with a poll after each.
+    async backfill(samples: Float32Array | number[], timestamps?: Float64Array | number[]): Promise<Array<HeartPyMetrics & { t?: number }>> {
+        if (this.mode === 'jsi') {
+            if (!this.jsiId) throw new Error('RealtimeAnalyzer destroyed');
+            const g: any = global as any;
+            if (typeof g.__hpRtBackfill === 'function') {
+                jsiCalls++;
+                const buf = (samples instanceof Float32Array ? samples : new Float32Array(samples as number[]));
+                const ts = timestamps == null ? undefined : (timestamps instanceof Float64Array ? timestamps : new Float64Array(timestamps as number[]));
+                return g.__hpRtBackfill(this.jsiId, buf, ts) ?? [];
+            }
+        }
+        if (this.mode === 'nm') {
+            if (!this.handle) throw new Error('RealtimeAnalyzer destroyed');
+            const { NativeModules } = require('react-native');
+            if (NativeModules?.HeartPyModule?.rtBackfill) return rtBackfill(this.handle, samples, timestamps);
+        }
+        const out: Array<HeartPyMetrics & { t?: number }> = [];
+        const step = Math.max(1, Math.min(cfg.maxSamplesPerPush, Math.floor(10 * this.fs), Math.round(this.updateSec * this.fs)));
+        for (let i = 0; i < samples.length; i += step) {
+            const xs = samples.slice(i, i + step) as any;
+            if (timestamps != null) await this.pushWithTimestamps(xs, timestamps.slice(i, i + step) as any);
+            else await this.push(xs);
+            const r = await this.poll();
+            if (r) out.push(r);
+        }
+        return out;
+    }
+
     // Allow dev-time override of flags
     static setConfig(next: Partial<RuntimeConfig>) {
         cfg = { ...cfg, ...next } as RuntimeConfig;